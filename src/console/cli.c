@@ -1,8 +1,10 @@
 #include <dirent.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
 #include <unistd.h>
+#include <sys/select.h>
 #include <sys/wait.h>
 
 #include "console/cli.h"
@@ -19,6 +21,7 @@ static JVSCLIStatus enableDevice(char *deviceName);
 static JVSCLIStatus disableDevice(char *deviceName);
 static JVSCLIStatus printDeviceListing(Device *device);
 static JVSCLIStatus printListing(void);
+static JVSCLIStatus calibrateDevice(char *deviceName, char *type);
 
 /**
  * Print usage information
@@ -36,6 +39,7 @@ static JVSCLIStatus printUsage(void)
     debug(0, "  --edit     Opens a file for editing\n");
     debug(0, "  --enable   Enables a new/all controller(s)\n");
     debug(0, "  --disable  Disables a new/all controller(s)\n");
+    debug(0, "  --calibrate Calibrates a gun controller, [affine] keeps edges parallel\n");
     debug(0, "  --help     Displays this text\n");
     debug(0, "  --debug    Runs in debug mode\n");
     debug(0, "  --version  Displays the ModernJVS Version\n");
@@ -383,6 +387,163 @@ static JVSCLIStatus printListing(void)
     return JVS_CLI_STATUS_SUCCESS_CLOSE;
 }
 
+/**
+ * Wait for a gun to be aimed at a corner
+ *
+ * Follows where the gun points until the trigger or any other button on
+ * it is pressed, or enter is pressed, which is how a Wii Remote's IR
+ * camera is captured as its buttons are on another device.
+ *
+ * @param fd The gun's event device
+ * @param wiimote 1 if the device is a Wii Remote's IR camera
+ * @param corner Set to where the gun pointed
+ * @returns 1 once a corner is captured, 0 on error
+ */
+static int captureCorner(int fd, int wiimote, int corner[2])
+{
+    static int x = 0, y = 0, ir[4] = {WIIMOTE_IR_NONE, WIIMOTE_IR_NONE, WIIMOTE_IR_NONE, WIIMOTE_IR_NONE};
+    static int seen = 0;
+    struct input_event event;
+
+    while (1)
+    {
+        fd_set descriptors;
+        FD_ZERO(&descriptors);
+        FD_SET(fd, &descriptors);
+        FD_SET(STDIN_FILENO, &descriptors);
+
+        if (select(fd + 1, &descriptors, NULL, NULL, NULL) < 0)
+            return 0;
+
+        int pressed = 0;
+        if (FD_ISSET(STDIN_FILENO, &descriptors))
+        {
+            char line[MAX_LINE_LENGTH];
+            if (!fgets(line, sizeof(line), stdin))
+                return 0;
+            pressed = 1;
+        }
+
+        while (FD_ISSET(fd, &descriptors) && read(fd, &event, sizeof(event)) == sizeof(event))
+        {
+            if (event.type == EV_KEY && event.value == 1)
+                pressed = 1;
+
+            if (event.type != EV_ABS)
+                continue;
+
+            if (wiimote && event.code >= ABS_HAT0X && event.code <= ABS_HAT1Y)
+            {
+                double pointX, pointY;
+                ir[event.code - ABS_HAT0X] = event.value;
+                if (pointWiimote(ir[0], ir[1], ir[2], ir[3], &pointX, &pointY))
+                {
+                    x = pointX * GUN_POSITION_MAX;
+                    y = pointY * GUN_POSITION_MAX;
+                    seen = 1;
+                }
+            }
+            else if (!wiimote && (event.code == ABS_X || event.code == ABS_Y))
+            {
+                *(event.code == ABS_X ? &x : &y) = event.value;
+                seen = 1;
+            }
+        }
+
+        if (!pressed)
+            continue;
+
+        if (!seen)
+        {
+            debug(0, "The gun hasn't reported where it points yet, aim it at the screen and try again\n");
+            continue;
+        }
+
+        corner[0] = x;
+        corner[1] = y;
+        return 1;
+    }
+}
+
+/**
+ * Calibrate a gun controller
+ *
+ * Asks for the gun to be aimed at each corner of the screen in turn, then
+ * saves the transform that puts those corners at the corners of the
+ * screen for the device in GUN_CALIBRATION_PATH. It is picked up the next
+ * time ModernJVS starts.
+ *
+ * @param deviceName The name of the device as shown by --list
+ * @param type affine for a transform that keeps edges parallel, projective otherwise
+ * @returns The status of the action performed
+ */
+static JVSCLIStatus calibrateDevice(char *deviceName, char *type)
+{
+    static const char *cornerNames[GUN_CALIBRATION_CORNERS] = {"top left", "top right", "bottom right", "bottom left"};
+
+    if (!deviceName || !validateFilename(deviceName))
+    {
+        debug(0, "Please give the name of the gun to calibrate, as shown by --list\n");
+        return JVS_CLI_STATUS_ERROR;
+    }
+
+    GunCalibrationType calibrationType = (type && strcmp(type, "affine") == 0) ? GUN_CALIBRATION_AFFINE : GUN_CALIBRATION_PROJECTIVE;
+
+    DeviceList *deviceList = malloc(sizeof(DeviceList));
+    if (deviceList == NULL)
+    {
+        debug(0, "Error: Failed to malloc\n");
+        return JVS_CLI_STATUS_ERROR;
+    }
+
+    int fd = -1;
+    if (getInputs(deviceList))
+    {
+        for (int i = 0; i < deviceList->length && fd < 0; i++)
+        {
+            if (strcmp(deviceList->devices[i].name, deviceName) == 0)
+                fd = open(deviceList->devices[i].path, O_RDONLY | O_NONBLOCK);
+        }
+    }
+    free(deviceList);
+
+    if (fd < 0)
+    {
+        debug(0, "Could not open the controller '%s', is it plugged in and are you root?\n", deviceName);
+        return JVS_CLI_STATUS_ERROR;
+    }
+
+    int wiimote = strcmp(deviceName, WIIMOTE_DEVICE_NAME_IR) == 0;
+    int corners[GUN_CALIBRATION_CORNERS][2];
+    for (int i = 0; i < GUN_CALIBRATION_CORNERS; i++)
+    {
+        debug(0, "Aim at the %s corner of the screen and pull the trigger, or press enter\n", cornerNames[i]);
+        if (!captureCorner(fd, wiimote, corners[i]))
+        {
+            close(fd);
+            return JVS_CLI_STATUS_ERROR;
+        }
+        debug(0, "  Captured %d, %d\n", corners[i][0], corners[i][1]);
+    }
+    close(fd);
+
+    GunCalibration calibration;
+    if (!solveGunCalibration(&calibration, corners, calibrationType))
+    {
+        debug(0, "The corners don't make a usable shape, please calibrate again\n");
+        return JVS_CLI_STATUS_ERROR;
+    }
+
+    if (!saveGunCalibration(&calibration, deviceName, corners))
+    {
+        debug(0, "Failed to save the calibration in %s, are you root?\n", GUN_CALIBRATION_PATH);
+        return JVS_CLI_STATUS_ERROR;
+    }
+
+    debug(0, "ModernJVS has calibrated the controller '%s'.\n", deviceName);
+    return JVS_CLI_STATUS_SUCCESS_CLOSE;
+}
+
 /**
  * Parses the command line arguments
  * 
@@ -434,6 +595,10 @@ JVSCLIStatus parseArguments(int argc, char **argv, char *map)
         initDebug(1);
         return JVS_CLI_STATUS_SUCCESS_CONTINUE;
     }
+    else if (strcmp(argv[1], "--calibrate") == 0)
+    {
+        return calibrateDevice(argc < 3 ? 0 : argv[2], argc < 4 ? 0 : argv[3]);
+    }
     else if (strcmp(argv[1], "--edit") == 0)
     {
         return editFile(argv[2]);
@@ -1,5 +1,6 @@
 #include "config.h"
 
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -35,23 +36,49 @@ static double clampDeadzone(double deadzone)
     return deadzone;
 }
 
+JVSConfigStatus getDefaultBusConfig(JVSBusConfig *bus)
+{
+    bus->senseLineType = DEFAULT_SENSE_LINE_TYPE;
+    bus->senseLinePin = DEFAULT_SENSE_LINE_PIN;
+    bus->lowLatency = DEFAULT_LOW_LATENCY;
+    bus->latencyProbe = DEFAULT_LATENCY_PROBE;
+    bus->switchDebounce = DEFAULT_SWITCH_DEBOUNCE;
+    strncpy(bus->defaultGamePath, DEFAULT_GAME, MAX_PATH_LENGTH - 1);
+    bus->defaultGamePath[MAX_PATH_LENGTH - 1] = '\0';
+    strncpy(bus->devicePath, DEFAULT_DEVICE_PATH, MAX_PATH_LENGTH - 1);
+    bus->devicePath[MAX_PATH_LENGTH - 1] = '\0';
+    strncpy(bus->capabilitiesPath, DEFAULT_IO, MAX_PATH_LENGTH - 1);
+    bus->capabilitiesPath[MAX_PATH_LENGTH - 1] = '\0';
+    bus->secondCapabilitiesPath[0] = 0x00;
+    bus->inputDeviceCount = 0;
+    bus->ffbDevicePath[0] = 0x00;
+    for (int i = 0; i < FFB_MAX_CHANNELS; i++)
+        bus->ffbChannels[i] = FFB_EFFECT_NONE;
+    bus->ffbChannels[0] = FFB_EFFECT_CONSTANT;
+    bus->ffbDriveBoard = FFB_EMULATION_TYPE_ANALOGUE;
+    bus->ffbDriveBoardPath[0] = 0x00;
+    bus->outputSinkCount = 0;
+    bus->gpioInputCount = 0;
+    bus->turboCount = 0;
+    return JVS_CONFIG_STATUS_SUCCESS;
+}
+
 JVSConfigStatus getDefaultConfig(JVSConfig *config)
 {
-    config->senseLineType = DEFAULT_SENSE_LINE_TYPE;
-    config->senseLinePin = DEFAULT_SENSE_LINE_PIN;
+    getDefaultBusConfig(&config->buses[0]);
+    config->busCount = 1;
     config->debugLevel = DEFAULT_DEBUG_LEVEL;
     config->autoControllerDetection = DEFAULT_AUTO_CONTROLLER_DETECTION;
     config->analogDeadzonePlayer1 = DEFAULT_ANALOG_DEADZONE;
     config->analogDeadzonePlayer2 = DEFAULT_ANALOG_DEADZONE;
     config->analogDeadzonePlayer3 = DEFAULT_ANALOG_DEADZONE;
     config->analogDeadzonePlayer4 = DEFAULT_ANALOG_DEADZONE;
-    strncpy(config->defaultGamePath, DEFAULT_GAME, MAX_PATH_LENGTH - 1);
-    config->defaultGamePath[MAX_PATH_LENGTH - 1] = '\0';
-    strncpy(config->devicePath, DEFAULT_DEVICE_PATH, MAX_PATH_LENGTH - 1);
-    config->devicePath[MAX_PATH_LENGTH - 1] = '\0';
-    strncpy(config->capabilitiesPath, DEFAULT_IO, MAX_PATH_LENGTH - 1);
-    config->capabilitiesPath[MAX_PATH_LENGTH - 1] = '\0';
-    config->secondCapabilitiesPath[0] = 0x00;
+    strcpy(config->coinStorePath, DEFAULT_COIN_STORE_PATH);
+    config->hopperRate = DEFAULT_HOPPER_RATE;
+    config->gunFilter.type = GUN_FILTER_NONE;
+    config->gunFilter.timeConstant = DEFAULT_GUN_FILTER_TIME_CONSTANT;
+    config->gunFilter.minCutoff = DEFAULT_GUN_FILTER_MIN_CUTOFF;
+    config->gunFilter.beta = DEFAULT_GUN_FILTER_BETA;
     return JVS_CONFIG_STATUS_SUCCESS;
 }
 
@@ -75,6 +102,9 @@ JVSConfigStatus parseConfig(char *path, JVSConfig *config)
         if (!command)
             continue;
 
+        /* Bus specific settings always apply to the most recently declared bus */
+        JVSBusConfig *bus = &config->buses[config->busCount - 1];
+
         /* This will get overwritten! Need to do defaults somewhere else */
         if (strcmp(command, "INCLUDE") == 0)
         {
@@ -82,19 +112,104 @@ JVSConfigStatus parseConfig(char *path, JVSConfig *config)
             if (token)
                 parseConfig(token, config);
         }
+        else if (strcmp(command, "BUS") == 0)
+        {
+            if (config->busCount >= MAX_JVS_BUSES)
+            {
+                printf("Error: Only %d buses are supported, ignoring extra bus\n", MAX_JVS_BUSES);
+                continue;
+            }
+            getDefaultBusConfig(&config->buses[config->busCount]);
+            config->busCount++;
+        }
+        else if (strcmp(command, "BUS_INPUT") == 0)
+        {
+            char *token = getNextToken(NULL, " ", &saveptr);
+            if (token && bus->inputDeviceCount < MAX_BUS_INPUTS)
+            {
+                strncpy(bus->inputDevices[bus->inputDeviceCount], token, MAX_PATH_LENGTH - 1);
+                bus->inputDevices[bus->inputDeviceCount][MAX_PATH_LENGTH - 1] = '\0';
+                bus->inputDeviceCount++;
+            }
+        }
+        else if (strcmp(command, "GPO_SINK") == 0)
+        {
+            char *type = getNextToken(NULL, " ", &saveptr);
+            char *target = getNextToken(NULL, " ", &saveptr);
+            if (!type || !target)
+            {
+                printf("Error: GPO_SINK needs a type and a target\n");
+                continue;
+            }
+
+            if (bus->outputSinkCount >= MAX_OUTPUT_SINKS)
+            {
+                printf("Error: Only %d GPO sinks are supported per bus, ignoring %s\n", MAX_OUTPUT_SINKS, target);
+                continue;
+            }
+
+            OutputSinkConfig *sink = &bus->outputSinks[bus->outputSinkCount++];
+            strncpy(sink->type, type, MAX_OUTPUT_SINK_TYPE - 1);
+            sink->type[MAX_OUTPUT_SINK_TYPE - 1] = '\0';
+            strncpy(sink->target, target, MAX_PATH_LENGTH - 1);
+            sink->target[MAX_PATH_LENGTH - 1] = '\0';
+
+            /* The bit range and board are optional, by default the sink gets every output of the first board */
+            char *firstBit = getNextToken(NULL, " ", &saveptr);
+            char *lastBit = getNextToken(NULL, " ", &saveptr);
+            char *board = getNextToken(NULL, " ", &saveptr);
+            char *minInterval = getNextToken(NULL, " ", &saveptr);
+            sink->firstBit = (firstBit && firstBit[0]) ? atoi(firstBit) : 0;
+            sink->lastBit = (lastBit && lastBit[0]) ? atoi(lastBit) : JVS_MAX_GPO_BYTES * 8 - 1;
+            sink->board = (board && board[0]) ? atoi(board) : 0;
+            sink->minInterval = (minInterval && minInterval[0]) ? atoi(minInterval) : 0;
+        }
+        else if (strcmp(command, "FFB_DEVICE") == 0)
+        {
+            char *token = getNextToken(NULL, " ", &saveptr);
+            if (token)
+            {
+                strncpy(bus->ffbDevicePath, token, MAX_PATH_LENGTH - 1);
+                bus->ffbDevicePath[MAX_PATH_LENGTH - 1] = '\0';
+            }
+        }
+        else if (strcmp(command, "FFB_DRIVE_BOARD") == 0)
+        {
+            char *type = getNextToken(NULL, " ", &saveptr);
+            char *path = getNextToken(NULL, " ", &saveptr);
+            if (!type || !path)
+            {
+                printf("Error: FFB_DRIVE_BOARD needs a board type and a serial port\n");
+                continue;
+            }
+            bus->ffbDriveBoard = ffbEmulationFromString(type);
+            strncpy(bus->ffbDriveBoardPath, path, MAX_PATH_LENGTH - 1);
+            bus->ffbDriveBoardPath[MAX_PATH_LENGTH - 1] = '\0';
+        }
+        else if (strcmp(command, "FFB_CHANNEL") == 0)
+        {
+            char *channel = getNextToken(NULL, " ", &saveptr);
+            char *effect = getNextToken(NULL, " ", &saveptr);
+            if (!channel || !effect || atoi(channel) < 1 || atoi(channel) > FFB_MAX_CHANNELS)
+            {
+                printf("Error: FFB_CHANNEL needs an analogue output from 1 to %d and an effect\n", FFB_MAX_CHANNELS);
+                continue;
+            }
+            bus->ffbChannels[atoi(channel) - 1] = ffbEffectFromString(effect);
+        }
         else if (strcmp(command, "SENSE_LINE_TYPE") == 0)
         {
             char *token = getNextToken(NULL, " ", &saveptr);
             if (token)
-                config->senseLineType = atoi(token);
+                bus->senseLineType = atoi(token);
         }
         else if (strcmp(command, "EMULATE") == 0)
         {
             char *token = getNextToken(NULL, " ", &saveptr);
             if (token)
             {
-                strncpy(config->capabilitiesPath, token, MAX_PATH_LENGTH - 1);
-                config->capabilitiesPath[MAX_PATH_LENGTH - 1] = '\0';
+                strncpy(bus->capabilitiesPath, token, MAX_PATH_LENGTH - 1);
+                bus->capabilitiesPath[MAX_PATH_LENGTH - 1] = '\0';
             }
         }
         else if (strcmp(command, "EMULATE_SECOND") == 0)
@@ -102,23 +217,82 @@ JVSConfigStatus parseConfig(char *path, JVSConfig *config)
             char *token = getNextToken(NULL, " ", &saveptr);
             if (token)
             {
-                strncpy(config->secondCapabilitiesPath, token, MAX_PATH_LENGTH - 1);
-                config->secondCapabilitiesPath[MAX_PATH_LENGTH - 1] = '\0';
+                strncpy(bus->secondCapabilitiesPath, token, MAX_PATH_LENGTH - 1);
+                bus->secondCapabilitiesPath[MAX_PATH_LENGTH - 1] = '\0';
+            }
+        }
+        else if (strcmp(command, "GPIO_INPUT") == 0)
+        {
+            char *pin = getNextToken(NULL, " ", &saveptr);
+            char *input = getNextToken(NULL, " ", &saveptr);
+            if (!pin || !input)
+            {
+                printf("Error: GPIO_INPUT needs a pin and a JVS input\n");
+                continue;
+            }
+
+            if (bus->gpioInputCount >= MAX_GPIO_INPUTS)
+            {
+                printf("Error: Only %d GPIO inputs are supported per bus, ignoring pin %s\n", MAX_GPIO_INPUTS, pin);
+                continue;
+            }
+
+            /* The player and board are optional, inputs like GPI and the keypad don't need a player */
+            char *player = getNextToken(NULL, " ", &saveptr);
+            char *board = getNextToken(NULL, " ", &saveptr);
+            JVSInput jvsInput = jvsInputFromString(input);
+            JVSPlayer jvsPlayer = (player && player[0]) ? jvsPlayerFromString(player) : SYSTEM;
+            if ((int)jvsInput == -1 || (int)jvsPlayer == -1)
+                continue;
+
+            GPIOInputConfig *gpioInput = &bus->gpioInputs[bus->gpioInputCount++];
+            gpioInput->pin = atoi(pin);
+            gpioInput->input = jvsInput;
+            gpioInput->player = jvsPlayer;
+            gpioInput->secondaryIO = (board && board[0]) ? atoi(board) : 0;
+        }
+        else if (strcmp(command, "TURBO") == 0)
+        {
+            char *input = getNextToken(NULL, " ", &saveptr);
+            char *player = getNextToken(NULL, " ", &saveptr);
+            if (!input || !player)
+            {
+                printf("Error: TURBO needs a JVS switch and a player\n");
+                continue;
+            }
+
+            if (bus->turboCount >= MAX_TURBO_SWITCHES)
+            {
+                printf("Error: Only %d turbo switches are supported per bus, ignoring %s\n", MAX_TURBO_SWITCHES, input);
+                continue;
             }
+
+            char *rate = getNextToken(NULL, " ", &saveptr);
+            char *board = getNextToken(NULL, " ", &saveptr);
+            JVSInput jvsInput = jvsInputFromString(input);
+            JVSPlayer jvsPlayer = jvsPlayerFromString(player);
+            if ((int)jvsInput == -1 || (int)jvsPlayer == -1)
+                continue;
+
+            TurboConfig *turbo = &bus->turbo[bus->turboCount++];
+            turbo->input = jvsInput;
+            turbo->player = jvsPlayer;
+            turbo->rate = (rate && rate[0]) ? atoi(rate) : DEFAULT_TURBO_RATE;
+            turbo->secondaryIO = (board && board[0]) ? atoi(board) : 0;
         }
         else if (strcmp(command, "SENSE_LINE_PIN") == 0)
         {
             char *token = getNextToken(NULL, " ", &saveptr);
             if (token)
-                config->senseLinePin = atoi(token);
+                bus->senseLinePin = atoi(token);
         }
         else if (strcmp(command, "DEFAULT_GAME") == 0)
         {
             char *token = getNextToken(NULL, " ", &saveptr);
             if (token)
             {
-                strncpy(config->defaultGamePath, token, MAX_PATH_LENGTH - 1);
-                config->defaultGamePath[MAX_PATH_LENGTH - 1] = '\0';
+                strncpy(bus->defaultGamePath, token, MAX_PATH_LENGTH - 1);
+                bus->defaultGamePath[MAX_PATH_LENGTH - 1] = '\0';
             }
         }
         else if (strcmp(command, "DEBUG_MODE") == 0)
@@ -132,10 +306,60 @@ JVSConfigStatus parseConfig(char *path, JVSConfig *config)
             char *token = getNextToken(NULL, " ", &saveptr);
             if (token)
             {
-                strncpy(config->devicePath, token, MAX_PATH_LENGTH - 1);
-                config->devicePath[MAX_PATH_LENGTH - 1] = '\0';
+                strncpy(bus->devicePath, token, MAX_PATH_LENGTH - 1);
+                bus->devicePath[MAX_PATH_LENGTH - 1] = '\0';
             }
         }
+        else if (strcmp(command, "LOW_LATENCY") == 0)
+        {
+            char *token = getNextToken(NULL, " ", &saveptr);
+            if (token)
+                bus->lowLatency = atoi(token);
+        }
+        else if (strcmp(command, "LATENCY_PROBE") == 0)
+        {
+            char *token = getNextToken(NULL, " ", &saveptr);
+            if (token)
+                bus->latencyProbe = atoi(token);
+        }
+        else if (strcmp(command, "SWITCH_DEBOUNCE") == 0)
+        {
+            char *token = getNextToken(NULL, " ", &saveptr);
+            if (token)
+                bus->switchDebounce = atoi(token);
+        }
+        else if (strcmp(command, "COIN_STORE") == 0)
+        {
+            char *token = getNextToken(NULL, " ", &saveptr);
+            if (token)
+            {
+                strncpy(config->coinStorePath, token, MAX_PATH_LENGTH - 1);
+                config->coinStorePath[MAX_PATH_LENGTH - 1] = '\0';
+            }
+        }
+        else if (strcmp(command, "HOPPER_RATE") == 0)
+        {
+            char *token = getNextToken(NULL, " ", &saveptr);
+            if (token)
+                config->hopperRate = atoi(token);
+        }
+        else if (strcmp(command, "GUN_FILTER") == 0)
+        {
+            char *type = getNextToken(NULL, " ", &saveptr);
+            if (!type)
+                continue;
+
+            /* The EMA takes a time constant in milliseconds, the One Euro filter a minimum cutoff in Hz and a beta */
+            char *first = getNextToken(NULL, " ", &saveptr);
+            char *second = getNextToken(NULL, " ", &saveptr);
+            config->gunFilter.type = gunFilterFromString(type);
+            if (config->gunFilter.type == GUN_FILTER_EMA && first && atof(first) > 0)
+                config->gunFilter.timeConstant = atof(first);
+            if (config->gunFilter.type == GUN_FILTER_ONE_EURO && first && atof(first) > 0)
+                config->gunFilter.minCutoff = atof(first);
+            if (config->gunFilter.type == GUN_FILTER_ONE_EURO && second && atof(second) >= 0)
+                config->gunFilter.beta = atof(second);
+        }
         else if (strcmp(command, "AUTO_CONTROLLER_DETECTION") == 0)
         {
             char *token = getNextToken(NULL, " ", &saveptr);
@@ -175,6 +399,134 @@ JVSConfigStatus parseConfig(char *path, JVSConfig *config)
     return JVS_CONFIG_STATUS_SUCCESS;
 }
 
+/**
+ * Parse the FILTER on an axis in a device mapping
+ *
+ * FILTER ema [strength], FILTER median [window] or
+ * FILTER one-euro [min cutoff Hz] [beta], each with a sensible default.
+ *
+ * @param filter The filter to fill in
+ * @param saveptr The tokeniser state, to read the filter from
+ * @returns The token after the filter's settings, for the caller to carry on with
+ */
+static char *parseAxisFilter(AxisFilterConfig *filter, char **saveptr)
+{
+    char *type = getNextToken(NULL, " ", saveptr);
+    if (!type)
+        return NULL;
+
+    filter->type = axisFilterFromString(type);
+    filter->strength = filter->type == AXIS_FILTER_MEDIAN ? DEFAULT_AXIS_FILTER_MEDIAN_WINDOW : DEFAULT_AXIS_FILTER_EMA_STRENGTH;
+    filter->minCutoff = DEFAULT_AXIS_FILTER_MIN_CUTOFF;
+    filter->beta = DEFAULT_AXIS_FILTER_BETA;
+
+    /* The settings are numbers, anything else is the next keyword such as REVERSE */
+    char *token = getNextToken(NULL, " ", saveptr);
+    for (int setting = 0; token && (isdigit((unsigned char)token[0]) || token[0] == '.'); setting++)
+    {
+        if (filter->type == AXIS_FILTER_ONE_EURO && setting == 0)
+            filter->minCutoff = atof(token) * 1000;
+        else if (filter->type == AXIS_FILTER_ONE_EURO && setting == 1)
+            filter->beta = atof(token) * 1000;
+        else if (setting == 0)
+            filter->strength = atoi(token);
+        token = getNextToken(NULL, " ", saveptr);
+    }
+
+    return token;
+}
+
+/**
+ * Parse the CURVE on an axis in a device or game mapping
+ *
+ * CURVE linear, CURVE exponential [power], CURVE s-curve [power] or
+ * CURVE points x,y [x,y ...] with each point from 0 to 1.
+ *
+ * @param curve The curve to fill in
+ * @param saveptr The tokeniser state, to read the curve from
+ * @returns The token after the curve's settings, for the caller to carry on with
+ */
+static char *parseCurve(ResponseCurve *curve, char **saveptr)
+{
+    char *type = getNextToken(NULL, " ", saveptr);
+    if (!type)
+        return NULL;
+
+    memset(curve, 0, sizeof(ResponseCurve));
+    curve->type = curveFromString(type);
+    curve->power = DEFAULT_CURVE_POWER;
+
+    /* The settings are numbers, anything else is the next keyword such as REVERSE */
+    char *token = getNextToken(NULL, " ", saveptr);
+    for (; token && (isdigit((unsigned char)token[0]) || token[0] == '.'); token = getNextToken(NULL, " ", saveptr))
+    {
+        if (curve->type != CURVE_POINTS)
+        {
+            if (atof(token) > 0)
+                curve->power = atof(token);
+            continue;
+        }
+
+        char *y = strchr(token, ',');
+        if (!y)
+        {
+            debug(0, "Error: Curve point %s should be x,y\n", token);
+            continue;
+        }
+
+        if (curve->length >= MAX_CURVE_POINTS)
+        {
+            debug(0, "Error: Only %d curve points are supported\n", MAX_CURVE_POINTS);
+            continue;
+        }
+
+        double pointX = atof(token), pointY = atof(y + 1);
+        pointX = pointX > 1 ? 1 : pointX < 0 ? 0 : pointX;
+        pointY = pointY > 1 ? 1 : pointY < 0 ? 0 : pointY;
+
+        /* Points have to go left to right */
+        if (curve->length > 0 && pointX * CURVE_ONE < curve->points[curve->length - 1][0])
+        {
+            debug(0, "Error: Curve point %s is out of order\n", token);
+            continue;
+        }
+
+        curve->points[curve->length][0] = pointX * CURVE_ONE + 0.5;
+        curve->points[curve->length][1] = pointY * CURVE_ONE + 0.5;
+        curve->length++;
+    }
+
+    return token;
+}
+
+/**
+ * Parse the three axes a motion sensor reports x, y and z on
+ *
+ * An axis can start with a - to turn it round, so the controller's own
+ * axes can be lined up with x to the right, y forwards and z up.
+ *
+ * @param codes The axes to fill in
+ * @param flips Which of them are turned round
+ * @param saveptr The tokeniser state, to read the axes from
+ * @returns 1 if all three axes were read, 0 if not
+ */
+static int parseMotionAxes(int codes[3], int flips[3], char **saveptr)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        char *token = getNextToken(NULL, " ", saveptr);
+        if (!token || !token[0])
+            return 0;
+
+        flips[i] = token[0] == '-';
+        codes[i] = evDevFromString(flips[i] ? token + 1 : token);
+        if (codes[i] < 0 || codes[i] >= ABS_CNT)
+            return 0;
+    }
+
+    return 1;
+}
+
 JVSConfigStatus parseInputMapping(char *path, InputMappings *inputMappings)
 {
     FILE *file;
@@ -191,6 +543,19 @@ JVSConfigStatus parseInputMapping(char *path, InputMappings *inputMappings)
 
     inputMappings->player = DEFAULT_PLAYER;
 
+    /* Motion sensors report like the DualShock 4 and DualSense unless MOTION_ACCEL and MOTION_GYRO say otherwise */
+    MotionMapping *motion = &inputMappings->motion;
+    memset(motion, 0, sizeof(MotionMapping));
+    motion->accel[0] = ABS_X;
+    motion->accel[1] = ABS_Z;
+    motion->accel[2] = ABS_Y;
+    motion->accelFlip[1] = 1;
+    motion->gyro[0] = ABS_RX;
+    motion->gyro[1] = ABS_RZ;
+    motion->gyro[2] = ABS_RY;
+    motion->gyroFlip[1] = 1;
+    motion->gain = DEFAULT_MOTION_GAIN;
+
     while (fgets(buffer, MAX_LINE_LENGTH, file))
     {
 
@@ -222,6 +587,168 @@ JVSConfigStatus parseInputMapping(char *path, InputMappings *inputMappings)
                 inputMappings->player = player;
             }
         }
+        else if (strcmp(command, "CHORD") == 0)
+        {
+            if (inputMappings->chordLength >= MAX_CHORDS)
+            {
+                debug(0, "Error: Only %d CHORD mappings are supported\n", MAX_CHORDS);
+                continue;
+            }
+
+            /* The keys come first and the input they press last */
+            ChordMapping chord = {0};
+            char *input = NULL;
+            char *token = getNextToken(NULL, " ", &saveptr);
+            for (; token && token[0]; token = getNextToken(NULL, " ", &saveptr))
+            {
+                if (strncmp(token, "CONTROLLER_", 11) == 0)
+                {
+                    input = token;
+                    break;
+                }
+
+                int code = evDevFromString(token);
+                if (code > 0 && code < KEY_CNT && chord.length < MAX_CHORD_KEYS)
+                    chord.codes[chord.length++] = code;
+            }
+
+            if (chord.length < 2 || !input)
+            {
+                debug(0, "Error: A CHORD needs at least 2 keys and an input\n");
+                continue;
+            }
+
+            chord.input = controllerInputFromString(input);
+
+            inputMappings->chords[inputMappings->chordLength++] = chord;
+        }
+        else if (strcmp(command, "SHIFT") == 0)
+        {
+            char *token = getNextToken(NULL, " ", &saveptr);
+            if (token)
+            {
+                int code = evDevFromString(token);
+                if (code > 0 && code < KEY_CNT)
+                    inputMappings->shiftCode = code;
+            }
+        }
+        else if (strcmp(command, "SHIFTED") == 0)
+        {
+            char *key = getNextToken(NULL, " ", &saveptr);
+            char *input = getNextToken(NULL, " ", &saveptr);
+            if (!key || !input)
+                continue;
+
+            if (inputMappings->shiftedLength >= MAX_SHIFTED)
+            {
+                debug(0, "Error: Only %d SHIFTED mappings are supported\n", MAX_SHIFTED);
+                continue;
+            }
+
+            int code = evDevFromString(key);
+            if (code <= 0 || code >= KEY_CNT)
+                continue;
+
+            ShiftedMapping shifted = {.code = code, .input = controllerInputFromString(input)};
+            inputMappings->shifted[inputMappings->shiftedLength++] = shifted;
+        }
+        else if (strcmp(command, "MACRO") == 0)
+        {
+            char *key = getNextToken(NULL, " ", &saveptr);
+            if (!key)
+                continue;
+
+            if (inputMappings->macroLength >= MAX_MACROS)
+            {
+                debug(0, "Error: Only %d MACRO mappings are supported\n", MAX_MACROS);
+                continue;
+            }
+
+            MacroMapping macro = {.code = evDevFromString(key)};
+            if (macro.code <= 0 || macro.code >= KEY_CNT)
+                continue;
+
+            /* Each input is held for the time after it, or a short press if there isn't one */
+            char *token = getNextToken(NULL, " ", &saveptr);
+            for (; token && token[0]; token = getNextToken(NULL, " ", &saveptr))
+            {
+                if (isdigit((unsigned char)token[0]))
+                {
+                    if (macro.length > 0 && atoi(token) > 0)
+                        macro.steps[macro.length - 1].duration = atoi(token);
+                    continue;
+                }
+
+                if (macro.length >= MAX_MACRO_STEPS)
+                {
+                    debug(0, "Error: Only %d steps are supported in a MACRO\n", MAX_MACRO_STEPS);
+                    break;
+                }
+
+                MacroStep step = {.input = controllerInputFromString(token), .duration = DEFAULT_MACRO_STEP};
+                macro.steps[macro.length++] = step;
+            }
+
+            if (macro.length > 0)
+                inputMappings->macros[inputMappings->macroLength++] = macro;
+        }
+        else if (strcmp(command, "MOTION_ACCEL") == 0)
+        {
+            if (!parseMotionAxes(motion->accel, motion->accelFlip, &saveptr))
+                debug(0, "Error: MOTION_ACCEL needs the x, y and z axes\n");
+        }
+        else if (strcmp(command, "MOTION_GYRO") == 0)
+        {
+            if (!parseMotionAxes(motion->gyro, motion->gyroFlip, &saveptr))
+            {
+                debug(0, "Error: MOTION_GYRO needs the x, y and z axes\n");
+                continue;
+            }
+
+            char *token = getNextToken(NULL, " ", &saveptr);
+            if (token && token[0])
+                motion->gyroResolution = atof(token);
+        }
+        else if (strcmp(command, "MOTION_GAIN") == 0)
+        {
+            char *token = getNextToken(NULL, " ", &saveptr);
+            if (token && atof(token) > 0)
+                motion->gain = atof(token);
+        }
+        else if (strcmp(command, "MOTION_ROLL") == 0 || strcmp(command, "MOTION_PITCH") == 0 || strcmp(command, "MOTION_YAW") == 0)
+        {
+            char *input = getNextToken(NULL, " ", &saveptr);
+            if (!input || !input[0])
+                continue;
+
+            MotionAxis axis = strcmp(command, "MOTION_ROLL") == 0 ? MOTION_ROLL : strcmp(command, "MOTION_PITCH") == 0 ? MOTION_PITCH : MOTION_YAW;
+            motion->enabled[axis] = 1;
+            motion->input[axis] = controllerInputFromString(input);
+            motion->range[axis] = DEFAULT_MOTION_RANGE;
+            motion->reverse[axis] = 0;
+            memset(&motion->curve[axis], 0, sizeof(ResponseCurve));
+
+            /* The tilt that sweeps the axis from the middle to one end comes first, then REVERSE and CURVE */
+            char *extra = getNextToken(NULL, " ", &saveptr);
+            while (extra != NULL)
+            {
+                if (isdigit((unsigned char)extra[0]))
+                {
+                    double range = atof(extra);
+                    motion->range[axis] = range < 1 ? 1 : range > MAX_MOTION_RANGE ? MAX_MOTION_RANGE : range;
+                }
+                else if (strcmp(extra, "REVERSE") == 0)
+                {
+                    motion->reverse[axis] = 1;
+                }
+                else if (strcmp(extra, "CURVE") == 0)
+                {
+                    extra = parseCurve(&motion->curve[axis], &saveptr);
+                    continue;
+                }
+                extra = getNextToken(NULL, " ", &saveptr);
+            }
+        }
         else if (command[0] == 'K' || command[0] == 'B' || command[0] == 'C')
         {
             char *token = getNextToken(NULL, " ", &saveptr);
@@ -285,6 +812,16 @@ JVSConfigStatus parseInputMapping(char *path, InputMappings *inputMappings)
                         if (token)
                             analogueMapping.multiplier = atof(token);
                     }
+                    else if (strcmp(extra, "FILTER") == 0)
+                    {
+                        extra = parseAxisFilter(&analogueMapping.filter, &saveptr);
+                        continue;
+                    }
+                    else if (strcmp(extra, "CURVE") == 0)
+                    {
+                        extra = parseCurve(&analogueMapping.curve, &saveptr);
+                        continue;
+                    }
                     extra = getNextToken(NULL, " ", &saveptr);
                 }
 
@@ -324,6 +861,12 @@ JVSConfigStatus parseInputMapping(char *path, InputMappings *inputMappings)
                     if (token)
                         analogueMapping.multiplier = atof(token);
                 }
+                else if (strcmp(extra, "ACCELERATION") == 0)
+                {
+                    char *token = getNextToken(NULL, " ", &saveptr);
+                    if (token)
+                        analogueMapping.acceleration = atof(token);
+                }
                 extra = getNextToken(NULL, " ", &saveptr);
             }
 
@@ -411,7 +954,8 @@ JVSConfigStatus parseOutputMapping(char *path, OutputMappings *outputMappings, c
             char *token = getNextToken(NULL, " ", &saveptr);
             if (token)
             {
-                OutputMappings tempOutputMappings;
+                /* Start from what is mapped so far, so the included mappings add to them */
+                OutputMappings tempOutputMappings = *outputMappings;
                 JVSConfigStatus status = parseOutputMapping(token, &tempOutputMappings, configPath, secondConfigPath);
                 if (status == JVS_CONFIG_STATUS_SUCCESS)
                     memcpy(outputMappings, &tempOutputMappings, sizeof(OutputMappings));
@@ -435,6 +979,31 @@ JVSConfigStatus parseOutputMapping(char *path, OutputMappings *outputMappings, c
                 secondConfigPath[MAX_PATH_LENGTH - 1] = '\0';
             }
         }
+        else if (strcmp(command, "GPO_RUMBLE") == 0)
+        {
+            char *output = getNextToken(NULL, " ", &saveptr);
+            char *controller = getNextToken(NULL, " ", &saveptr);
+            if (!output || !controller)
+                continue;
+
+            if (outputMappings->rumbleLength >= MAX_RUMBLE_MAPPINGS)
+            {
+                debug(0, "Error: Only %d GPO_RUMBLE mappings are supported\n", MAX_RUMBLE_MAPPINGS);
+                continue;
+            }
+
+            /* The duration and strength are optional */
+            char *duration = getNextToken(NULL, " ", &saveptr);
+            char *strength = getNextToken(NULL, " ", &saveptr);
+            RumbleMapping mapping = {
+                .controllerPlayer = controllerPlayerFromString(controller),
+                .output = atoi(output),
+                .secondaryIO = secondaryIO,
+                .duration = (duration && duration[0]) ? atoi(duration) : DEFAULT_RUMBLE_DURATION,
+                .strength = (strength && strength[0]) ? atoi(strength) : DEFAULT_RUMBLE_STRENGTH};
+
+            outputMappings->rumble[outputMappings->rumbleLength++] = mapping;
+        }
         else if (command[11] == 'B' || analogueToDigital)
         {
             char *token1 = getNextToken(NULL, " ", &saveptr);
@@ -475,11 +1044,20 @@ JVSConfigStatus parseOutputMapping(char *path, OutputMappings *outputMappings, c
                 .output = jvsInputFromString(token2),
                 .secondaryIO = secondaryIO};
 
-            /* Check to see if we should reverse */
-            char *reverse = getNextToken(NULL, " ", &saveptr);
-            if (reverse != NULL && strcmp(reverse, "REVERSE") == 0)
+            /* Check to see if we should reverse or shape the axis */
+            char *extra = getNextToken(NULL, " ", &saveptr);
+            while (extra != NULL)
             {
-                mapping.reverse = 1;
+                if (strcmp(extra, "REVERSE") == 0)
+                {
+                    mapping.reverse = 1;
+                }
+                else if (strcmp(extra, "CURVE") == 0)
+                {
+                    extra = parseCurve(&mapping.curve, &saveptr);
+                    continue;
+                }
+                extra = getNextToken(NULL, " ", &saveptr);
             }
 
             outputMappings->mappings[outputMappings->length] = mapping;
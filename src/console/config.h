@@ -2,6 +2,7 @@
 #define CONFIG_H_
 
 #include "controller/input.h"
+#include "ffb/ffb.h"
 
 /* Default config values */
 #define DEFAULT_CONFIG_PATH "/etc/modernjvs/config"
@@ -13,9 +14,17 @@
 #define DEFAULT_IO "namco-FCA1"
 #define DEFAULT_IO_PATH "/etc/modernjvs/ios/"
 #define DEFAULT_ROTARY_PATH "/etc/modernjvs/rotary"
+#define DEFAULT_COIN_STORE_PATH "/var/lib/modernjvs/coins"
+#define DEFAULT_HOPPER_RATE 10
+#define DEFAULT_GUN_FILTER_TIME_CONSTANT 8.0
+#define DEFAULT_GUN_FILTER_MIN_CUTOFF 1.0
+#define DEFAULT_GUN_FILTER_BETA 5.0
 #define DEFAULT_SENSE_LINE_PIN 12
 #define DEFAULT_SENSE_LINE_TYPE 0
 #define DEFAULT_AUTO_CONTROLLER_DETECTION 1
+#define DEFAULT_LOW_LATENCY 1
+#define DEFAULT_LATENCY_PROBE 0
+#define DEFAULT_SWITCH_DEBOUNCE 0
 #define DEFAULT_PLAYER -1
 #define DEFAULT_ANALOG_DEADZONE 0.0
 #define MAX_ANALOG_DEADZONE 0.5
@@ -24,21 +33,71 @@
 #define MAX_PATH_LENGTH 1024
 #define MAX_LINE_LENGTH 1024
 #define MAX_ROTARY_POSITIONS 16  /* Rotary encoder supports 16 positions (0-15) */
+#define MAX_JVS_BUSES 4
+#define MAX_BUS_INPUTS 8
+#define MAX_OUTPUT_SINKS 8
+#define MAX_OUTPUT_SINK_TYPE 16
+#define MAX_TURBO_SWITCHES 16
 
+/* A GPO_SINK line, which sends a range of GPO bits from one board to an output device */
+typedef struct
+{
+    char type[MAX_OUTPUT_SINK_TYPE];
+    char target[MAX_PATH_LENGTH];
+    int board;
+    int firstBit;
+    int lastBit;
+    int minInterval;
+} OutputSinkConfig;
+
+/* A TURBO line, which makes a switch fire repeatedly while it is held */
+typedef struct
+{
+    JVSInput input;
+    JVSPlayer player;
+    int rate;
+    int secondaryIO;
+} TurboConfig;
+
+/* Settings for a single RS485 bus, the first bus is the one set at the top of the config */
 typedef struct
 {
     int senseLineType;
     int senseLinePin;
+    int lowLatency;
+    int latencyProbe;
+    int switchDebounce;
     char defaultGamePath[MAX_PATH_LENGTH];
     char devicePath[MAX_PATH_LENGTH];
-    int debugLevel;
     char capabilitiesPath[MAX_PATH_LENGTH];
     char secondCapabilitiesPath[MAX_PATH_LENGTH];
+    char inputDevices[MAX_BUS_INPUTS][MAX_PATH_LENGTH];
+    int inputDeviceCount;
+    OutputSinkConfig outputSinks[MAX_OUTPUT_SINKS];
+    int outputSinkCount;
+    char ffbDevicePath[MAX_PATH_LENGTH];
+    FFBEffectType ffbChannels[FFB_MAX_CHANNELS];
+    FFBEmulationType ffbDriveBoard;
+    char ffbDriveBoardPath[MAX_PATH_LENGTH];
+    GPIOInputConfig gpioInputs[MAX_GPIO_INPUTS];
+    int gpioInputCount;
+    TurboConfig turbo[MAX_TURBO_SWITCHES];
+    int turboCount;
+} JVSBusConfig;
+
+typedef struct
+{
+    JVSBusConfig buses[MAX_JVS_BUSES];
+    int busCount;
+    int debugLevel;
     int autoControllerDetection;
     double analogDeadzonePlayer1;
     double analogDeadzonePlayer2;
     double analogDeadzonePlayer3;
     double analogDeadzonePlayer4;
+    char coinStorePath[MAX_PATH_LENGTH];
+    int hopperRate;
+    GunFilterConfig gunFilter;
 } JVSConfig;
 
 typedef enum
@@ -50,6 +109,7 @@ typedef enum
 } JVSConfigStatus;
 
 JVSConfigStatus getDefaultConfig(JVSConfig *config);
+JVSConfigStatus getDefaultBusConfig(JVSBusConfig *bus);
 JVSConfigStatus parseConfig(char *path, JVSConfig *config);
 JVSConfigStatus parseInputMapping(char *path, InputMappings *inputMappings);
 JVSConfigStatus parseOutputMapping(char *path, OutputMappings *outputMappings, char *configPath, char* secondConfigPath);
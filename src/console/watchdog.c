@@ -12,11 +12,13 @@
 
 // Poll rotary every one second
 #define TIME_POLL_ROTARY 1
+#define TIME_POLL_STEPS 20
 
 typedef struct
 {
     volatile int *running;
     JVSRotaryStatus rotaryStatus;
+    void (*wake)(void);
 
 } WatchdogThreadArguments;
 
@@ -38,6 +40,7 @@ static void *watchdogThread(void *_args)
         if ((args->rotaryStatus == JVS_ROTARY_STATUS_SUCCESS) && (rotaryValue != getRotaryValue()))
         {
             *args->running = 0;
+            args->wake();
             break;
         }
 
@@ -49,9 +52,13 @@ static void *watchdogThread(void *_args)
         if ((currentDeviceCount == -1) || (currentDeviceCount != originalDevicesCount))
         {
             *args->running = 0;
+            args->wake();
             break;
         }
-        sleep(TIME_POLL_ROTARY);
+
+        // Sleep in short steps so stopping the threads isn't held up by us
+        for (int i = 0; i < TIME_POLL_STEPS && getThreadsRunning(); i++)
+            usleep(TIME_POLL_ROTARY * 1000000 / TIME_POLL_STEPS);
     }
 
     if (_args != NULL)
@@ -63,7 +70,7 @@ static void *watchdogThread(void *_args)
     return 0;
 }
 
-WatchdogStatus initWatchdog(volatile int *running, JVSRotaryStatus rotaryStatus)
+WatchdogStatus initWatchdog(volatile int *running, JVSRotaryStatus rotaryStatus, void (*wake)(void))
 {
     WatchdogThreadArguments *args = malloc(sizeof(WatchdogThreadArguments));
     if (args == NULL)
@@ -74,6 +81,7 @@ WatchdogStatus initWatchdog(volatile int *running, JVSRotaryStatus rotaryStatus)
     
     args->running = running;
     args->rotaryStatus = rotaryStatus;
+    args->wake = wake;
 
     if (THREAD_STATUS_SUCCESS != createThread(watchdogThread, args))
     {
@@ -9,6 +9,6 @@ typedef enum
     WATCHDOG_STATUS_ERROR
 } WatchdogStatus;
 
-WatchdogStatus initWatchdog(volatile int *running, JVSRotaryStatus rotaryStatus);
+WatchdogStatus initWatchdog(volatile int *running, JVSRotaryStatus rotaryStatus, void (*wake)(void));
 
 #endif // WATCHDOG_H_
@@ -0,0 +1,133 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "controller/curve.h"
+#include "console/debug.h"
+
+/* Lookups keep 8 bits of the position between two entries to interpolate with */
+#define CURVE_FRACTION_BITS 8
+
+static double pointCurve(const ResponseCurve *curve, double value)
+{
+    double lastX = 0, lastY = 0;
+    for (int i = 0; i < curve->length; i++)
+    {
+        double x = (double)curve->points[i][0] / CURVE_ONE, y = (double)curve->points[i][1] / CURVE_ONE;
+        if (value <= x)
+            return x > lastX ? lastY + (y - lastY) * (value - lastX) / (x - lastX) : y;
+        lastX = x;
+        lastY = y;
+    }
+
+    /* Past the last point the curve carries on straight to the top corner */
+    return lastX < 1 ? lastY + (1 - lastY) * (value - lastX) / (1 - lastX) : lastY;
+}
+
+/**
+ * Shape an axis with a response curve
+ *
+ * An exponential curve makes the start of a pedal's travel finer. An
+ * S-curve does the same around the centre of a wheel or stick, bending
+ * both halves away from the middle. A point curve joins the given points
+ * with straight lines.
+ *
+ * @param curve The curve to apply
+ * @param value The axis from 0 to 1
+ * @returns The shaped axis from 0 to 1
+ */
+double applyCurve(const ResponseCurve *curve, double value)
+{
+    switch (curve->type)
+    {
+    case CURVE_EXPONENTIAL:
+        return pow(value, curve->power);
+    case CURVE_S_CURVE:
+    {
+        double centred = value * 2 - 1;
+        double shaped = pow(fabs(centred), curve->power);
+        return (centred < 0 ? -shaped : shaped) / 2 + 0.5;
+    }
+    case CURVE_POINTS:
+        return pointCurve(curve, value);
+    default:
+        return value;
+    }
+}
+
+CurveType curveFromString(const char *curveString)
+{
+    if (strcmp(curveString, "linear") == 0)
+        return CURVE_LINEAR;
+    if (strcmp(curveString, "exponential") == 0)
+        return CURVE_EXPONENTIAL;
+    if (strcmp(curveString, "s-curve") == 0)
+        return CURVE_S_CURVE;
+    if (strcmp(curveString, "points") == 0)
+        return CURVE_POINTS;
+
+    debug(0, "Error: Unknown curve %s, the axis will be linear\n", curveString);
+    return CURVE_LINEAR;
+}
+
+/**
+ * Bake an axis' response into a table
+ *
+ * The response is worked out once for each entry here, so the events
+ * themselves only need a lookup.
+ *
+ * @param table The table to build
+ * @param min The lowest value the axis reports
+ * @param max The highest value the axis reports
+ * @param response Works out the response from 0 to 1 for a value the axis reports
+ * @param context Passed on to the response
+ * @returns 1 on success, 0 if the table couldn't be allocated
+ */
+int buildAxisTable(AxisTable *table, int min, int max, double (*response)(void *context, double value), void *context)
+{
+    int range = max > min ? max - min : 1;
+
+    table->table = malloc(CURVE_TABLE_SIZE * sizeof(unsigned short));
+    if (!table->table)
+        return 0;
+
+    table->min = min;
+    table->scale = ((int64_t)(CURVE_TABLE_SIZE - 1) << (16 + CURVE_FRACTION_BITS)) / range;
+
+    for (int i = 0; i < CURVE_TABLE_SIZE; i++)
+    {
+        double value = response(context, min + (double)i * range / (CURVE_TABLE_SIZE - 1));
+        value = value > 1 ? 1 : value < 0 ? 0 : value;
+        table->table[i] = lround(value * CURVE_ONE);
+    }
+
+    return 1;
+}
+
+/**
+ * Look up an axis in its table
+ *
+ * @param table The table for the axis
+ * @param value The value the axis reports
+ * @returns The axis from 0 to CURVE_ONE
+ */
+unsigned short lookupAxisTable(const AxisTable *table, int value)
+{
+    int64_t position = ((int64_t)(value - table->min) * table->scale) >> 16;
+    if (position <= 0)
+        return table->table[0];
+
+    int index = position >> CURVE_FRACTION_BITS;
+    if (index >= CURVE_TABLE_SIZE - 1)
+        return table->table[CURVE_TABLE_SIZE - 1];
+
+    int fraction = position & ((1 << CURVE_FRACTION_BITS) - 1);
+    int low = table->table[index], high = table->table[index + 1];
+    return low + (((high - low) * fraction) >> CURVE_FRACTION_BITS);
+}
+
+void freeAxisTable(AxisTable *table)
+{
+    free(table->table);
+    table->table = NULL;
+}
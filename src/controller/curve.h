@@ -0,0 +1,45 @@
+#ifndef CURVE_H_
+#define CURVE_H_
+
+#include <stdint.h>
+
+/* Axes are looked up in a table of 4096 entries, interpolating between them */
+#define CURVE_TABLE_BITS 12
+#define CURVE_TABLE_SIZE (1 << CURVE_TABLE_BITS)
+#define CURVE_ONE 65535
+
+#define MAX_CURVE_POINTS 8
+#define DEFAULT_CURVE_POWER 2.0
+
+typedef enum
+{
+    CURVE_LINEAR,
+    CURVE_EXPONENTIAL,
+    CURVE_S_CURVE,
+    CURVE_POINTS
+} CurveType;
+
+/* A CURVE on an axis in a device or game mapping file, with points from 0 to CURVE_ONE */
+typedef struct
+{
+    unsigned char type;
+    unsigned char length;
+    float power;
+    unsigned short points[MAX_CURVE_POINTS][2];
+} ResponseCurve;
+
+/* An axis' whole response baked into a table, from what the device reports to 0 to CURVE_ONE */
+typedef struct
+{
+    unsigned short *table;
+    int min;
+    int64_t scale;
+} AxisTable;
+
+double applyCurve(const ResponseCurve *curve, double value);
+CurveType curveFromString(const char *curveString);
+int buildAxisTable(AxisTable *table, int min, int max, double (*response)(void *context, double value), void *context);
+unsigned short lookupAxisTable(const AxisTable *table, int value);
+void freeAxisTable(AxisTable *table);
+
+#endif // CURVE_H_
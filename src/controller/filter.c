@@ -0,0 +1,130 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "controller/filter.h"
+#include "console/debug.h"
+
+/* 1000000000 / 2 pi, to turn a cutoff in mHz into a time constant in microseconds */
+#define CUTOFF_TO_TAU 159154943LL
+
+/* Readings further apart than this are treated as the axis starting again */
+#define MAX_FILTER_GAP 1000000
+
+/* Keep the fixed point speed maths inside 64 bits, far beyond anything a real axis does */
+#define MAX_FILTER_SPEED (1LL << 40)
+#define MAX_FILTER_BETA 1000000
+
+/**
+ * Setup the filter for an axis
+ *
+ * @param filter The filter to setup
+ * @param config The filter from the device mapping
+ * @param min The lowest value the axis reports
+ * @param max The highest value the axis reports
+ */
+void initAxisFilter(AxisFilter *filter, const AxisFilterConfig *config, int min, int max)
+{
+    memset(filter, 0, sizeof(AxisFilter));
+    filter->config = *config;
+    filter->range = max > min ? max - min : 1;
+
+    if (filter->config.type == AXIS_FILTER_MEDIAN && (filter->config.strength < 1 || filter->config.strength > AXIS_FILTER_MEDIAN_MAX))
+        filter->config.strength = DEFAULT_AXIS_FILTER_MEDIAN_WINDOW;
+
+    if (filter->config.type == AXIS_FILTER_EMA && (filter->config.strength < 1 || filter->config.strength >= AXIS_FILTER_FRACTION_BITS))
+        filter->config.strength = DEFAULT_AXIS_FILTER_EMA_STRENGTH;
+
+    if (filter->config.beta < 0 || filter->config.beta > MAX_FILTER_BETA)
+        filter->config.beta = DEFAULT_AXIS_FILTER_BETA;
+}
+
+/* How much of a new reading a first order low pass with this cutoff takes after dt microseconds, in fixed point */
+static int64_t smoothing(int64_t cutoff, int64_t dt)
+{
+    int64_t tau = CUTOFF_TO_TAU / (cutoff > 0 ? cutoff : 1);
+    return (dt << AXIS_FILTER_FRACTION_BITS) / (dt + tau);
+}
+
+static int median(AxisFilter *filter, int value)
+{
+    filter->window[filter->windowNext] = value;
+    filter->windowNext = (filter->windowNext + 1) % filter->config.strength;
+    if (filter->windowLength < filter->config.strength)
+        filter->windowLength++;
+
+    /* The window is tiny, so an insertion sort of a copy is the quickest way to the middle */
+    int sorted[AXIS_FILTER_MEDIAN_MAX];
+    for (int i = 0; i < filter->windowLength; i++)
+    {
+        int j = i;
+        for (; j > 0 && sorted[j - 1] > filter->window[i]; j--)
+            sorted[j] = sorted[j - 1];
+        sorted[j] = filter->window[i];
+    }
+
+    return sorted[filter->windowLength / 2];
+}
+
+/**
+ * Filter a reading from an axis
+ *
+ * Everything is done in whole numbers in the axis' own units, with
+ * fractional bits kept between readings so slow moves aren't lost.
+ *
+ * @param filter The filter for the axis
+ * @param value The reading from the device
+ * @param time When the reading was taken, in microseconds
+ * @returns The filtered reading
+ */
+int filterAxis(AxisFilter *filter, int value, int64_t time)
+{
+    if (filter->config.type == AXIS_FILTER_NONE)
+        return value;
+
+    if (filter->config.type == AXIS_FILTER_MEDIAN)
+        return median(filter, value);
+
+    int64_t reading = (int64_t)value << AXIS_FILTER_FRACTION_BITS;
+    int64_t dt = time - filter->lastTime;
+    filter->lastTime = time;
+
+    if (!filter->primed || dt <= 0 || dt > MAX_FILTER_GAP)
+    {
+        filter->primed = 1;
+        filter->value = reading;
+        filter->speed = 0;
+        return value;
+    }
+
+    if (filter->config.type == AXIS_FILTER_EMA)
+    {
+        filter->value += (reading - filter->value) >> filter->config.strength;
+    }
+    else
+    {
+        /* The speed is in the axis' units a second, and opens the cutoff up as a fraction of the axis' travel */
+        int64_t speed = (reading - filter->value) * 1000000 / dt;
+        speed = speed > MAX_FILTER_SPEED ? MAX_FILTER_SPEED : speed < -MAX_FILTER_SPEED ? -MAX_FILTER_SPEED : speed;
+        filter->speed += (smoothing(AXIS_FILTER_SPEED_CUTOFF, dt) * (speed - filter->speed)) >> AXIS_FILTER_FRACTION_BITS;
+
+        int64_t cutoff = filter->config.minCutoff + ((filter->config.beta * (llabs(filter->speed) / filter->range)) >> AXIS_FILTER_FRACTION_BITS);
+        filter->value += (smoothing(cutoff, dt) * (reading - filter->value)) >> AXIS_FILTER_FRACTION_BITS;
+    }
+
+    return (filter->value + (1 << (AXIS_FILTER_FRACTION_BITS - 1))) >> AXIS_FILTER_FRACTION_BITS;
+}
+
+AxisFilterType axisFilterFromString(const char *axisFilterString)
+{
+    if (strcmp(axisFilterString, "none") == 0)
+        return AXIS_FILTER_NONE;
+    if (strcmp(axisFilterString, "ema") == 0)
+        return AXIS_FILTER_EMA;
+    if (strcmp(axisFilterString, "one-euro") == 0)
+        return AXIS_FILTER_ONE_EURO;
+    if (strcmp(axisFilterString, "median") == 0)
+        return AXIS_FILTER_MEDIAN;
+
+    debug(0, "Error: Unknown axis filter %s, the axis will not be filtered\n", axisFilterString);
+    return AXIS_FILTER_NONE;
+}
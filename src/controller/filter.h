@@ -0,0 +1,52 @@
+#ifndef FILTER_H_
+#define FILTER_H_
+
+#include <stdint.h>
+
+/* Filtered values carry this many fractional bits between readings */
+#define AXIS_FILTER_FRACTION_BITS 16
+
+#define AXIS_FILTER_MEDIAN_MAX 7
+#define DEFAULT_AXIS_FILTER_EMA_STRENGTH 2
+#define DEFAULT_AXIS_FILTER_MEDIAN_WINDOW 3
+#define DEFAULT_AXIS_FILTER_MIN_CUTOFF 1000 // mHz
+#define DEFAULT_AXIS_FILTER_BETA 5000       // thousandths
+
+/* The cutoff the One Euro filter smooths its speed estimate with, in mHz */
+#define AXIS_FILTER_SPEED_CUTOFF 1000
+
+typedef enum
+{
+    AXIS_FILTER_NONE,
+    AXIS_FILTER_EMA,
+    AXIS_FILTER_ONE_EURO,
+    AXIS_FILTER_MEDIAN
+} AxisFilterType;
+
+/* A FILTER on an axis in a device mapping file */
+typedef struct
+{
+    AxisFilterType type;
+    int strength;  // EMA, each reading moves the axis 1/2^strength of the way, or the median window
+    int minCutoff; // One Euro, in mHz
+    int beta;      // One Euro, in thousandths of a Hz for each full travel of the axis a second
+} AxisFilterConfig;
+
+typedef struct
+{
+    AxisFilterConfig config;
+    int range;
+    int primed;
+    int64_t value;
+    int64_t speed;
+    int64_t lastTime;
+    int window[AXIS_FILTER_MEDIAN_MAX];
+    int windowLength;
+    int windowNext;
+} AxisFilter;
+
+void initAxisFilter(AxisFilter *filter, const AxisFilterConfig *config, int min, int max);
+int filterAxis(AxisFilter *filter, int value, int64_t time);
+AxisFilterType axisFilterFromString(const char *axisFilterString);
+
+#endif // FILTER_H_
@@ -0,0 +1,378 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "controller/gun.h"
+#include "console/debug.h"
+
+void initGunFilter(GunFilter *filter, const GunFilterConfig *config)
+{
+    filter->config = *config;
+    resetGunFilter(filter);
+}
+
+/**
+ * Forget where the gun was
+ *
+ * Called when the gun leaves the screen, so it comes back where it
+ * points rather than sliding over from where it left.
+ *
+ * @param filter The filter to reset
+ */
+void resetGunFilter(GunFilter *filter)
+{
+    filter->primed = 0;
+    filter->speedX = 0;
+    filter->speedY = 0;
+}
+
+/* How much of a new sample a first order low pass with this cutoff takes after dt seconds */
+static double smoothing(double cutoff, double dt)
+{
+    double tau = 1.0 / (2 * M_PI * cutoff);
+    return 1.0 / (1.0 + tau / dt);
+}
+
+/**
+ * Take the jitter out of a gun position
+ *
+ * The EMA filter trades a fixed delay for smoothness. The One Euro
+ * filter smooths hard while the gun is held still and opens up as it
+ * moves, so a fast swing isn't left behind.
+ *
+ * @param filter The filter for the gun
+ * @param time When the position was read, in seconds
+ * @param x The X position, replaced with the filtered one
+ * @param y The Y position, replaced with the filtered one
+ */
+void filterGunPosition(GunFilter *filter, double time, double *x, double *y)
+{
+    if (filter->config.type == GUN_FILTER_NONE)
+        return;
+
+    double dt = time - filter->lastTime;
+    filter->lastTime = time;
+
+    if (!filter->primed || dt <= 0)
+    {
+        filter->primed = 1;
+        filter->x = *x;
+        filter->y = *y;
+        return;
+    }
+
+    double alphaX, alphaY;
+    if (filter->config.type == GUN_FILTER_EMA)
+    {
+        alphaX = alphaY = 1.0 - exp(-dt * 1000.0 / filter->config.timeConstant);
+    }
+    else
+    {
+        double speed = smoothing(GUN_FILTER_SPEED_CUTOFF, dt);
+        filter->speedX += speed * ((*x - filter->x) / dt - filter->speedX);
+        filter->speedY += speed * ((*y - filter->y) / dt - filter->speedY);
+        alphaX = smoothing(filter->config.minCutoff + filter->config.beta * fabs(filter->speedX), dt);
+        alphaY = smoothing(filter->config.minCutoff + filter->config.beta * fabs(filter->speedY), dt);
+    }
+
+    filter->x += alphaX * (*x - filter->x);
+    filter->y += alphaY * (*y - filter->y);
+    *x = filter->x;
+    *y = filter->y;
+}
+
+/**
+ * Work out where a Wii Remote points from its two IR points
+ *
+ * The midpoint of the two points is rotated about the centre of the
+ * camera by the roll of the remote. The rotation comes from the line
+ * between the points directly, rather than through its angle, so no
+ * trigonometry is needed.
+ *
+ * @param x0 The X of the first point
+ * @param y0 The Y of the first point
+ * @param x1 The X of the second point
+ * @param y1 The Y of the second point
+ * @param x Set to the X position, from 0 to 1 across the screen
+ * @param y Set to the Y position, from 0 to 1 up the screen
+ * @returns 1 if the remote can see both points, 0 otherwise
+ */
+int pointWiimote(int x0, int y0, int x1, int y1, double *x, double *y)
+{
+    if (x0 == WIIMOTE_IR_NONE || y0 == WIIMOTE_IR_NONE || x1 == WIIMOTE_IR_NONE || y1 == WIIMOTE_IR_NONE)
+        return 0;
+
+    /* Take the rightmost point first so the roll is the same whichever point the camera reports first */
+    int oneX = x0 > x1 ? x0 : x1, oneY = x0 > x1 ? y0 : y1;
+    int twoX = x0 > x1 ? x1 : x0, twoY = x0 > x1 ? y1 : y0;
+
+    double dx = twoX - oneX, dy = twoY - oneY;
+    double length = sqrt(dx * dx + dy * dy);
+    if (length == 0)
+        return 0;
+
+    double cosine = dx / length, sine = -dy / length;
+    double middleX = (oneX - twoX) / 2 + twoX - WIIMOTE_IR_CENTRE_X;
+    double middleY = (oneY - twoY) / 2 + twoY - WIIMOTE_IR_CENTRE_Y;
+
+    *x = (WIIMOTE_IR_CENTRE_X + cosine * middleX - sine * middleY) / WIIMOTE_IR_SCALE;
+    *y = 1.0 - (WIIMOTE_IR_CENTRE_Y + sine * middleX + cosine * middleY) / WIIMOTE_IR_SCALE;
+    return 1;
+}
+
+GunFilterType gunFilterFromString(const char *gunFilterString)
+{
+    if (strcmp(gunFilterString, "none") == 0)
+        return GUN_FILTER_NONE;
+    if (strcmp(gunFilterString, "ema") == 0)
+        return GUN_FILTER_EMA;
+    if (strcmp(gunFilterString, "one-euro") == 0)
+        return GUN_FILTER_ONE_EURO;
+
+    debug(0, "Error: Unknown gun filter %s, the gun will not be filtered\n", gunFilterString);
+    return GUN_FILTER_NONE;
+}
+
+/* Solve a small linear system in place by Gaussian elimination, leaving the answer in the last column */
+static int solveLinear(double system[8][9], int size)
+{
+    for (int column = 0; column < size; column++)
+    {
+        int pivot = column;
+        for (int row = column + 1; row < size; row++)
+        {
+            if (fabs(system[row][column]) > fabs(system[pivot][column]))
+                pivot = row;
+        }
+
+        if (fabs(system[pivot][column]) < 1e-12)
+            return 0;
+
+        for (int i = 0; i <= size; i++)
+        {
+            double swap = system[column][i];
+            system[column][i] = system[pivot][i];
+            system[pivot][i] = swap;
+        }
+
+        for (int row = 0; row < size; row++)
+        {
+            if (row == column)
+                continue;
+            double factor = system[row][column] / system[column][column];
+            for (int i = column; i <= size; i++)
+                system[row][i] -= factor * system[column][i];
+        }
+    }
+
+    for (int row = 0; row < size; row++)
+        system[row][size] /= system[row][row];
+    return 1;
+}
+
+/**
+ * Work out the transform that takes captured corners to the corners of the screen
+ *
+ * The corners are captured top left, top right, bottom right then bottom
+ * left, in the device's own units. Each corner is sent to whichever of 0
+ * and the maximum the device already runs towards, so a game that sets
+ * REVERSE on an axis still gets what it expects.
+ *
+ * A projective transform goes exactly through all four corners, which
+ * takes out the keystone of a camera looking at the screen off centre.
+ * An affine transform is the best fit that keeps parallel edges parallel.
+ *
+ * @param calibration The calibration to fill in
+ * @param corners The captured corners
+ * @param type The kind of transform to fit
+ * @returns 1 on success, 0 if the corners don't make a usable shape
+ */
+int solveGunCalibration(GunCalibration *calibration, int corners[GUN_CALIBRATION_CORNERS][2], GunCalibrationType type)
+{
+    int flipX = corners[1][0] + corners[2][0] < corners[0][0] + corners[3][0];
+    int flipY = corners[2][1] + corners[3][1] < corners[0][1] + corners[1][1];
+    double targets[GUN_CALIBRATION_CORNERS][2] = {{flipX, flipY}, {!flipX, flipY}, {!flipX, !flipY}, {flipX, !flipY}};
+    double transform[9] = {0};
+    double system[8][9] = {{0}};
+
+    if (type == GUN_CALIBRATION_PROJECTIVE)
+    {
+        for (int i = 0; i < GUN_CALIBRATION_CORNERS; i++)
+        {
+            double x = corners[i][0], y = corners[i][1], u = targets[i][0], v = targets[i][1];
+            double rowU[9] = {x, y, 1, 0, 0, 0, -x * u, -y * u, u};
+            double rowV[9] = {0, 0, 0, x, y, 1, -x * v, -y * v, v};
+            memcpy(system[i * 2], rowU, sizeof(rowU));
+            memcpy(system[i * 2 + 1], rowV, sizeof(rowV));
+        }
+
+        if (!solveLinear(system, 8))
+            return 0;
+
+        for (int i = 0; i < 8; i++)
+            transform[i] = system[i][8];
+        transform[8] = 1;
+    }
+    else
+    {
+        /* Least squares through the normal equations, once for each axis */
+        for (int axis = 0; axis < 2; axis++)
+        {
+            memset(system, 0, sizeof(system));
+            for (int i = 0; i < GUN_CALIBRATION_CORNERS; i++)
+            {
+                double point[3] = {corners[i][0], corners[i][1], 1};
+                for (int row = 0; row < 3; row++)
+                {
+                    for (int column = 0; column < 3; column++)
+                        system[row][column] += point[row] * point[column];
+                    system[row][3] += point[row] * targets[i][axis];
+                }
+            }
+
+            if (!solveLinear(system, 3))
+                return 0;
+
+            for (int i = 0; i < 3; i++)
+                transform[axis * 3 + i] = system[i][3];
+        }
+        transform[8] = 1;
+    }
+
+    for (int i = 0; i < 9; i++)
+        calibration->matrix[i] = llround(ldexp(transform[i], GUN_CALIBRATION_SHIFT));
+    calibration->projective = calibration->matrix[6] != 0 || calibration->matrix[7] != 0;
+    calibration->valid = 1;
+    return 1;
+}
+
+static int clampPosition(int64_t position)
+{
+    return position < 0 ? 0 : position > GUN_POSITION_MAX ? GUN_POSITION_MAX : (int)position;
+}
+
+/**
+ * Move a position from the device's own units onto the screen
+ *
+ * This is a single fixed point matrix multiply, plus one division for
+ * each axis when the transform is projective.
+ *
+ * @param calibration The calibration for the device
+ * @param rawX The X position as the device reports it
+ * @param rawY The Y position as the device reports it
+ * @param x Set to the X position from 0 to GUN_POSITION_MAX
+ * @param y Set to the Y position from 0 to GUN_POSITION_MAX
+ * @returns 1 if the position is on the screen, 0 if it had to be clamped to the edge
+ */
+int applyGunCalibration(const GunCalibration *calibration, int rawX, int rawY, int *x, int *y)
+{
+    const int64_t *matrix = calibration->matrix;
+    int64_t u = matrix[0] * rawX + matrix[1] * rawY + matrix[2];
+    int64_t v = matrix[3] * rawX + matrix[4] * rawY + matrix[5];
+
+    if (calibration->projective)
+    {
+        int64_t w = matrix[6] * rawX + matrix[7] * rawY + matrix[8];
+        if (w <= 0)
+        {
+            *x = *y = 0;
+            return 0;
+        }
+        u = u * GUN_POSITION_MAX / w;
+        v = v * GUN_POSITION_MAX / w;
+    }
+    else
+    {
+        u = (u * GUN_POSITION_MAX) >> GUN_CALIBRATION_SHIFT;
+        v = (v * GUN_POSITION_MAX) >> GUN_CALIBRATION_SHIFT;
+    }
+
+    *x = clampPosition(u);
+    *y = clampPosition(v);
+    return *x == u && *y == v;
+}
+
+static int calibrationPath(char *path, size_t size, const char *deviceName)
+{
+    int length = snprintf(path, size, "%s%s", GUN_CALIBRATION_PATH, deviceName);
+    return length > 0 && (size_t)length < size;
+}
+
+/**
+ * Load the calibration saved for a device
+ *
+ * @param calibration The calibration to fill in, left invalid if there is none
+ * @param deviceName The name of the device, as used for its mapping file
+ * @returns 1 if a calibration was loaded, 0 otherwise
+ */
+int loadGunCalibration(GunCalibration *calibration, const char *deviceName)
+{
+    char path[1024], line[1024];
+    calibration->valid = 0;
+
+    if (!calibrationPath(path, sizeof(path), deviceName))
+        return 0;
+
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return 0;
+
+    while (fgets(line, sizeof(line), file))
+    {
+        if (strncmp(line, "TRANSFORM ", 10) != 0)
+            continue;
+
+        char *cursor = line + 10, *end;
+        int count = 0;
+        for (; count < 9; count++, cursor = end)
+        {
+            calibration->matrix[count] = strtoll(cursor, &end, 10);
+            if (end == cursor)
+                break;
+        }
+
+        if (count == 9)
+        {
+            calibration->projective = calibration->matrix[6] != 0 || calibration->matrix[7] != 0;
+            calibration->valid = 1;
+        }
+    }
+
+    fclose(file);
+
+    if (!calibration->valid)
+        debug(0, "Error: The gun calibration in %s is not valid\n", path);
+    return calibration->valid;
+}
+
+/**
+ * Save the calibration for a device
+ *
+ * @param calibration The calibration to save
+ * @param deviceName The name of the device, as used for its mapping file
+ * @param corners The corners it was worked out from, kept as a comment
+ * @returns 1 on success, 0 otherwise
+ */
+int saveGunCalibration(const GunCalibration *calibration, const char *deviceName, int corners[GUN_CALIBRATION_CORNERS][2])
+{
+    char path[1024];
+    if (!calibrationPath(path, sizeof(path), deviceName))
+        return 0;
+
+    mkdir(GUN_CALIBRATION_PATH, 0755);
+    FILE *file = fopen(path, "w");
+    if (!file)
+        return 0;
+
+    fprintf(file, "# Gun calibration for %s, written by modernjvs --calibrate\n", deviceName);
+    fprintf(file, "# Corners: %d,%d %d,%d %d,%d %d,%d\n", corners[0][0], corners[0][1], corners[1][0], corners[1][1],
+            corners[2][0], corners[2][1], corners[3][0], corners[3][1]);
+    fprintf(file, "TRANSFORM");
+    for (int i = 0; i < 9; i++)
+        fprintf(file, " %lld", (long long)calibration->matrix[i]);
+    fprintf(file, "\n");
+
+    return fclose(file) == 0;
+}
@@ -0,0 +1,76 @@
+#ifndef GUN_H_
+#define GUN_H_
+
+#include <stdint.h>
+
+/* The IR camera of a Wii Remote reports its two points on a 1024x768 grid */
+#define WIIMOTE_IR_CENTRE_X 512
+#define WIIMOTE_IR_CENTRE_Y 384
+#define WIIMOTE_IR_SCALE 1023
+#define WIIMOTE_IR_NONE 1023
+
+/* Calibrations are kept per device, named like the device mapping files */
+#define GUN_CALIBRATION_PATH "/etc/modernjvs/calibration/"
+
+/* Calibrated positions run from 0 to GUN_POSITION_MAX, transforms carry 32 fractional bits */
+#define GUN_POSITION_MAX 65535
+#define GUN_CALIBRATION_SHIFT 32
+#define GUN_CALIBRATION_CORNERS 4
+
+/* The speed cutoff the One Euro filter smooths its speed estimate with, in Hz */
+#define GUN_FILTER_SPEED_CUTOFF 1.0
+
+typedef enum
+{
+    GUN_FILTER_NONE,
+    GUN_FILTER_EMA,
+    GUN_FILTER_ONE_EURO
+} GunFilterType;
+
+typedef struct
+{
+    GunFilterType type;
+    double timeConstant; // EMA, in milliseconds
+    double minCutoff;    // One Euro, in Hz
+    double beta;         // One Euro, how quickly the cutoff opens up as the gun moves
+} GunFilterConfig;
+
+typedef enum
+{
+    GUN_CALIBRATION_AFFINE,
+    GUN_CALIBRATION_PROJECTIVE
+} GunCalibrationType;
+
+/*
+ * A transform from a device's own coordinates to a position on the screen.
+ *
+ * The matrix is row major in fixed point. An affine transform has a zero
+ * bottom row apart from the last entry and needs no division to apply.
+ */
+typedef struct
+{
+    int valid;
+    int projective;
+    int64_t matrix[9];
+} GunCalibration;
+
+typedef struct
+{
+    GunFilterConfig config;
+    int primed;
+    double lastTime;
+    double x, y;
+    double speedX, speedY;
+} GunFilter;
+
+void initGunFilter(GunFilter *filter, const GunFilterConfig *config);
+void resetGunFilter(GunFilter *filter);
+void filterGunPosition(GunFilter *filter, double time, double *x, double *y);
+int pointWiimote(int x0, int y0, int x1, int y1, double *x, double *y);
+GunFilterType gunFilterFromString(const char *gunFilterString);
+int solveGunCalibration(GunCalibration *calibration, int corners[GUN_CALIBRATION_CORNERS][2], GunCalibrationType type);
+int applyGunCalibration(const GunCalibration *calibration, int rawX, int rawY, int *x, int *y);
+int loadGunCalibration(GunCalibration *calibration, const char *deviceName);
+int saveGunCalibration(const GunCalibration *calibration, const char *deviceName, int corners[GUN_CALIBRATION_CORNERS][2]);
+
+#endif // GUN_H_
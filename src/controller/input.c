@@ -18,11 +18,14 @@
 #include <stdbool.h>
 #include <sys/select.h>
 #include <math.h>
+#include <time.h>
 
 #include "controller/input.h"
 #include "console/debug.h"
 #include "console/config.h"
 #include "controller/threading.h"
+#include "hardware/device.h"
+#include "output/output.h"
 
 #define BITS_PER_LONG (sizeof(long) * 8)
 #define NBITS(x) ((((x)-1) / BITS_PER_LONG) + 1)
@@ -66,6 +69,12 @@ static const char *FILTERED_DEVICE_PATTERNS[] = {
     NULL  // Sentinel value to mark end of array
 };
 
+// Device name endings of motion sensors whose driver doesn't mark them as an accelerometer
+static const char *MOTION_DEVICE_SUFFIXES[] = {
+    " Motion Sensors", // DualShock 4 and DualSense
+    " Accelerometer",  // Wii Remote
+    NULL};
+
 typedef struct
 {
     ThreadSharedData *sharedData_p;
@@ -74,8 +83,59 @@ typedef struct
     EVInputs inputs;
     int player;
     double analogDeadzone;
+    GunFilterConfig gunFilter;
+    GunCalibration calibration;
+    AxisFilter absFilters[ABS_CNT];
+    AxisTable absTables[ABS_CNT];
+    RelativeAxis relAxes[REL_CNT];
+    int switchSource;
 } MappingThreadArguments;
 
+/**
+ * Set both axes of a gun at once
+ *
+ * The axes are written as one position when they belong to the same
+ * gun, so the game can't read X from one report and Y from the next.
+ */
+static void setGunAxes(JVSIO *io, JVSInput xChannel, double x, JVSInput yChannel, double y)
+{
+    if (xChannel % 2 == 0 && yChannel == xChannel + 1)
+    {
+        setGunPosition(io, xChannel / 2, x, y);
+        return;
+    }
+
+    setGun(io, xChannel, x);
+    setGun(io, yChannel, y);
+}
+
+/**
+ * Publish where a Wii Remote points
+ *
+ * The screen out button, analogue and gun channels are all written
+ * here together, once per report from the remote.
+ */
+static void publishWiimote(MappingThreadArguments *args, int onScreen, double x, double y)
+{
+    JVSInput xChannel = args->inputs.abs[ABS_X].output, yChannel = args->inputs.abs[ABS_Y].output;
+
+    if (onScreen)
+    {
+        x = args->inputs.abs[ABS_X].reverse ? 1 - x : x;
+        y = args->inputs.abs[ABS_Y].reverse ? 1 - y : y;
+    }
+    else
+    {
+        x = 0;
+        y = 0;
+    }
+
+    setSwitch(args->jvsIO, args->switchSource, args->player, args->inputs.key[KEY_O].output, !onScreen);
+    setAnalogue(args->jvsIO, xChannel, x);
+    setAnalogue(args->jvsIO, yChannel, y);
+    setGunAxes(args->jvsIO, xChannel, x, yChannel, y);
+}
+
 static void *wiiDeviceThread(void *_args)
 {
     MappingThreadArguments *args = (MappingThreadArguments *)_args;
@@ -87,12 +147,20 @@ static void *wiiDeviceThread(void *_args)
         return 0;
     }
 
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+
     struct input_event event;
     fd_set file_descriptor;
     struct timeval tv;
 
+    args->switchSource = claimSwitchSource();
+
     /* Wii Remote Variables */
     int x0 = 0, x1 = 0, y0 = 0, y1 = 0;
+    int moved = 0;
+    GunFilter filter;
+    initGunFilter(&filter, &args->gunFilter);
 
     while (getThreadsRunning())
     {
@@ -105,83 +173,60 @@ static void *wiiDeviceThread(void *_args)
         if (select(fd + 1, &file_descriptor, NULL, NULL, &tv) < 1)
             continue;
 
-        if (read(fd, &event, sizeof(event)) == sizeof(event))
+        while (read(fd, &event, sizeof(event)) == sizeof(event))
         {
             switch (event.type)
             {
             case EV_ABS:
             {
-                bool outOfBounds = true;
-                if (event.type == EV_ABS)
+                switch (event.code)
                 {
-                    switch (event.code)
-                    {
-                    case 16:
-                        x0 = event.value;
-                        break;
-                    case 17:
-                        y0 = event.value;
-                        break;
-                    case 18:
-                        x1 = event.value;
-                        break;
-                    case 19:
-                        y1 = event.value;
-                        break;
-                    }
+                case ABS_HAT0X:
+                    x0 = event.value;
+                    break;
+                case ABS_HAT0Y:
+                    y0 = event.value;
+                    break;
+                case ABS_HAT1X:
+                    x1 = event.value;
+                    break;
+                case ABS_HAT1Y:
+                    y1 = event.value;
+                    break;
+                default:
+                    continue;
                 }
+                moved = 1;
+            }
+            break;
 
-                if ((x0 != 1023) && (x1 != 1023) && (y0 != 1023) && (y1 != 1023))
-                {
-                    /* Set screen in player 1 */
-                    setSwitch(args->jvsIO, args->player, args->inputs.key[KEY_O].output, 0);
-                    int oneX, oneY, twoX, twoY;
-                    if (x0 > x1)
-                    {
-                        oneY = y0;
-                        oneX = x0;
-                        twoY = y1;
-                        twoX = x1;
-                    }
-                    else
-                    {
-                        oneY = y1;
-                        oneX = x1;
-                        twoY = y0;
-                        twoX = x0;
-                    }
-
-                    /* Use some fancy maths that I don't understand fully */
-                    double valuex = 512 + cos(atan2(twoY - oneY, twoX - oneX) * -1) * (((oneX - twoX) / 2 + twoX) - 512) - sin(atan2(twoY - oneY, twoX - oneX) * -1) * (((oneY - twoY) / 2 + twoY) - 384);
-                    double valuey = 384 + sin(atan2(twoY - oneY, twoX - oneX) * -1) * (((oneX - twoX) / 2 + twoX) - 512) + cos(atan2(twoY - oneY, twoX - oneX) * -1) * (((oneY - twoY) / 2 + twoY) - 384);
-
-                    double finalX = (((double)valuex / (double)1023) * 1.0);
-                    double finalY = 1.0f - ((double)valuey / (double)1023);
-
-                    // check for out-of-bound after rotation ..
-                    if ((!(finalX > 1.0f) || (finalY > 1.0f) || (finalX < 0) || (finalY < 0)))
-                    {
-                        setAnalogue(args->jvsIO, args->inputs.abs[ABS_X].output, args->inputs.abs[ABS_X].reverse ? 1 - finalX : finalX);
-                        setAnalogue(args->jvsIO, args->inputs.abs[ABS_Y].output, args->inputs.abs[ABS_Y].reverse ? 1 - finalY : finalY);
-                        setGun(args->jvsIO, args->inputs.abs[ABS_X].output, args->inputs.abs[ABS_X].reverse ? 1 - finalX : finalX);
-                        setGun(args->jvsIO, args->inputs.abs[ABS_Y].output, args->inputs.abs[ABS_Y].reverse ? 1 - finalY : finalY);
+            case EV_SYN:
+            {
+                /* The points of a frame arrive one axis at a time, so only work on them once they are all in */
+                if (event.code != SYN_REPORT || !moved)
+                    continue;
+                moved = 0;
 
-                        outOfBounds = false;
-                    }
+                double x, y;
+                int onScreen = pointWiimote(x0, y0, x1, y1, &x, &y);
+                if (onScreen && args->calibration.valid)
+                {
+                    int calibratedX, calibratedY;
+                    onScreen = applyGunCalibration(&args->calibration, x * GUN_POSITION_MAX, y * GUN_POSITION_MAX, &calibratedX, &calibratedY);
+                    x = (double)calibratedX / GUN_POSITION_MAX;
+                    y = (double)calibratedY / GUN_POSITION_MAX;
                 }
-
-                if (outOfBounds)
+                else if (onScreen)
                 {
-                    /* Set screen out player 1 */
-                    setSwitch(args->jvsIO, args->player, args->inputs.key[KEY_O].output, 1);
+                    onScreen = x >= 0 && x <= 1 && y >= 0 && y <= 1;
+                }
 
-                    setAnalogue(args->jvsIO, args->inputs.abs[ABS_X].output, 0);
-                    setAnalogue(args->jvsIO, args->inputs.abs[ABS_Y].output, 0);
+                if (onScreen)
+                    filterGunPosition(&filter, event.input_event_sec + event.input_event_usec / 1000000.0, &x, &y);
+                else
+                    resetGunFilter(&filter);
 
-                    setGun(args->jvsIO, args->inputs.abs[ABS_X].output, 0);
-                    setGun(args->jvsIO, args->inputs.abs[ABS_Y].output, 0);
-                }
-                continue;
+                publishWiimote(args, onScreen, x, y);
             }
             break;
             }
@@ -189,11 +234,312 @@ static void *wiiDeviceThread(void *_args)
     }
 
     close(fd);
+    releaseSwitchSource(args->jvsIO, args->switchSource);
     free(args);
 
     return 0;
 }
 
+/* Chords, the shift layer and macros a device thread has in progress */
+typedef struct
+{
+    unsigned int held;        // Combo keys held
+    unsigned int consumed;    // Combo keys taken by a chord, they stay quiet until let go
+    unsigned int pending;     // Chord keys waiting out the chord window before pressing their own input
+    int64_t pendingDeadline[MAX_COMBO_KEYS];
+    unsigned int chords;      // Chords pressed
+    int shifted;              // The shift key is held
+    unsigned int shiftedDown; // Keys pressed on the shift layer
+    unsigned int macrosRunning;
+    int macroPhase[MAX_MACROS]; // Even while a step is pressed, odd while it is let go before the next
+    int64_t macroDeadline[MAX_MACROS];
+} ComboState;
+
+static int64_t getMonotonicMicroseconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000LL + now.tv_nsec / 1000;
+}
+
+/**
+ * Press or release what a key is mapped to
+ *
+ * @param args The thread's arguments
+ * @param mapping What the key is mapped to
+ * @param value 1 for a press, 2 for a repeat and 0 for a release, as evdev reports them
+ */
+static void setKeyOutput(MappingThreadArguments *args, const OutputMapping *mapping, int value)
+{
+    JVSIO *io = args->jvsIO;
+    if (mapping->secondaryIO && args->jvsIO->chainedIO != NULL)
+        io = args->jvsIO->chainedIO;
+
+    /* Check if the coin button has been pressed */
+    if (mapping->output == COIN)
+    {
+        if (value == 1)
+            incrementCoin(io, mapping->jvsPlayer, 1);
+        return;
+    }
+
+    setSwitch(io, args->switchSource, mapping->jvsPlayer, mapping->output, value == 0 ? 0 : 1);
+
+    if (mapping->outputSecondary != NONE)
+        setSwitch(io, args->switchSource, mapping->jvsPlayer, mapping->outputSecondary, value == 0 ? 0 : 1);
+}
+
+/* Run a key through the shift layer, returns 1 if the key was used up there */
+static int handleShiftedKey(MappingThreadArguments *args, ComboState *combo, int code, int value)
+{
+    EVInputs *inputs = &args->inputs;
+    int shifted = inputs->keyShifted[code];
+    if (!shifted)
+        return 0;
+
+    unsigned int shiftedMask = 1u << (shifted - 1);
+    if (value == 1 && combo->shifted)
+    {
+        combo->shiftedDown |= shiftedMask;
+        setKeyOutput(args, &inputs->shifted[shifted - 1], 1);
+        return 1;
+    }
+
+    /* A key pressed on the shift layer is let go there too, even if the shift key went first */
+    if (combo->shiftedDown & shiftedMask)
+    {
+        if (value == 0)
+        {
+            combo->shiftedDown &= ~shiftedMask;
+            setKeyOutput(args, &inputs->shifted[shifted - 1], 0);
+        }
+        return 1;
+    }
+
+    return 0;
+}
+
+/* Press a chord key's own input, once it is clear it isn't starting a chord */
+static void pressChordKey(MappingThreadArguments *args, ComboState *combo, int code)
+{
+    if (!handleShiftedKey(args, combo, code, 1))
+        setKeyOutput(args, &args->inputs.key[code], 1);
+}
+
+/**
+ * Run a key through the chords, shift layer and macros
+ *
+ * A key that is part of a chord holds its own input back for the chord
+ * window. If the rest of a chord arrives in time the game only sees the
+ * chord, and the keys stay quiet until each is released. Otherwise the
+ * key's own input is pressed when the window runs out or the key is let
+ * go, whichever comes first.
+ *
+ * @param args The thread's arguments
+ * @param combo What is in progress
+ * @param code The key
+ * @param value As evdev reports it
+ * @returns 1 if the key was used up, 0 if it should press its own input
+ */
+static int handleComboKey(MappingThreadArguments *args, ComboState *combo, int code, int value)
+{
+    EVInputs *inputs = &args->inputs;
+    if (code <= 0 || code >= KEY_CNT)
+        return 0;
+
+    if (inputs->keyMacro[code])
+    {
+        int macro = inputs->keyMacro[code] - 1;
+        if (value == 1 && !(combo->macrosRunning & (1u << macro)))
+        {
+            combo->macrosRunning |= 1u << macro;
+            combo->macroPhase[macro] = 0;
+            combo->macroDeadline[macro] = getMonotonicMicroseconds() + inputs->macroDurations[macro][0] * 1000LL;
+            setKeyOutput(args, &inputs->macroSteps[macro][0], 1);
+        }
+        return 1;
+    }
+
+    if (code == inputs->shiftCode)
+    {
+        if (value != 2)
+            combo->shifted = value;
+        return 1;
+    }
+
+    int bit = inputs->keyBit[code];
+    if (bit != COMBO_KEY_NONE)
+    {
+        unsigned int keyMask = 1u << bit;
+        if (value == 2)
+            return ((combo->consumed | combo->pending) & keyMask) != 0;
+
+        if (value)
+        {
+            combo->held |= keyMask;
+            unsigned int candidates = inputs->keyChords[bit] & ~combo->chords;
+            for (int chord = 0; candidates; chord++, candidates >>= 1)
+            {
+                if (!(candidates & 1) || (combo->held & inputs->chordMasks[chord]) != inputs->chordMasks[chord])
+                    continue;
+
+                /* Keys that were held past the window have pressed their own input, which the chord takes over */
+                unsigned int release = inputs->chordMasks[chord] & ~combo->consumed & ~combo->pending & ~keyMask;
+                for (int other = 0; release; other++, release >>= 1)
+                    if (release & 1)
+                        setKeyOutput(args, &inputs->key[inputs->comboCodes[other]], 0);
+
+                combo->pending &= ~inputs->chordMasks[chord];
+                combo->consumed |= inputs->chordMasks[chord];
+                combo->chords |= 1u << chord;
+                setKeyOutput(args, &inputs->chords[chord], 1);
+            }
+
+            if (combo->consumed & keyMask)
+                return 1;
+
+            if (inputs->keyChords[bit])
+            {
+                combo->pending |= keyMask;
+                combo->pendingDeadline[bit] = getMonotonicMicroseconds() + DEFAULT_CHORD_WINDOW * 1000LL;
+                return 1;
+            }
+        }
+        else
+        {
+            combo->held &= ~keyMask;
+            unsigned int releasing = inputs->keyChords[bit] & combo->chords;
+            for (int chord = 0; releasing; chord++, releasing >>= 1)
+            {
+                if (!(releasing & 1))
+                    continue;
+                combo->chords &= ~(1u << chord);
+                setKeyOutput(args, &inputs->chords[chord], 0);
+            }
+
+            if (combo->consumed & keyMask)
+            {
+                combo->consumed &= ~keyMask;
+                return 1;
+            }
+
+            /* A tap shorter than the window still reaches the game, the press is latched until it is read */
+            if (combo->pending & keyMask)
+            {
+                combo->pending &= ~keyMask;
+                pressChordKey(args, combo, code);
+            }
+        }
+    }
+
+    return handleShiftedKey(args, combo, code, value);
+}
+
+/* Press the own inputs of chord keys that have been held alone for the whole chord window */
+static void runChordWindows(MappingThreadArguments *args, ComboState *combo)
+{
+    int64_t now = getMonotonicMicroseconds();
+    for (int bit = 0; bit < args->inputs.comboKeyLength; bit++)
+    {
+        if (!(combo->pending & (1u << bit)) || now < combo->pendingDeadline[bit])
+            continue;
+
+        combo->pending &= ~(1u << bit);
+        pressChordKey(args, combo, args->inputs.comboCodes[bit]);
+    }
+}
+
+/* Move the running macros on to their next step once the current one is done */
+static void runMacros(MappingThreadArguments *args, ComboState *combo)
+{
+    int64_t now = getMonotonicMicroseconds();
+    for (int macro = 0; macro < args->inputs.macroLength; macro++)
+    {
+        if (!(combo->macrosRunning & (1u << macro)) || now < combo->macroDeadline[macro])
+            continue;
+
+        int step = combo->macroPhase[macro] / 2;
+        if (combo->macroPhase[macro] % 2 == 0)
+            setKeyOutput(args, &args->inputs.macroSteps[macro][step], 0);
+        else if (step + 1 < args->inputs.macroLengths[macro])
+            setKeyOutput(args, &args->inputs.macroSteps[macro][step + 1], 1);
+
+        combo->macroPhase[macro]++;
+        step = combo->macroPhase[macro] / 2;
+        if (step >= args->inputs.macroLengths[macro])
+        {
+            combo->macrosRunning &= ~(1u << macro);
+            continue;
+        }
+
+        /* Each step is let go for as long as it was held, so the game sees it released before the next */
+        combo->macroDeadline[macro] = now + args->inputs.macroDurations[macro][step] * 1000LL;
+    }
+}
+
+/**
+ * Work out where an analogue axis is from what the device reports
+ *
+ * The device's sensitivity and limits, the deadzone, REVERSE and then the
+ * device and game CURVEs are applied in turn.
+ *
+ * @param args The thread's arguments
+ * @param code The axis
+ * @param value What the device reports
+ * @returns The axis from 0 to 1
+ */
+static double scaleAxis(MappingThreadArguments *args, int code, double value)
+{
+    double scaled = ((double)(value * (double)args->inputs.absMultiplier[code]) - args->inputs.absMin[code]) / (args->inputs.absMax[code] - args->inputs.absMin[code]);
+
+    /* Make sure it doesn't go over 1 or below 0 if its multiplied */
+    scaled = scaled > 1 ? 1 : scaled;
+    scaled = scaled < 0 ? 0 : scaled;
+
+    /* Apply deadzone to analog stick inputs (X and Y) for players 1-4 (if configured)
+     * Note: Triggers (Z, R, L, T) do not get deadzone applied */
+    if (args->analogDeadzone > 0 && args->analogDeadzone < MAX_ANALOG_DEADZONE &&
+        (args->player >= 1 && args->player <= 4) &&
+        args->inputs.abs[code].type == ANALOGUE &&
+        (args->inputs.abs[code].input == CONTROLLER_ANALOGUE_X ||
+         args->inputs.abs[code].input == CONTROLLER_ANALOGUE_Y))
+    {
+        /* Center the value around 0.5 */
+        double centered = scaled - ANALOG_CENTER_VALUE;
+        double magnitude = fabs(centered);
+
+        /* Apply deadzone: if within deadzone, set to center */
+        if (magnitude < args->analogDeadzone)
+        {
+            scaled = ANALOG_CENTER_VALUE;
+        }
+        else if (MAX_ANALOG_DEADZONE - args->analogDeadzone > MIN_DIVISION_THRESHOLD)
+        {
+            /* Scale the remaining range outside the deadzone (with safety check for division) */
+            double sign = (centered > 0) ? 1.0 : -1.0;
+            scaled = ANALOG_CENTER_VALUE + sign * ((magnitude - args->analogDeadzone) / (MAX_ANALOG_DEADZONE - args->analogDeadzone)) * ANALOG_CENTER_VALUE;
+        }
+    }
+
+    scaled = args->inputs.abs[code].reverse ? 1 - scaled : scaled;
+
+    if (code < ABS_CNT)
+        scaled = applyCurve(&args->inputs.absCurve[code], scaled);
+    return applyCurve(&args->inputs.abs[code].curve, scaled);
+}
+
+typedef struct
+{
+    MappingThreadArguments *args;
+    int code;
+} AxisResponse;
+
+static double axisResponse(void *context, double value)
+{
+    AxisResponse *response = (AxisResponse *)context;
+    return scaleAxis(response->args, response->code, value);
+}
+
 static void *deviceThread(void *_args)
 {
     MappingThreadArguments *args = (MappingThreadArguments *)_args;
@@ -211,6 +557,9 @@ static void *deviceThread(void *_args)
     int flags = fcntl(fd, F_GETFL, 0);
     fcntl(fd, F_SETFL, flags | O_NONBLOCK);
 
+    /* Buttons this device holds stay separate from other devices' until the game reads them */
+    args->switchSource = claimSwitchSource();
+
     uint8_t absoluteBitmask[ABS_MAX / 8 + 1];
     struct input_absinfo absoluteFeatures;
 
@@ -227,9 +576,46 @@ static void *deviceThread(void *_args)
 
             args->inputs.absMax[axisIndex] = (double)absoluteFeatures.maximum;
             args->inputs.absMin[axisIndex] = (double)absoluteFeatures.minimum;
+            initAxisFilter(&args->absFilters[axisIndex], &args->inputs.absFilter[axisIndex], absoluteFeatures.minimum, absoluteFeatures.maximum);
         }
     }
 
+    /* Each analogue axis' whole response is worked out up front, so an event is just a lookup */
+    memset(args->absTables, 0, sizeof(args->absTables));
+    for (int axisIndex = 0; axisIndex < ABS_MAX; ++axisIndex)
+    {
+        if (!test_bit(axisIndex, absoluteBitmask) || !args->inputs.absEnabled[axisIndex] || args->inputs.abs[axisIndex].type != ANALOGUE)
+            continue;
+
+        AxisResponse response = {.args = args, .code = axisIndex};
+        if (!buildAxisTable(&args->absTables[axisIndex], args->inputs.absMin[axisIndex], args->inputs.absMax[axisIndex], axisResponse, &response))
+            debug(0, "Warning: Failed to allocate the table for axis %d, it will be worked out as it moves\n", axisIndex);
+    }
+
+    /* Gun axes wait here for the end of the report, so a move lands as one position */
+    double gunAxes[JVS_MAX_GUNS * 2] = {0};
+    int gunRaw[JVS_MAX_GUNS * 2] = {0};
+    int gunReverse[JVS_MAX_GUNS * 2] = {0};
+    unsigned int gunsMoved = 0;
+
+    /* Relative axes add up here for the end of the report too, so a fast mouse writes once a report */
+    int relPending[REL_CNT] = {0};
+    int relPosition[REL_CNT];
+    unsigned int relMoved = 0;
+    for (int relIndex = 0; relIndex < REL_CNT; relIndex++)
+    {
+        double multiplier = args->inputs.relMultiplier[relIndex] * (args->inputs.rel[relIndex].reverse ? -1 : 1);
+        if (args->inputs.rel[relIndex].type == ANALOGUE)
+            multiplier *= (double)CURVE_ONE / RELATIVE_ANALOGUE_TRAVEL;
+        initRelativeAxis(&args->relAxes[relIndex], multiplier, args->inputs.relAcceleration[relIndex]);
+
+        /* A trackball moving an analogue channel starts in the middle */
+        relPosition[relIndex] = CURVE_ONE / 2;
+        if (args->inputs.relEnabled[relIndex] && args->inputs.rel[relIndex].type == ANALOGUE)
+            setAnalogueFixed(args->inputs.rel[relIndex].secondaryIO && args->jvsIO->chainedIO != NULL ? args->jvsIO->chainedIO : args->jvsIO,
+                             args->inputs.rel[relIndex].output, relPosition[relIndex]);
+    }
+
     /* Initialize analog axis values to their current hardware position
      * This includes analog sticks (X, Y) and triggers (Z, R, L, T) to ensure
      * racing games and other applications see correct values before first input event */
@@ -246,52 +632,32 @@ static void *deviceThread(void *_args)
                 continue;
 
             int currentValue = absoluteFeatures.value;
-
-            /* Apply the same scaling calculation as in the event loop */
-            double scaled = ((double)((double)currentValue * (double)args->inputs.absMultiplier[axisIndex]) - args->inputs.absMin[axisIndex]) / (args->inputs.absMax[axisIndex] - args->inputs.absMin[axisIndex]);
-
-            /* Clamp to [0, 1] range */
-            scaled = scaled > 1 ? 1 : scaled;
-            scaled = scaled < 0 ? 0 : scaled;
-
-            /* Apply deadzone logic to analog sticks only (same as in event loop)
-             * Note: Triggers (Z, R, L, T) do not get deadzone applied */
-            if (args->analogDeadzone > 0 && args->analogDeadzone < MAX_ANALOG_DEADZONE &&
-                (args->player >= 1 && args->player <= 4) &&
-                (args->inputs.abs[axisIndex].input == CONTROLLER_ANALOGUE_X || 
-                 args->inputs.abs[axisIndex].input == CONTROLLER_ANALOGUE_Y))
-            {
-                /* Center the value around 0.5 */
-                double centered = scaled - ANALOG_CENTER_VALUE;
-                double magnitude = fabs(centered);
-                
-                /* Apply deadzone: if within deadzone, set to center */
-                if (magnitude < args->analogDeadzone)
-                {
-                    scaled = ANALOG_CENTER_VALUE;
-                }
-                else if (MAX_ANALOG_DEADZONE - args->analogDeadzone > MIN_DIVISION_THRESHOLD)
-                {
-                    /* Scale the remaining range outside the deadzone */
-                    double sign = (centered > 0) ? 1.0 : -1.0;
-                    scaled = ANALOG_CENTER_VALUE + sign * ((magnitude - args->analogDeadzone) / (MAX_ANALOG_DEADZONE - args->analogDeadzone)) * ANALOG_CENTER_VALUE;
-                }
-            }
-
-            /* Apply reverse logic if configured */
-            double finalValue = args->inputs.abs[axisIndex].reverse ? 1 - scaled : scaled;
+            double finalValue = args->absTables[axisIndex].table ? (double)lookupAxisTable(&args->absTables[axisIndex], currentValue) / CURVE_ONE : scaleAxis(args, axisIndex, currentValue);
 
             /* Initialize the JVS state with the current hardware position */
             setAnalogue(args->jvsIO, args->inputs.abs[axisIndex].output, finalValue);
             setGun(args->jvsIO, args->inputs.abs[axisIndex].output, finalValue);
+            if (args->inputs.abs[axisIndex].output < JVS_MAX_GUNS * 2)
+            {
+                gunAxes[args->inputs.abs[axisIndex].output] = finalValue;
+                gunRaw[args->inputs.abs[axisIndex].output] = currentValue;
+                gunReverse[args->inputs.abs[axisIndex].output] = args->inputs.abs[axisIndex].reverse;
+            }
         }
     }
 
+    ComboState combo = {0};
+
     fd_set file_descriptor;
     struct timeval tv;
 
     while (getThreadsRunning())
     {
+        if (combo.macrosRunning)
+            runMacros(args, &combo);
+
+        if (combo.pending)
+            runChordWindows(args, &combo);
 
         FD_ZERO(&file_descriptor);
         FD_SET(fd, &file_descriptor);
@@ -309,42 +675,20 @@ static void *deviceThread(void *_args)
 
             case EV_KEY:
             {
-                JVSIO *io = args->jvsIO;
-                if (args->inputs.key[event.code].secondaryIO)
-                {
-                    io = args->jvsIO->chainedIO;
-                }
-
-                /* Check if the coin button has been pressed */
-                if (args->inputs.key[event.code].output == COIN)
-                {
-                    if (event.value == 1)
-                        incrementCoin(io, args->inputs.key[event.code].jvsPlayer, 1);
-
+                if (handleComboKey(args, &combo, event.code, event.value))
                     continue;
-                }
 
-                setSwitch(io, args->inputs.key[event.code].jvsPlayer, args->inputs.key[event.code].output, event.value == 0 ? 0 : 1);
-
-                if (args->inputs.key[event.code].outputSecondary != NONE)
-                    setSwitch(io, args->inputs.key[event.code].jvsPlayer, args->inputs.key[event.code].outputSecondary, event.value == 0 ? 0 : 1);
+                setKeyOutput(args, &args->inputs.key[event.code], event.value);
             }
             break;
 
             case EV_REL:
             {
-                JVSIO *io = args->jvsIO;
-
-                if (!args->inputs.relEnabled[event.code])
+                if (event.code >= REL_CNT || !args->inputs.relEnabled[event.code])
                     continue;
 
-                if (args->inputs.rel[event.code].secondaryIO && args->jvsIO->chainedIO != NULL)
-                    io = args->jvsIO->chainedIO;
-
-                int reverse = args->inputs.rel[event.code].reverse;
-
-                int oldRotaryValue = getRotary(io, args->inputs.rel[event.code].output);
-                setRotary(io, args->inputs.rel[event.code].output, oldRotaryValue + (reverse ? event.value * -1 : event.value));
+                relPending[event.code] += event.value;
+                relMoved |= 1 << event.code;
             }
             break;
 
@@ -356,16 +700,16 @@ static void *deviceThread(void *_args)
 
                     if (event.value == args->inputs.absMin[event.code])
                     {
-                        setSwitch(args->jvsIO, args->inputs.abs[event.code].jvsPlayer, args->inputs.abs[event.code].output, 1);
+                        setSwitch(args->jvsIO, args->switchSource, args->inputs.abs[event.code].jvsPlayer, args->inputs.abs[event.code].output, 1);
                     }
                     else if (event.value == args->inputs.absMax[event.code])
                     {
-                        setSwitch(args->jvsIO, args->inputs.abs[event.code].jvsPlayer, args->inputs.abs[event.code].outputSecondary, 1);
+                        setSwitch(args->jvsIO, args->switchSource, args->inputs.abs[event.code].jvsPlayer, args->inputs.abs[event.code].outputSecondary, 1);
                     }
                     else
                     {
-                        setSwitch(args->jvsIO, args->inputs.abs[event.code].jvsPlayer, args->inputs.abs[event.code].output, 0);
-                        setSwitch(args->jvsIO, args->inputs.abs[event.code].jvsPlayer, args->inputs.abs[event.code].outputSecondary, 0);
+                        setSwitch(args->jvsIO, args->switchSource, args->inputs.abs[event.code].jvsPlayer, args->inputs.abs[event.code].output, 0);
+                        setSwitch(args->jvsIO, args->switchSource, args->inputs.abs[event.code].jvsPlayer, args->inputs.abs[event.code].outputSecondary, 0);
                     }
                     continue;
                 }
@@ -385,11 +729,11 @@ static void *deviceThread(void *_args)
                     }
                     else if (event.value == args->inputs.absMin[event.code])
                     {
-                        setSwitch(args->jvsIO, args->inputs.key[event.code].jvsPlayer, args->inputs.key[event.code].output, 0);
+                        setSwitch(args->jvsIO, args->switchSource, args->inputs.key[event.code].jvsPlayer, args->inputs.key[event.code].output, 0);
                     }
                     else
                     {
-                        setSwitch(args->jvsIO, args->inputs.key[event.code].jvsPlayer, args->inputs.key[event.code].output, 1);
+                        setSwitch(args->jvsIO, args->switchSource, args->inputs.key[event.code].jvsPlayer, args->inputs.key[event.code].output, 1);
                     }
                     continue;
                 }
@@ -397,38 +741,83 @@ static void *deviceThread(void *_args)
                 /* Handle normally mapped analogue controls */
                 if (args->inputs.absEnabled[event.code])
                 {
-                    double scaled = ((double)((double)event.value * (double)args->inputs.absMultiplier[event.code]) - args->inputs.absMin[event.code]) / (args->inputs.absMax[event.code] - args->inputs.absMin[event.code]);
-
-                    /* Make sure it doesn't go over 1 or below 0 if its multiplied */
-                    scaled = scaled > 1 ? 1 : scaled;
-                    scaled = scaled < 0 ? 0 : scaled;
-
-                    /* Apply deadzone to analog stick inputs (X and Y) for players 1-4 (if configured) */
-                    if (args->analogDeadzone > 0 && args->analogDeadzone < MAX_ANALOG_DEADZONE &&
-                        (args->player >= 1 && args->player <= 4) &&
-                        args->inputs.abs[event.code].type == ANALOGUE &&
-                        (args->inputs.abs[event.code].input == CONTROLLER_ANALOGUE_X || 
-                         args->inputs.abs[event.code].input == CONTROLLER_ANALOGUE_Y))
+                    if (event.code < ABS_CNT)
+                        event.value = filterAxis(&args->absFilters[event.code], event.value, event.input_event_sec * 1000000LL + event.input_event_usec);
+
+                    JVSInput channel = args->inputs.abs[event.code].output;
+                    double value;
+                    if (event.code < ABS_CNT && args->absTables[event.code].table)
                     {
-                        /* Center the value around 0.5 */
-                        double centered = scaled - ANALOG_CENTER_VALUE;
-                        double magnitude = fabs(centered);
-                        
-                        /* Apply deadzone: if within deadzone, set to center */
-                        if (magnitude < args->analogDeadzone)
-                        {
-                            scaled = ANALOG_CENTER_VALUE;
-                        }
-                        else if (MAX_ANALOG_DEADZONE - args->analogDeadzone > MIN_DIVISION_THRESHOLD)
-                        {
-                            /* Scale the remaining range outside the deadzone (with safety check for division) */
-                            double sign = (centered > 0) ? 1.0 : -1.0;
-                            scaled = ANALOG_CENTER_VALUE + sign * ((magnitude - args->analogDeadzone) / (MAX_ANALOG_DEADZONE - args->analogDeadzone)) * ANALOG_CENTER_VALUE;
-                        }
+                        unsigned short position = lookupAxisTable(&args->absTables[event.code], event.value);
+                        setAnalogueFixed(args->jvsIO, channel, position);
+                        value = (double)position / CURVE_ONE;
+                    }
+                    else
+                    {
+                        value = scaleAxis(args, event.code, event.value);
+                        setAnalogue(args->jvsIO, channel, value);
                     }
 
-                    setAnalogue(args->jvsIO, args->inputs.abs[event.code].output, args->inputs.abs[event.code].reverse ? 1 - scaled : scaled);
-                    setGun(args->jvsIO, args->inputs.abs[event.code].output, args->inputs.abs[event.code].reverse ? 1 - scaled : scaled);
+                    if (channel < JVS_MAX_GUNS * 2)
+                    {
+                        gunAxes[channel] = value;
+                        gunRaw[channel] = event.value;
+                        gunReverse[channel] = args->inputs.abs[event.code].reverse;
+                        gunsMoved |= 1 << (channel / 2);
+                    }
+                }
+            }
+            break;
+
+            case EV_SYN:
+            {
+                if (event.code != SYN_REPORT)
+                    continue;
+
+                int64_t reportTime = event.input_event_sec * 1000000LL + event.input_event_usec;
+                for (int relIndex = 0; relMoved; relIndex++, relMoved >>= 1)
+                {
+                    if (!(relMoved & 1))
+                        continue;
+
+                    int counts = integrateRelative(&args->relAxes[relIndex], relPending[relIndex], reportTime);
+                    relPending[relIndex] = 0;
+                    if (counts == 0)
+                        continue;
+
+                    JVSIO *io = args->jvsIO;
+                    if (args->inputs.rel[relIndex].secondaryIO && args->jvsIO->chainedIO != NULL)
+                        io = args->jvsIO->chainedIO;
+
+                    JVSInput channel = args->inputs.rel[relIndex].output;
+                    if (args->inputs.rel[relIndex].type == ANALOGUE)
+                    {
+                        /* An analogue channel stops at either end rather than wrapping */
+                        int position = relPosition[relIndex] + counts;
+                        relPosition[relIndex] = position > CURVE_ONE ? CURVE_ONE : position < 0 ? 0 : position;
+                        setAnalogueFixed(io, channel, relPosition[relIndex]);
+                        continue;
+                    }
+
+                    setRotary(io, channel, getRotary(io, channel) + counts);
+                }
+
+                for (int gun = 0; gunsMoved; gun++, gunsMoved >>= 1)
+                {
+                    if (!(gunsMoved & 1))
+                        continue;
+
+                    /* A calibrated gun goes straight from what the device reports to the screen in fixed point */
+                    if (args->calibration.valid)
+                    {
+                        int x, y;
+                        applyGunCalibration(&args->calibration, gunRaw[gun * 2], gunRaw[gun * 2 + 1], &x, &y);
+                        setGunPositionFixed(args->jvsIO, gun, gunReverse[gun * 2] ? GUN_POSITION_MAX - x : x,
+                                            gunReverse[gun * 2 + 1] ? GUN_POSITION_MAX - y : y);
+                        continue;
+                    }
+
+                    setGunPosition(args->jvsIO, gun, gunAxes[gun * 2], gunAxes[gun * 2 + 1]);
                 }
             }
             break;
@@ -452,11 +841,14 @@ static void *deviceThread(void *_args)
     }
 
     close(fd);
+    for (int axisIndex = 0; axisIndex < ABS_CNT; axisIndex++)
+        freeAxisTable(&args->absTables[axisIndex]);
+    releaseSwitchSource(args->jvsIO, args->switchSource);
     free(args);
 
     return 0;
 }
-static void startThread(EVInputs *inputs, char *devicePath, int wiiMode, int player, JVSIO *jvsIO, double analogDeadzone)
+static void startThread(EVInputs *inputs, char *devicePath, char *deviceName, int wiiMode, int player, JVSIO *jvsIO, double analogDeadzone, const GunFilterConfig *gunFilter)
 {
     MappingThreadArguments *args = malloc(sizeof(MappingThreadArguments));
     if (args == NULL)
@@ -471,6 +863,9 @@ static void startThread(EVInputs *inputs, char *devicePath, int wiiMode, int pla
     args->player = player;
     args->jvsIO = jvsIO;
     args->analogDeadzone = analogDeadzone;
+    args->gunFilter = *gunFilter;
+    if (loadGunCalibration(&args->calibration, deviceName))
+        debug(1, "Debug: Using the gun calibration for %s\n", deviceName);
 
     if (wiiMode)
     {
@@ -488,6 +883,282 @@ static void startThread(EVInputs *inputs, char *devicePath, int wiiMode, int pla
     }
 }
 
+typedef struct
+{
+    JVSIO *jvsIO;
+    char devicePath[MAX_PATH_LENGTH];
+    MotionMapping motion;
+    OutputMapping outputs[MOTION_AXES];
+    int enabled[MOTION_AXES];
+    MotionFusion fusion;
+    AxisTable tables[MOTION_AXES];
+} MotionThreadArguments;
+
+typedef struct
+{
+    MotionThreadArguments *args;
+    int axis;
+    double range;
+} MotionResponse;
+
+/* Where a motion axis puts its analogue channel, REVERSE and then the device and game CURVEs are applied in turn */
+static double motionResponse(void *context, double value)
+{
+    MotionResponse *response = (MotionResponse *)context;
+    MotionThreadArguments *args = response->args;
+
+    double scaled = (value + response->range) / (2 * response->range);
+    scaled = (args->outputs[response->axis].reverse ^ args->motion.reverse[response->axis]) ? 1 - scaled : scaled;
+    scaled = applyCurve(&args->motion.curve[response->axis], scaled);
+    return applyCurve(&args->outputs[response->axis].curve, scaled);
+}
+
+/* Line one of the controller's sensors up with x to the right, y forwards and z up */
+static void readMotionSensor(const int *values, const int codes[3], const int flips[3], int sensor[3])
+{
+    for (int i = 0; i < 3; i++)
+        sensor[i] = flips[i] ? -values[codes[i]] : values[codes[i]];
+}
+
+static void *motionThread(void *_args)
+{
+    MotionThreadArguments *args = (MotionThreadArguments *)_args;
+
+    int fd = open(args->devicePath, O_RDONLY);
+    if (fd < 0)
+    {
+        debug(0, "Error: Failed to open the motion sensors at %s\n", args->devicePath);
+        free(args);
+        return 0;
+    }
+
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+
+    uint8_t absoluteBitmask[ABS_MAX / 8 + 1];
+    memset(absoluteBitmask, 0, sizeof(absoluteBitmask));
+    if (ioctl(fd, EVIOCGBIT(EV_ABS, sizeof(absoluteBitmask)), absoluteBitmask) < 0)
+        perror("Error: Failed to get bit mask for the motion sensors");
+
+    /* The gyroscope says how much it reports for a degree a second, unless the mapping knows better */
+    double gyroResolution[3] = {0};
+    for (int i = 0; i < 3; i++)
+    {
+        struct input_absinfo absoluteFeatures;
+        if (!test_bit(args->motion.gyro[i], absoluteBitmask) || ioctl(fd, EVIOCGABS(args->motion.gyro[i]), &absoluteFeatures))
+            continue;
+        gyroResolution[i] = args->motion.gyroResolution > 0 ? args->motion.gyroResolution : absoluteFeatures.resolution;
+    }
+    initMotionFusion(&args->fusion, args->motion.gain, gyroResolution);
+
+    /* Each axis' whole response is worked out up front, so a report is just a lookup, and starts in the middle */
+    memset(args->tables, 0, sizeof(args->tables));
+    for (int axis = 0; axis < MOTION_AXES; axis++)
+    {
+        if (!args->enabled[axis])
+            continue;
+
+        int range = lround(sin(args->motion.range[axis] * M_PI / 180) * MOTION_AXIS_ONE);
+        MotionResponse response = {.args = args, .axis = axis, .range = range};
+        if (!buildAxisTable(&args->tables[axis], -range, range, motionResponse, &response))
+        {
+            debug(0, "Error: Failed to allocate the table for a motion axis\n");
+            args->enabled[axis] = 0;
+            continue;
+        }
+
+        JVSIO *io = args->outputs[axis].secondaryIO && args->jvsIO->chainedIO != NULL ? args->jvsIO->chainedIO : args->jvsIO;
+        setAnalogueFixed(io, args->outputs[axis].output, lookupAxisTable(&args->tables[axis], 0));
+    }
+
+    int values[ABS_CNT] = {0};
+    int64_t sensorTime = 0;
+    unsigned int lastStamp = 0;
+    int stamped = 0;
+
+    struct input_event events[64];
+    fd_set file_descriptor;
+    struct timeval tv;
+
+    while (getThreadsRunning())
+    {
+        FD_ZERO(&file_descriptor);
+        FD_SET(fd, &file_descriptor);
+
+        tv.tv_sec = 0;
+        tv.tv_usec = 2 * 1000;
+
+        if (select(fd + 1, &file_descriptor, NULL, NULL, &tv) < 1)
+            continue;
+
+        /* The sensors report often, so everything waiting is read at once and the filter moves on once a report */
+        ssize_t bytes = read(fd, events, sizeof(events));
+        if (bytes < (ssize_t)sizeof(struct input_event))
+            continue;
+
+        for (int i = 0; i < (int)(bytes / sizeof(struct input_event)); i++)
+        {
+            struct input_event *event = &events[i];
+            if (event->type == EV_ABS && event->code < ABS_CNT)
+            {
+                values[event->code] = event->value;
+            }
+            else if (event->type == EV_MSC && event->code == MSC_TIMESTAMP)
+            {
+                /* The sensors' own clock is steadier than when the report arrived, it wraps every 71 minutes */
+                if (stamped)
+                    sensorTime += (unsigned int)event->value - lastStamp;
+                lastStamp = event->value;
+                stamped = 1;
+            }
+            else if (event->type == EV_SYN && event->code == SYN_REPORT)
+            {
+                int accel[3], gyro[3];
+                readMotionSensor(values, args->motion.accel, args->motion.accelFlip, accel);
+                readMotionSensor(values, args->motion.gyro, args->motion.gyroFlip, gyro);
+                updateMotionFusion(&args->fusion, accel, gyro, stamped ? sensorTime : event->input_event_sec * 1000000LL + event->input_event_usec);
+
+                for (int axis = 0; axis < MOTION_AXES; axis++)
+                {
+                    if (!args->enabled[axis])
+                        continue;
+
+                    JVSIO *io = args->outputs[axis].secondaryIO && args->jvsIO->chainedIO != NULL ? args->jvsIO->chainedIO : args->jvsIO;
+                    setAnalogueFixed(io, args->outputs[axis].output, lookupAxisTable(&args->tables[axis], getMotionAxis(&args->fusion, axis)));
+                }
+            }
+        }
+    }
+
+    close(fd);
+    for (int axis = 0; axis < MOTION_AXES; axis++)
+        freeAxisTable(&args->tables[axis]);
+    free(args);
+
+    return 0;
+}
+
+/* Read a controller's motion sensors into the axes its mapping gives them, as the same player */
+static void startMotionThread(EVInputs *inputs, const char *devicePath, JVSIO *jvsIO)
+{
+    MotionThreadArguments *args = malloc(sizeof(MotionThreadArguments));
+    if (args == NULL)
+    {
+        debug(0, "Error: Failed to malloc motion thread arguments\n");
+        return;
+    }
+
+    strncpy(args->devicePath, devicePath, MAX_PATH_LENGTH - 1);
+    args->devicePath[MAX_PATH_LENGTH - 1] = '\0';
+    args->jvsIO = jvsIO;
+    args->motion = inputs->motion;
+    memcpy(args->outputs, inputs->motionOutputs, sizeof(args->outputs));
+    memcpy(args->enabled, inputs->motionEnabled, sizeof(args->enabled));
+
+    if (createThread(motionThread, args) != THREAD_STATUS_SUCCESS)
+        free(args);
+}
+
+typedef struct
+{
+    JVSIO *jvsIO;
+    GPIOInputConfig inputs[MAX_GPIO_INPUTS];
+    int count;
+    int switchSource;
+} GPIOThreadArguments;
+
+static void applyGPIOInput(JVSIO *jvsIO, int switchSource, const GPIOInputConfig *input, int pressed)
+{
+    JVSIO *io = input->secondaryIO && jvsIO->chainedIO != NULL ? jvsIO->chainedIO : jvsIO;
+
+    if (input->input == COIN)
+    {
+        if (pressed)
+            incrementCoin(io, input->player, 1);
+        return;
+    }
+
+    setSwitch(io, switchSource, input->player, input->input, pressed);
+}
+
+static void *gpioInputThread(void *_args)
+{
+    GPIOThreadArguments *args = (GPIOThreadArguments *)_args;
+    int pins[MAX_GPIO_INPUTS], values[MAX_GPIO_INPUTS], pressed[MAX_GPIO_INPUTS];
+
+    for (int i = 0; i < args->count; i++)
+    {
+        pins[i] = args->inputs[i].pin;
+        pressed[i] = 0;
+    }
+
+    GPIOInputs *lines = requestGPIOInputs(pins, args->count);
+    if (!lines)
+    {
+        debug(0, "Error: Could not request the GPIO input pins\n");
+        free(args);
+        return 0;
+    }
+
+    args->switchSource = claimSwitchSource();
+
+    /* Check the pins straight away so anything held at startup is seen, then only when one changes */
+    int status = 1;
+    while (getThreadsRunning() && status >= 0)
+    {
+        if (status > 0 && readGPIOInputs(lines, values))
+        {
+            for (int i = 0; i < args->count; i++)
+            {
+                /* The switches pull the pins to ground */
+                int value = !values[i];
+                if (value != pressed[i])
+                {
+                    pressed[i] = value;
+                    applyGPIOInput(args->jvsIO, args->switchSource, &args->inputs[i], value);
+                }
+            }
+        }
+
+        status = waitGPIOInputs(lines, GPIO_INPUT_POLL_TIMEOUT);
+    }
+
+    if (status < 0)
+        debug(0, "Error: Lost the GPIO input pins\n");
+
+    releaseGPIOInputs(lines);
+    releaseSwitchSource(args->jvsIO, args->switchSource);
+    free(args);
+    return 0;
+}
+
+/**
+ * Start watching the GPIO pins wired to JVS inputs
+ *
+ * @param jvsIO The IO the inputs are sent to, chained IO included
+ * @param inputs The GPIO_INPUT lines for the bus
+ * @param count How many lines there are
+ */
+void startGPIOInputs(JVSIO *jvsIO, const GPIOInputConfig *inputs, int count)
+{
+    if (count <= 0)
+        return;
+
+    GPIOThreadArguments *args = malloc(sizeof(GPIOThreadArguments));
+    if (args == NULL)
+    {
+        debug(0, "Error: Failed to malloc GPIO input thread arguments\n");
+        return;
+    }
+
+    args->jvsIO = jvsIO;
+    args->count = count > MAX_GPIO_INPUTS ? MAX_GPIO_INPUTS : count;
+    memcpy(args->inputs, inputs, args->count * sizeof(GPIOInputConfig));
+
+    if (createThread(gpioInputThread, args) != THREAD_STATUS_SUCCESS)
+        free(args);
+}
+
 int evDevFromString(char *evDevString)
 {
     for (long unsigned int i = 0; i < sizeof(evDevConversion) / sizeof(evDevConversion[0]); i++)
@@ -534,6 +1205,107 @@ static const char *stringFromControllerInput(ControllerInput controllerInput)
     return NULL;
 }
 
+static int findOutputMapping(OutputMappings *outputMappings, ControllerInput input, ControllerPlayer player, InputType type, OutputMapping *mapping)
+{
+    for (int j = outputMappings->length - 1; j >= 0; j--)
+    {
+        if (outputMappings->mappings[j].input == input && outputMappings->mappings[j].controllerPlayer == player && outputMappings->mappings[j].type == type)
+        {
+            *mapping = outputMappings->mappings[j];
+            return 1;
+        }
+    }
+
+    debug(1, "Warning: No outside mapping found for %s\n", stringFromControllerInput(input));
+    return 0;
+}
+
+/* Give a key a bit in the combo state, the same bit if it already has one */
+static int comboBit(EVInputs *evInputs, int code)
+{
+    if (evInputs->keyBit[code] != COMBO_KEY_NONE)
+        return evInputs->keyBit[code];
+
+    if (evInputs->comboKeyLength >= MAX_COMBO_KEYS)
+        return -1;
+
+    evInputs->comboCodes[evInputs->comboKeyLength] = code;
+    evInputs->keyBit[code] = evInputs->comboKeyLength;
+    return evInputs->comboKeyLength++;
+}
+
+/**
+ * Compile the chords, shift layer and macros of a device
+ *
+ * Everything is worked out into masks and tables here, so an event only
+ * needs a few lookups and bit tests however many there are.
+ *
+ * @param inputMappings The device's mapping
+ * @param outputMappings The game's mapping
+ * @param evInputs Where to compile them to
+ * @param player The player the device is
+ */
+static void processCombos(InputMappings *inputMappings, OutputMappings *outputMappings, EVInputs *evInputs, ControllerPlayer player)
+{
+    memset(evInputs->keyBit, COMBO_KEY_NONE, sizeof(evInputs->keyBit));
+
+    for (int i = 0; i < inputMappings->chordLength; i++)
+    {
+        ChordMapping *chord = &inputMappings->chords[i];
+        OutputMapping mapping;
+        if (!findOutputMapping(outputMappings, chord->input, player, SWITCH, &mapping))
+            continue;
+
+        unsigned int mask = 0;
+        for (int key = 0; key < chord->length; key++)
+        {
+            int bit = comboBit(evInputs, chord->codes[key]);
+            if (bit < 0)
+            {
+                debug(0, "Error: Only %d keys can be used in chords\n", MAX_COMBO_KEYS);
+                mask = 0;
+                break;
+            }
+            mask |= 1u << bit;
+        }
+
+        if (!mask)
+            continue;
+
+        for (int bit = 0; bit < MAX_COMBO_KEYS; bit++)
+            if (mask & (1u << bit))
+                evInputs->keyChords[bit] |= 1u << evInputs->chordLength;
+
+        evInputs->chordMasks[evInputs->chordLength] = mask;
+        evInputs->chords[evInputs->chordLength++] = mapping;
+    }
+
+    evInputs->shiftCode = inputMappings->shiftCode;
+    for (int i = 0; i < inputMappings->shiftedLength; i++)
+    {
+        if (findOutputMapping(outputMappings, inputMappings->shifted[i].input, player, SWITCH, &evInputs->shifted[i]))
+            evInputs->keyShifted[inputMappings->shifted[i].code] = i + 1;
+    }
+
+    for (int i = 0; i < inputMappings->macroLength; i++)
+    {
+        MacroMapping *macro = &inputMappings->macros[i];
+        int length = 0;
+        for (int step = 0; step < macro->length; step++)
+        {
+            if (!findOutputMapping(outputMappings, macro->steps[step].input, player, SWITCH, &evInputs->macroSteps[evInputs->macroLength][length]))
+                continue;
+            evInputs->macroDurations[evInputs->macroLength][length++] = macro->steps[step].duration;
+        }
+
+        if (!length)
+            continue;
+
+        evInputs->macroLengths[evInputs->macroLength] = length;
+        evInputs->keyMacro[macro->code] = ++evInputs->macroLength;
+    }
+}
+
 static int processMappings(InputMappings *inputMappings, OutputMappings *outputMappings, EVInputs *evInputs, ControllerPlayer player)
 {
     for (int i = 0; i < inputMappings->length; i++)
@@ -595,13 +1367,20 @@ static int processMappings(InputMappings *inputMappings, OutputMappings *outputM
             evInputs->abs[inputMappings->mappings[i].code].type = ANALOGUE;
             evInputs->absEnabled[inputMappings->mappings[i].code] = 1;
             evInputs->absMultiplier[inputMappings->mappings[i].code] = multiplier;
+            if (inputMappings->mappings[i].code < ABS_CNT)
+            {
+                evInputs->absFilter[inputMappings->mappings[i].code] = inputMappings->mappings[i].filter;
+                evInputs->absCurve[inputMappings->mappings[i].code] = inputMappings->mappings[i].curve;
+            }
         }
-        else if (inputMappings->mappings[i].type == ROTARY && tempMapping.type == ROTARY)
+        else if (inputMappings->mappings[i].type == ROTARY && (tempMapping.type == ROTARY || tempMapping.type == ANALOGUE))
         {
+            /* A mouse or trackball can move an analogue channel as well as a rotary one */
             evInputs->rel[inputMappings->mappings[i].code] = tempMapping;
-            evInputs->rel[inputMappings->mappings[i].code].type = ROTARY;
             evInputs->relEnabled[inputMappings->mappings[i].code] = 1;
             evInputs->relMultiplier[inputMappings->mappings[i].code] = multiplier;
+            if (inputMappings->mappings[i].code < REL_CNT)
+                evInputs->relAcceleration[inputMappings->mappings[i].code] = inputMappings->mappings[i].acceleration;
         }
         else if (inputMappings->mappings[i].type == SWITCH || tempMapping.type == SWITCH)
         {
@@ -617,6 +1396,16 @@ static int processMappings(InputMappings *inputMappings, OutputMappings *outputM
             evInputs->absEnabled[inputMappings->mappings[i].code] = 1;
         }
     }
+
+    processCombos(inputMappings, outputMappings, evInputs, player);
+
+    evInputs->motion = inputMappings->motion;
+    for (int axis = 0; axis < MOTION_AXES; axis++)
+    {
+        if (inputMappings->motion.enabled[axis])
+            evInputs->motionEnabled[axis] = findOutputMapping(outputMappings, inputMappings->motion.input[axis], player, ANALOGUE, &evInputs->motionOutputs[axis]);
+    }
+
     return 1;
 }
 
@@ -643,6 +1432,61 @@ static int compare_devices(const void *a, const void *b)
     return strcmp(dev_a->physicalLocation, dev_b->physicalLocation);
 }
 
+/* Motion sensors some drivers don't mark as an accelerometer, by the end of their name */
+static int isMotionDeviceName(const char *fullName)
+{
+    size_t length = strlen(fullName);
+    for (int i = 0; MOTION_DEVICE_SUFFIXES[i] != NULL; i++)
+    {
+        size_t suffixLength = strlen(MOTION_DEVICE_SUFFIXES[i]);
+        if (length > suffixLength && strcmp(fullName + length - suffixLength, MOTION_DEVICE_SUFFIXES[i]) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * Find the controller each set of motion sensors belongs to
+ *
+ * The sensors are named after their controller, so the controller with
+ * the longest name the sensors' name starts with is picked. Where both
+ * report a unique ID or physical location they have to match too, which
+ * keeps two of the same controller apart.
+ *
+ * @param deviceList The devices, after they have been sorted
+ */
+static void pairMotionDevices(DeviceList *deviceList)
+{
+    for (int i = 0; i < deviceList->length; i++)
+    {
+        Device *motion = &deviceList->devices[i];
+        if (motion->type != DEVICE_TYPE_MOTION)
+            continue;
+
+        int parent = -1;
+        size_t parentLength = 0;
+        for (int j = 0; j < deviceList->length; j++)
+        {
+            Device *device = &deviceList->devices[j];
+            size_t length = strlen(device->fullName);
+            if (device->type == DEVICE_TYPE_MOTION || device->motionDevice != -1 || length <= parentLength || strncmp(motion->fullName, device->fullName, length) != 0)
+                continue;
+
+            if (motion->uniq[0] && device->uniq[0] && strcmp(motion->uniq, device->uniq) != 0)
+                continue;
+
+            if (motion->physicalLocation[0] && device->physicalLocation[0] && strcmp(motion->physicalLocation, device->physicalLocation) != 0)
+                continue;
+
+            parent = j;
+            parentLength = length;
+        }
+
+        if (parent != -1)
+            deviceList->devices[parent].motionDevice = i;
+    }
+}
+
 int getNumberOfDevices(void)
 {
     struct dirent **namelist = NULL;
@@ -739,6 +1583,9 @@ JVSInputStatus getInputs(DeviceList *deviceList)
             }
         }
 
+        ioctl(device, EVIOCGUNIQ(sizeof(dev->uniq)), dev->uniq);
+        dev->motionDevice = -1;
+
         // Make it lower case and replace letters
         for (size_t j = 0; j < strlen(dev->fullName); j++)
         {
@@ -784,6 +1631,12 @@ JVSInputStatus getInputs(DeviceList *deviceList)
                 dev->type = DEVICE_TYPE_JOYSTICK;
         }
 
+        // Motion sensors come as a device of their own next to the controller
+        uint8_t propertyBitmask[INPUT_PROP_CNT / 8 + 1] = {0};
+        ioctl(device, EVIOCGPROP(sizeof(propertyBitmask)), propertyBitmask);
+        if (test_bit(INPUT_PROP_ACCELEROMETER, propertyBitmask) || isMotionDeviceName(dev->fullName))
+            dev->type = DEVICE_TYPE_MOTION;
+
         close(device);
         validDeviceIndex++;
     }
@@ -798,15 +1651,63 @@ JVSInputStatus getInputs(DeviceList *deviceList)
         qsort(deviceList->devices, deviceList->length, sizeof(Device), compare_devices);
     }
 
+    pairMotionDevices(deviceList);
+
     return JVS_INPUT_STATUS_SUCCESS;
 }
 
+static int hasMotionParent(const DeviceList *deviceList, int index)
+{
+    for (int i = 0; i < deviceList->length; i++)
+    {
+        if (deviceList->devices[i].motionDevice == index)
+            return 1;
+    }
+    return 0;
+}
+
+static int deviceMatches(const Device *device, const char *const *names, int length)
+{
+    for (int i = 0; i < length; i++)
+    {
+        if (strcmp(device->name, names[i]) == 0 || strcmp(device->physicalLocation, names[i]) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+/* A device is used if it is explicitly routed here, or if nothing is routed and no other bus claims it */
+static int deviceAllowed(const DeviceFilter *filter, const Device *device)
+{
+    if (filter == NULL)
+        return 1;
+
+    if (filter->includeLength > 0)
+        return deviceMatches(device, filter->include, filter->includeLength);
+
+    return !deviceMatches(device, filter->exclude, filter->excludeLength);
+}
+
 static double getPlayerDeadzone(int player, double p1, double p2, double p3, double p4)
 {
     double deadzones[] = {0.0, p1, p2, p3, p4};
     return (player >= 1 && player <= 4) ? deadzones[player] : 0.0;
 }
 
+/* Give a player's device the GPO_RUMBLE outputs mapped to it, devices that can't rumble are skipped */
+static void bindRumble(OutputMappings *outputMappings, ControllerPlayer player, const char *devicePath, int bus)
+{
+    for (int i = 0; i < outputMappings->rumbleLength; i++)
+    {
+        RumbleMapping *mapping = &outputMappings->rumble[i];
+        if (mapping->controllerPlayer != player)
+            continue;
+
+        if (addRumbleOutput(bus, mapping->secondaryIO, mapping->output, devicePath, mapping->duration, mapping->strength) == OUTPUT_STATUS_SUCCESS)
+            debug(1, "Debug: GPO %d rumbles %s\n", mapping->output + 1, devicePath);
+    }
+}
+
 /**
  * Initialise all of the input devices and start the threads
  * 
@@ -817,9 +1718,11 @@ static double getPlayerDeadzone(int player, double p1, double p2, double p3, dou
  * @param configPath The path to the configuration file
  * @param jvsIO The JVS IO object that we will send inputs to
  * @param autoDetect If we should automatically map controllers without mappings
+ * @param filter Which devices belong to this bus, or NULL to use every device
+ * @param bus The bus the inputs belong to, for outputs mapped back to the devices
  * @returns The status of the operation
  **/
-JVSInputStatus initInputs(char *outputMappingPath, char *configPath, char *secondConfigPath, JVSIO *jvsIO, int autoDetect, double analogDeadzoneP1, double analogDeadzoneP2, double analogDeadzoneP3, double analogDeadzoneP4)
+JVSInputStatus initInputs(char *outputMappingPath, char *configPath, char *secondConfigPath, JVSIO *jvsIO, int autoDetect, double analogDeadzoneP1, double analogDeadzoneP2, double analogDeadzoneP3, double analogDeadzoneP4, const DeviceFilter *filter, const GunFilterConfig *gunFilter, int bus)
 {
     OutputMappings outputMappings = {0};
     DeviceList *deviceList = (DeviceList *)malloc(sizeof(DeviceList));
@@ -845,6 +1748,13 @@ JVSInputStatus initInputs(char *outputMappingPath, char *configPath, char *secon
     {
         Device *device = &deviceList->devices[i];
 
+        if (!deviceAllowed(filter, device))
+            continue;
+
+        /* Motion sensors are read alongside the controller they belong to */
+        if (device->type == DEVICE_TYPE_MOTION && hasMotionParent(deviceList, i))
+            continue;
+
         char disabledPath[MAX_PATH_LENGTH];
         int ret = snprintf(disabledPath, sizeof(disabledPath), "%s%s.disabled", DEFAULT_DEVICE_MAPPING_PATH, device->name);
         if (ret < 0 || ret >= (int)sizeof(disabledPath))
@@ -916,16 +1826,24 @@ JVSInputStatus initInputs(char *outputMappingPath, char *configPath, char *secon
             continue;
         }
 
+        bindRumble(&outputMappings, (ControllerPlayer)playerNumber, device->path, bus);
+
+        if (device->motionDevice != -1 && (evInputs.motionEnabled[MOTION_ROLL] || evInputs.motionEnabled[MOTION_PITCH] || evInputs.motionEnabled[MOTION_YAW]))
+        {
+            startMotionThread(&evInputs, deviceList->devices[device->motionDevice].path, jvsIO);
+            debug(1, "Debug: Reading the motion sensors of %s from %s\n", device->name, deviceList->devices[device->motionDevice].path);
+        }
+
         if (inputMappings.player != -1)
         {
             double playerDeadzone = getPlayerDeadzone(inputMappings.player, analogDeadzoneP1, analogDeadzoneP2, analogDeadzoneP3, analogDeadzoneP4);
-            startThread(&evInputs, device->path, strcmp(device->name, WIIMOTE_DEVICE_NAME_IR) == 0, inputMappings.player, jvsIO, playerDeadzone);
+            startThread(&evInputs, device->path, device->name, strcmp(device->name, WIIMOTE_DEVICE_NAME_IR) == 0, inputMappings.player, jvsIO, playerDeadzone, gunFilter);
             debug(0, "  Player %d (Fixed via config):\t\t%s%s\n", inputMappings.player, deviceList->devices[i].name, specialMap);
         }
         else
         {
             double playerDeadzone = getPlayerDeadzone(playerNumber, analogDeadzoneP1, analogDeadzoneP2, analogDeadzoneP3, analogDeadzoneP4);
-            startThread(&evInputs, device->path, strcmp(device->name, WIIMOTE_DEVICE_NAME_IR) == 0, playerNumber, jvsIO, playerDeadzone);
+            startThread(&evInputs, device->path, device->name, strcmp(device->name, WIIMOTE_DEVICE_NAME_IR) == 0, playerNumber, jvsIO, playerDeadzone, gunFilter);
             if (strcmp(deviceList->devices[i].name, AIMTRAK_DEVICE_NAME_REMAP_OUT_SCREEN) != 0 && strcmp(deviceList->devices[i].name, AIMTRAK_DEVICE_NAME_REMAP_JOYSTICK) != 0 && strcmp(deviceList->devices[i].name, WIIMOTE_DEVICE_NAME_IR) != 0)
             {
                 debug(0, "  Player %d:\t\t%s%s\n", playerNumber, deviceName, specialMap);
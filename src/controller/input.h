@@ -4,6 +4,11 @@
 #include <linux/input.h>
 
 #include "jvs/io.h"
+#include "controller/gun.h"
+#include "controller/filter.h"
+#include "controller/curve.h"
+#include "controller/relative.h"
+#include "controller/motion.h"
 
 #define WIIMOTE_DEVICE_NAME "nintendo-wii-remote"
 #define WIIMOTE_DEVICE_NAME_IR "nintendo-wii-remote-ir"
@@ -19,12 +24,30 @@
 #define MAX_PATH 1024
 #define MAX_DEVICES 255
 #define MAX_EV_ITEMS 1024
+#define MAX_DEVICE_FILTER 32
+#define MAX_RUMBLE_MAPPINGS 16
+#define DEFAULT_RUMBLE_DURATION 60
+#define DEFAULT_RUMBLE_STRENGTH 100
+#define MAX_GPIO_INPUTS 16
+#define GPIO_INPUT_POLL_TIMEOUT 100
+
+/* Chords, the shift layer and macros, all from the device mapping file */
+#define MAX_COMBO_KEYS 32 // The keys in chords and the shift key, each gets a bit of the combo state
+#define MAX_CHORDS 16
+#define MAX_CHORD_KEYS 4
+#define MAX_SHIFTED 32
+#define MAX_MACROS 8
+#define MAX_MACRO_STEPS 8
+#define DEFAULT_MACRO_STEP 50 // ms
+#define DEFAULT_CHORD_WINDOW 40 // ms, how long a chord key waits for the rest of a chord
+#define COMBO_KEY_NONE 0xFF
 
 typedef enum
 {
     DEVICE_TYPE_JOYSTICK,
     DEVICE_TYPE_KEYBOARD,
     DEVICE_TYPE_MOUSE,
+    DEVICE_TYPE_MOTION,
     DEVICE_TYPE_UNKNOWN
 } DeviceType;
 
@@ -35,6 +58,8 @@ typedef struct
     char name[MAX_PATH];
     char path[MAX_PATH];
     char physicalLocation[MAX_PATH];
+    char uniq[MAX_PATH];
+    int motionDevice; // The index of the controller's motion sensors, or -1
     int bus;
     int productID;
     int vendorID;
@@ -2363,6 +2388,9 @@ typedef struct
     int code;
     int reverse;
     double multiplier;
+    AxisFilterConfig filter;
+    ResponseCurve curve;
+    double acceleration;
 } InputMapping;
 
 typedef struct
@@ -2377,19 +2405,85 @@ typedef struct
     int reverse;
     double multiplier;
     int secondaryIO;
+    ResponseCurve curve;
 } OutputMapping;
 
+/* A CHORD line, which presses an input while all of its keys are held together */
+typedef struct
+{
+    int codes[MAX_CHORD_KEYS];
+    int length;
+    ControllerInput input;
+} ChordMapping;
+
+/* A SHIFTED line, what a key does instead while the SHIFT key is held */
+typedef struct
+{
+    int code;
+    ControllerInput input;
+} ShiftedMapping;
+
+typedef struct
+{
+    ControllerInput input;
+    int duration; // ms
+} MacroStep;
+
+/* A MACRO line, which presses a run of inputs one after another from a single key */
+typedef struct
+{
+    int code;
+    MacroStep steps[MAX_MACRO_STEPS];
+    int length;
+} MacroMapping;
+
+/* The MOTION lines of a device mapping file, which turn a controller's motion sensors into analogue axes */
+typedef struct
+{
+    int accel[3]; // The axes the accelerometer reports x, y and z on, z pointing up when the controller is held level
+    int gyro[3];
+    int accelFlip[3];
+    int gyroFlip[3];
+    double gyroResolution; // For one degree a second, 0 to use what the device says
+    double gain;
+    int enabled[MOTION_AXES];
+    ControllerInput input[MOTION_AXES];
+    double range[MOTION_AXES]; // degrees
+    int reverse[MOTION_AXES];
+    ResponseCurve curve[MOTION_AXES];
+} MotionMapping;
+
 typedef struct
 {
     int length;
     InputMapping mappings[MAX_MAPPING];
     int player;
+    ChordMapping chords[MAX_CHORDS];
+    int chordLength;
+    int shiftCode; // 0 for no shift key
+    ShiftedMapping shifted[MAX_SHIFTED];
+    int shiftedLength;
+    MacroMapping macros[MAX_MACROS];
+    int macroLength;
+    MotionMapping motion;
 } InputMappings;
 
+/* A GPO_RUMBLE line, which kicks a controller when the game fires an output such as a recoil solenoid */
+typedef struct
+{
+    ControllerPlayer controllerPlayer;
+    int output;
+    int secondaryIO;
+    int duration;
+    int strength;
+} RumbleMapping;
+
 typedef struct
 {
     int length;
     OutputMapping mappings[MAX_MAPPING];
+    int rumbleLength;
+    RumbleMapping rumble[MAX_RUMBLE_MAPPINGS];
 } OutputMappings;
 
 typedef struct
@@ -2403,8 +2497,51 @@ typedef struct
     OutputMapping abs[MAX_EV_ITEMS];
     OutputMapping rel[MAX_EV_ITEMS];
     OutputMapping key[MAX_EV_ITEMS];
+    AxisFilterConfig absFilter[ABS_CNT];
+    ResponseCurve absCurve[ABS_CNT];
+    double relAcceleration[REL_CNT];
+
+    /* Chords, the shift layer and macros compiled down to bitmasks over the combo keys */
+    unsigned char keyBit[KEY_CNT];
+    unsigned char keyShifted[KEY_CNT]; // 1 more than the index into shifted
+    unsigned char keyMacro[KEY_CNT];   // 1 more than the index into macros
+    int comboCodes[MAX_COMBO_KEYS];
+    int comboKeyLength;
+    unsigned int keyChords[MAX_COMBO_KEYS]; // The chords each combo key is part of
+    unsigned int chordMasks[MAX_CHORDS];
+    OutputMapping chords[MAX_CHORDS];
+    int chordLength;
+    int shiftCode;
+    OutputMapping shifted[MAX_SHIFTED];
+    OutputMapping macroSteps[MAX_MACROS][MAX_MACRO_STEPS];
+    int macroDurations[MAX_MACROS][MAX_MACRO_STEPS];
+    int macroLengths[MAX_MACROS];
+    int macroLength;
+
+    /* The controller's motion sensors, read from a device of their own */
+    MotionMapping motion;
+    OutputMapping motionOutputs[MOTION_AXES];
+    int motionEnabled[MOTION_AXES];
 } EVInputs;
 
+/* A GPIO_INPUT line, which wires a switch on a GPIO pin straight to a JVS input */
+typedef struct
+{
+    int pin;
+    JVSInput input;
+    JVSPlayer player;
+    int secondaryIO;
+} GPIOInputConfig;
+
+/* Decides which input devices are routed to a bus, matched by name or physical location */
+typedef struct
+{
+    const char *include[MAX_DEVICE_FILTER];
+    int includeLength;
+    const char *exclude[MAX_DEVICE_FILTER];
+    int excludeLength;
+} DeviceFilter;
+
 typedef enum
 {
     JVS_INPUT_STATUS_NO_DEVICE_ERROR,
@@ -2414,7 +2551,8 @@ typedef enum
     JVS_INPUT_STATUS_SUCCESS
 } JVSInputStatus;
 
-JVSInputStatus initInputs(char *outputMappingPath, char *configPath, char *secondConfigPath, JVSIO *jvsIO, int autoDetect, double analogDeadzoneP1, double analogDeadzoneP2, double analogDeadzoneP3, double analogDeadzoneP4);
+JVSInputStatus initInputs(char *outputMappingPath, char *configPath, char *secondConfigPath, JVSIO *jvsIO, int autoDetect, double analogDeadzoneP1, double analogDeadzoneP2, double analogDeadzoneP3, double analogDeadzoneP4, const DeviceFilter *filter, const GunFilterConfig *gunFilter, int bus);
+void startGPIOInputs(JVSIO *jvsIO, const GPIOInputConfig *inputs, int count);
 int evDevFromString(char *evDevString);
 JVSInputStatus getInputs(DeviceList *deviceList);
 ControllerInput controllerInputFromString(char *controllerInputString);
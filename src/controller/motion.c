@@ -0,0 +1,149 @@
+#include <math.h>
+#include <string.h>
+
+#include "controller/motion.h"
+
+/* Gains carry this many fractional bits */
+#define MOTION_GAIN_BITS 16
+
+/* For the first half a second the accelerometer pulls hard, so the filter starts from how the controller is held */
+#define MOTION_SETTLE_TIME 500000
+#define MOTION_SETTLE_GAIN 10
+
+/* Reports further apart than this start the filter again, and no step is taken over more than the shorter time */
+#define MAX_MOTION_GAP 1000000
+#define MAX_MOTION_STEP 50000
+
+static uint64_t squareRoot(uint64_t value)
+{
+    if (value < 2)
+        return value;
+
+    /* Newton's method from above only ever comes down, to the root rounded down */
+    uint64_t root = 1ULL << ((64 - __builtin_clzll(value) + 1) / 2);
+    for (;;)
+    {
+        uint64_t next = (root + value / root) / 2;
+        if (next >= root)
+            return root;
+        root = next;
+    }
+}
+
+/**
+ * Setup the fusion for a controller's motion sensors
+ *
+ * @param fusion The fusion to setup
+ * @param gain How quickly the accelerometer corrects the gyroscope's drift
+ * @param gyroResolution What each gyroscope axis reports for one degree a second, 0 if there is no gyroscope
+ */
+void initMotionFusion(MotionFusion *fusion, double gain, const double gyroResolution[3])
+{
+    memset(fusion, 0, sizeof(MotionFusion));
+    fusion->orientation[0] = MOTION_ONE;
+    fusion->gain = llround((gain > 0 ? gain : DEFAULT_MOTION_GAIN) * (1 << MOTION_GAIN_BITS));
+    fusion->settling = MOTION_SETTLE_TIME;
+
+    for (int i = 0; i < 3; i++)
+        fusion->gyroScale[i] = gyroResolution[i] > 0 ? llround(M_PI / 180 / gyroResolution[i] * (double)(1LL << (MOTION_FRACTION_BITS + 16))) : 0;
+}
+
+/**
+ * Move the orientation on by one report from the motion sensors
+ *
+ * The gyroscope turns the orientation and the accelerometer pulls it
+ * back towards where gravity says it is, all in whole numbers. The
+ * accelerometer's units don't matter as only its direction is used.
+ *
+ * @param fusion The fusion for the controller
+ * @param accel The accelerometer's x, y and z, with z pointing up when the controller is held level
+ * @param gyro The gyroscope's x, y and z in the same frame
+ * @param time When the report was made, in microseconds
+ */
+void updateMotionFusion(MotionFusion *fusion, const int accel[3], const int gyro[3], int64_t time)
+{
+    int64_t dt = time - fusion->lastTime;
+    fusion->lastTime = time;
+
+    if (!fusion->primed || dt <= 0 || dt > MAX_MOTION_GAP)
+    {
+        fusion->primed = 1;
+        return;
+    }
+    dt = dt > MAX_MOTION_STEP ? MAX_MOTION_STEP : dt;
+
+    int64_t w = fusion->orientation[0], x = fusion->orientation[1], y = fusion->orientation[2], z = fusion->orientation[3];
+
+    int64_t rate[3];
+    for (int i = 0; i < 3; i++)
+        rate[i] = (gyro[i] * fusion->gyroScale[i]) >> 16;
+
+    uint64_t magnitude = squareRoot((int64_t)accel[0] * accel[0] + (int64_t)accel[1] * accel[1] + (int64_t)accel[2] * accel[2]);
+    if (magnitude)
+    {
+        int64_t ax = accel[0] * MOTION_ONE / (int64_t)magnitude;
+        int64_t ay = accel[1] * MOTION_ONE / (int64_t)magnitude;
+        int64_t az = accel[2] * MOTION_ONE / (int64_t)magnitude;
+
+        /* Half of where the orientation says up is, and the turn from there to where the accelerometer says */
+        int64_t vx = (x * z - w * y) >> MOTION_FRACTION_BITS;
+        int64_t vy = (w * x + y * z) >> MOTION_FRACTION_BITS;
+        int64_t vz = ((w * w + z * z) >> MOTION_FRACTION_BITS) - MOTION_ONE / 2;
+        int64_t ex = (ay * vz - az * vy) >> MOTION_FRACTION_BITS;
+        int64_t ey = (az * vx - ax * vz) >> MOTION_FRACTION_BITS;
+        int64_t ez = (ax * vy - ay * vx) >> MOTION_FRACTION_BITS;
+
+        int64_t gain = fusion->settling > 0 ? MOTION_SETTLE_GAIN << MOTION_GAIN_BITS : fusion->gain;
+        rate[0] += (2 * gain * ex) >> MOTION_GAIN_BITS;
+        rate[1] += (2 * gain * ey) >> MOTION_GAIN_BITS;
+        rate[2] += (2 * gain * ez) >> MOTION_GAIN_BITS;
+    }
+
+    if (fusion->settling > 0)
+        fusion->settling -= dt;
+
+    /* Half the angle turned about each axis this step */
+    int64_t hx = rate[0] * dt / 2000000, hy = rate[1] * dt / 2000000, hz = rate[2] * dt / 2000000;
+
+    w += (-x * hx - y * hy - z * hz) >> MOTION_FRACTION_BITS;
+    x += (fusion->orientation[0] * hx + y * hz - z * hy) >> MOTION_FRACTION_BITS;
+    y += (fusion->orientation[0] * hy - fusion->orientation[1] * hz + z * hx) >> MOTION_FRACTION_BITS;
+    z += (fusion->orientation[0] * hz + fusion->orientation[1] * hy - fusion->orientation[2] * hx) >> MOTION_FRACTION_BITS;
+
+    /* Each step is tiny, so one Newton step brings the length back to one without a square root */
+    int64_t length = (w * w + x * x + y * y + z * z) >> MOTION_FRACTION_BITS;
+    int64_t correction = (3 * MOTION_ONE - length) / 2;
+    fusion->orientation[0] = (w * correction) >> MOTION_FRACTION_BITS;
+    fusion->orientation[1] = (x * correction) >> MOTION_FRACTION_BITS;
+    fusion->orientation[2] = (y * correction) >> MOTION_FRACTION_BITS;
+    fusion->orientation[3] = (z * correction) >> MOTION_FRACTION_BITS;
+}
+
+/**
+ * Read one axis of the controller's orientation
+ *
+ * Roll and pitch are the sine of the tilt to the right and of the front
+ * up. Yaw is the sine of the turn to the right from where the controller
+ * pointed when it started, and drifts slowly as there is nothing to
+ * correct it against.
+ *
+ * @param fusion The fusion for the controller
+ * @param axis The axis to read
+ * @returns The axis from -MOTION_AXIS_ONE to MOTION_AXIS_ONE
+ */
+int getMotionAxis(const MotionFusion *fusion, MotionAxis axis)
+{
+    int64_t w = fusion->orientation[0], x = fusion->orientation[1], y = fusion->orientation[2], z = fusion->orientation[3];
+
+    switch (axis)
+    {
+    case MOTION_ROLL:
+        return (w * y - x * z) >> (2 * MOTION_FRACTION_BITS - 17);
+    case MOTION_PITCH:
+        return (w * x + y * z) >> (2 * MOTION_FRACTION_BITS - 17);
+    case MOTION_YAW:
+        return (x * y - w * z) >> (2 * MOTION_FRACTION_BITS - 17);
+    default:
+        return 0;
+    }
+}
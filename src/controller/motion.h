@@ -0,0 +1,38 @@
+#ifndef MOTION_H_
+#define MOTION_H_
+
+#include <stdint.h>
+
+/* The orientation is kept as a quaternion with 30 fractional bits, readings come out with 16 */
+#define MOTION_FRACTION_BITS 30
+#define MOTION_ONE (1LL << MOTION_FRACTION_BITS)
+#define MOTION_AXIS_ONE 65536
+
+#define DEFAULT_MOTION_GAIN 0.5
+#define DEFAULT_MOTION_RANGE 45 // degrees
+#define MAX_MOTION_RANGE 90
+
+typedef enum
+{
+    MOTION_ROLL,
+    MOTION_PITCH,
+    MOTION_YAW,
+    MOTION_AXES
+} MotionAxis;
+
+/* A Mahony filter fusing an accelerometer and a gyroscope into an orientation */
+typedef struct
+{
+    int64_t orientation[4]; // w, x, y and z
+    int64_t gain;           // 16 fractional bits, how hard the accelerometer pulls the orientation back
+    int64_t gyroScale[3];   // from what the gyroscope reports to radians a second, 46 fractional bits
+    int64_t settling;       // microseconds left pulling hard to find the starting orientation
+    int64_t lastTime;
+    int primed;
+} MotionFusion;
+
+void initMotionFusion(MotionFusion *fusion, double gain, const double gyroResolution[3]);
+void updateMotionFusion(MotionFusion *fusion, const int accel[3], const int gyro[3], int64_t time);
+int getMotionAxis(const MotionFusion *fusion, MotionAxis axis);
+
+#endif // MOTION_H_
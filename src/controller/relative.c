@@ -0,0 +1,56 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "controller/relative.h"
+
+/* Reports closer together than this are treated as this far apart, so a burst can't look infinitely fast */
+#define MIN_RELATIVE_INTERVAL 125
+
+/* Reports further apart than this are a new move, which starts at the plain multiplier */
+#define MAX_RELATIVE_INTERVAL 100000
+
+/**
+ * Setup a relative axis such as a mouse, trackball or spinner
+ *
+ * @param axis The axis to setup
+ * @param multiplier The counts to output for each count the device reports, negative to reverse
+ * @param acceleration The extra gain for each count a millisecond the device is moving
+ */
+void initRelativeAxis(RelativeAxis *axis, double multiplier, double acceleration)
+{
+    memset(axis, 0, sizeof(RelativeAxis));
+    axis->multiplier = (int64_t)(multiplier * (1 << RELATIVE_FRACTION_BITS));
+    axis->acceleration = acceleration > 0 ? (int64_t)(acceleration * (1 << RELATIVE_FRACTION_BITS)) : 0;
+}
+
+/**
+ * Integrate the movement from one report of a relative axis
+ *
+ * The gain grows with the speed of the move when the axis has an
+ * acceleration. Fractions of a count are carried over to the next
+ * report so slow moves at a low multiplier still get through.
+ *
+ * @param axis The axis that moved
+ * @param delta The counts the device reported since the last report
+ * @param time When the report was made, in microseconds
+ * @returns The counts to move the output by
+ */
+int integrateRelative(RelativeAxis *axis, int delta, int64_t time)
+{
+    int64_t dt = time - axis->lastTime;
+    axis->lastTime = time;
+
+    int64_t gain = (int64_t)1 << RELATIVE_FRACTION_BITS;
+    if (axis->acceleration && dt <= MAX_RELATIVE_INTERVAL)
+    {
+        dt = dt < MIN_RELATIVE_INTERVAL ? MIN_RELATIVE_INTERVAL : dt;
+        int64_t speed = ((int64_t)abs(delta) << RELATIVE_FRACTION_BITS) * 1000 / dt;
+        gain += (axis->acceleration * speed) >> RELATIVE_FRACTION_BITS;
+        gain = gain > ((int64_t)MAX_RELATIVE_GAIN << RELATIVE_FRACTION_BITS) ? (int64_t)MAX_RELATIVE_GAIN << RELATIVE_FRACTION_BITS : gain;
+    }
+
+    int64_t total = axis->residue + ((delta * axis->multiplier * gain) >> RELATIVE_FRACTION_BITS);
+    int64_t counts = total >> RELATIVE_FRACTION_BITS;
+    axis->residue = total - (counts << RELATIVE_FRACTION_BITS);
+    return (int)counts;
+}
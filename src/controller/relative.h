@@ -0,0 +1,26 @@
+#ifndef RELATIVE_H_
+#define RELATIVE_H_
+
+#include <stdint.h>
+
+/* Relative movement is integrated in fixed point, keeping the fraction of a count between reports */
+#define RELATIVE_FRACTION_BITS 16
+
+/* The counts a mouse or trackball has to move at SENSITIVITY 1 to sweep an analogue channel end to end */
+#define RELATIVE_ANALOGUE_TRAVEL 1024
+
+/* The acceleration can't make a move more than this many times bigger */
+#define MAX_RELATIVE_GAIN 16
+
+typedef struct
+{
+    int64_t multiplier;   // fixed point
+    int64_t acceleration; // fixed point, extra gain for each count a millisecond
+    int64_t residue;      // fixed point, the part of a count not reported yet
+    int64_t lastTime;
+} RelativeAxis;
+
+void initRelativeAxis(RelativeAxis *axis, double multiplier, double acceleration);
+int integrateRelative(RelativeAxis *axis, int delta, int64_t time);
+
+#endif // RELATIVE_H_
@@ -3,7 +3,7 @@
 
 #include <pthread.h>
 
-#define THREAD_MAX_NUMBER 32
+#define THREAD_MAX_NUMBER 64
 
 typedef enum
 {
@@ -1,43 +1,550 @@
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+
 #include "ffb/ffb.h"
 #include "console/debug.h"
 #include "controller/threading.h"
 
-void *ffbThread(void *_args);
+/* Analogue outputs are unsigned, a constant force is centred on the middle of the range */
+#define FFB_CENTRE 0x8000
+
+/* Effect direction for a force along the wheel's axis */
+#define FFB_DIRECTION_WHEEL 0x4000
+
+#define BITS_PER_LONG (sizeof(long) * 8)
+#define testBit(bit, array) ((array[(bit) / BITS_PER_LONG] >> ((bit) % BITS_PER_LONG)) & 1)
+
+static const struct
+{
+    const char *name;
+    FFBEffectType effect;
+    int feature;
+} ffbEffects[] = {
+    {"none", FFB_EFFECT_NONE, -1},
+    {"constant", FFB_EFFECT_CONSTANT, FF_CONSTANT},
+    {"spring", FFB_EFFECT_SPRING, FF_SPRING},
+    {"friction", FFB_EFFECT_FRICTION, FF_FRICTION},
+    {"rumble", FFB_EFFECT_RUMBLE, FF_RUMBLE},
+};
+
+/* The channels a drive board's commands land on, each plays one effect */
+enum
+{
+    DRIVE_TORQUE,
+    DRIVE_CENTRING,
+    DRIVE_FRICTION,
+    DRIVE_VIBRATION,
+    DRIVE_CHANNELS
+};
+
+static const FFBEffectType driveBoardEffects[DRIVE_CHANNELS] = {
+    [DRIVE_TORQUE] = FFB_EFFECT_CONSTANT,
+    [DRIVE_CENTRING] = FFB_EFFECT_SPRING,
+    [DRIVE_FRICTION] = FFB_EFFECT_FRICTION,
+    [DRIVE_VIBRATION] = FFB_EFFECT_RUMBLE,
+};
+
+static void *analogueThread(void *_args);
+static void *driveBoardThread(void *_args);
+static void decodeSega(FFBState *state, unsigned char byte);
+static void decodeNamco(FFBState *state, unsigned char byte);
+
+typedef struct
+{
+    FFBEmulationType type;
+    const char *name;
+    speed_t baud;
+    void (*decode)(FFBState *state, unsigned char byte);
+} DriveBoard;
+
+static const DriveBoard driveBoards[] = {
+    {FFB_EMULATION_TYPE_SEGA, "sega", B38400, decodeSega},
+    {FFB_EMULATION_TYPE_NAMCO, "namco", B38400, decodeNamco},
+};
+
+static const DriveBoard *getDriveBoard(FFBEmulationType type)
+{
+    for (size_t i = 0; i < sizeof(driveBoards) / sizeof(driveBoards[0]); i++)
+    {
+        if (driveBoards[i].type == type)
+            return &driveBoards[i];
+    }
+    return NULL;
+}
+
+FFBEmulationType ffbEmulationFromString(const char *name)
+{
+    for (size_t i = 0; i < sizeof(driveBoards) / sizeof(driveBoards[0]); i++)
+    {
+        if (strcmp(driveBoards[i].name, name) == 0)
+            return driveBoards[i].type;
+    }
+    debug(0, "Error: Unknown drive board %s\n", name);
+    return FFB_EMULATION_TYPE_ANALOGUE;
+}
+
+FFBEffectType ffbEffectFromString(const char *name)
+{
+    for (size_t i = 0; i < sizeof(ffbEffects) / sizeof(ffbEffects[0]); i++)
+    {
+        if (strcmp(ffbEffects[i].name, name) == 0)
+            return ffbEffects[i].effect;
+    }
+    debug(0, "Error: Unknown force feedback effect %s\n", name);
+    return FFB_EFFECT_NONE;
+}
+
+static int getEffectFeature(FFBEffectType effect)
+{
+    for (size_t i = 0; i < sizeof(ffbEffects) / sizeof(ffbEffects[0]); i++)
+    {
+        if (ffbEffects[i].effect == effect)
+            return ffbEffects[i].feature;
+    }
+    return -1;
+}
+
+/* Fill in an effect for a channel value, the effect's id is left alone */
+static void setEffectValue(struct ff_effect *effect, FFBEffectType type, unsigned short value)
+{
+    switch (type)
+    {
+    case FFB_EFFECT_CONSTANT:
+        effect->u.constant.level = (int16_t)(value - FFB_CENTRE);
+        break;
+    case FFB_EFFECT_SPRING:
+    case FFB_EFFECT_FRICTION:
+        effect->u.condition[0].right_saturation = value;
+        effect->u.condition[0].left_saturation = value;
+        effect->u.condition[0].right_coeff = value >> 1;
+        effect->u.condition[0].left_coeff = value >> 1;
+        break;
+    case FFB_EFFECT_RUMBLE:
+        effect->u.rumble.strong_magnitude = value;
+        effect->u.rumble.weak_magnitude = value;
+        break;
+    default:
+        break;
+    }
+}
+
+/* Drive board commands are decoded straight into the channels, the FFB thread is the only one touching them */
+static void setDriveChannel(FFBState *state, int channel, unsigned short value)
+{
+    state->channels[channel] = value;
+    state->pending |= 1u << channel;
+}
+
+static void stopDriveBoard(FFBState *state)
+{
+    setDriveChannel(state, DRIVE_TORQUE, FFB_CENTRE);
+    setDriveChannel(state, DRIVE_CENTRING, 0);
+    setDriveChannel(state, DRIVE_FRICTION, 0);
+    setDriveChannel(state, DRIVE_VIBRATION, 0);
+}
+
+/*
+ * Sega drive boards take single command bytes. The high nibble is the
+ * command and the low nibble its strength, so there is nothing to frame
+ * and every byte is acted on as soon as it arrives.
+ */
+#define SEGA_STRENGTH(byte) (((byte) & 0x0F) * 0x1111)
+#define SEGA_TORQUE(byte) (((byte) & 0x0F) * 0x0888)
+
+static void decodeSega(FFBState *state, unsigned char byte)
+{
+    switch (byte & 0xF0)
+    {
+    case 0x00:
+        if (byte == 0x00)
+            stopDriveBoard(state);
+        break;
+    case 0x10:
+        setDriveChannel(state, DRIVE_CENTRING, SEGA_STRENGTH(byte));
+        break;
+    case 0x20:
+        setDriveChannel(state, DRIVE_FRICTION, SEGA_STRENGTH(byte));
+        break;
+    case 0x30:
+        /* Uncentring shakes the wheel from side to side */
+        setDriveChannel(state, DRIVE_VIBRATION, SEGA_STRENGTH(byte));
+        break;
+    case 0x50:
+        /* The effect points left, so a force to the right is below the centre */
+        setDriveChannel(state, DRIVE_TORQUE, FFB_CENTRE - SEGA_TORQUE(byte));
+        break;
+    case 0x60:
+        setDriveChannel(state, DRIVE_TORQUE, FFB_CENTRE + SEGA_TORQUE(byte));
+        break;
+    default:
+        break;
+    }
+}
+
+/*
+ * Namco drive boards take four byte frames: a command with the top bit
+ * set, a 14 bit value sent as two 7 bit bytes and a 7 bit checksum of
+ * the other three. Only commands have the top bit set, so a dropped byte
+ * costs a single frame and the next command picks the stream back up.
+ */
+#define NAMCO_FRAME_SIZE 4
 
+enum
+{
+    NAMCO_STOP = 0x80,
+    NAMCO_TORQUE,
+    NAMCO_CENTRING,
+    NAMCO_FRICTION,
+    NAMCO_VIBRATION
+};
+
+static void decodeNamco(FFBState *state, unsigned char byte)
+{
+    if (byte & 0x80)
+        state->commandLength = 0;
+    else if (state->commandLength == 0)
+        return;
+
+    state->command[state->commandLength++] = byte;
+    if (state->commandLength < NAMCO_FRAME_SIZE)
+        return;
+
+    unsigned char *frame = state->command;
+    state->commandLength = 0;
+
+    if (((frame[0] + frame[1] + frame[2]) & 0x7F) != frame[3])
+    {
+        debug(1, "Warning: Namco drive board checksum mismatch\n");
+        return;
+    }
+
+    /* Scale the 14 bit value up to the 16 bits of the channels, the torque is centred the same way */
+    unsigned short value = ((frame[1] << 7) | frame[2]) << 2;
+
+    switch (frame[0])
+    {
+    case NAMCO_STOP:
+        stopDriveBoard(state);
+        break;
+    case NAMCO_TORQUE:
+        setDriveChannel(state, DRIVE_TORQUE, value);
+        break;
+    case NAMCO_CENTRING:
+        setDriveChannel(state, DRIVE_CENTRING, value);
+        break;
+    case NAMCO_FRICTION:
+        setDriveChannel(state, DRIVE_FRICTION, value);
+        break;
+    case NAMCO_VIBRATION:
+        setDriveChannel(state, DRIVE_VIBRATION, value);
+        break;
+    default:
+        debug(2, "Namco drive board command 0x%02X is not handled\n", frame[0]);
+        break;
+    }
+}
+
+/**
+ * Initialise the force feedback state
+ *
+ * Drive boards are emulated on the serial port at serialPath, analogue
+ * outputs from the IO come in through pushFFB and need no serial port.
+ *
+ * @param state The state to initialise
+ * @param type Where the game's force feedback comes from
+ * @param serialPath The serial port of the drive board, or NULL
+ * @returns The status of the operation
+ */
 FFBStatus initFFB(FFBState *state, FFBEmulationType type, char *serialPath)
 {
-    debug(0, "Init ffb %s\n", serialPath);
+    debug(1, "Init ffb %s\n", serialPath ? serialPath : "from the analogue outputs");
     state->type = type;
     state->serial = -1;
     state->controller = -1;
+    state->pending = 0;
+    state->commandLength = 0;
+    state->link.fd = -1;
+    state->link.holdIO = -1;
+    state->link.address[0] = '\0';
+    memset(state->channels, 0, sizeof(state->channels));
+    memset(state->applied, 0, sizeof(state->applied));
+    memset(state->channelEffects, 0, sizeof(state->channelEffects));
 
-    if (createThread(ffbThread, state) != THREAD_STATUS_SUCCESS)
+    if ((state->wakeIO = eventfd(0, EFD_CLOEXEC)) < 0)
         return FFB_STATUS_ERROR;
 
+    if (type == FFB_EMULATION_TYPE_ANALOGUE)
+        return FFB_STATUS_SUCCESS;
+
+    const DriveBoard *board = getDriveBoard(type);
+    for (int i = 0; i < FFB_MAX_CHANNELS; i++)
+        state->wantedEffects[i] = i < DRIVE_CHANNELS ? driveBoardEffects[i] : FFB_EFFECT_NONE;
+    state->channels[DRIVE_TORQUE] = FFB_CENTRE;
+
+    if (!board || !serialPath || !openSerialLink(&state->link, serialPath, board->baud))
+    {
+        debug(0, "Error: Could not open the drive board at %s\n", serialPath ? serialPath : "(none)");
+        closeFFB(state);
+        return FFB_STATUS_ERROR;
+    }
+
+    state->serial = state->link.fd;
+    debug(1, "Debug: Emulating a %s drive board on %s\n", board->name, serialPath);
     return FFB_STATUS_SUCCESS;
 }
 
 FFBStatus closeFFB(FFBState *state)
 {
+    unbindController(state);
+
+    if (state->wakeIO >= 0)
+        close(state->wakeIO);
+    state->wakeIO = -1;
+
+    closeSerialLink(&state->link);
     state->serial = -1;
     return FFB_STATUS_SUCCESS;
 }
 
+/**
+ * Bind the controller the effects are played on
+ *
+ * Every channel's effect is uploaded and started here with no force,
+ * afterwards the FFB thread only changes them in place. Channels whose
+ * effect the controller can't play are switched off until the next bind.
+ *
+ * @param state The force feedback state
+ * @param controller An evdev file descriptor opened for writing, owned by the state once bound
+ * @returns The status of the operation
+ */
 FFBStatus bindController(FFBState *state, int controller)
 {
     if (state->controller > -1)
         return FFB_STATUS_ERROR_CONTROLLED_ALREADY_BOUND;
 
+    unsigned long features[(FF_MAX + BITS_PER_LONG) / BITS_PER_LONG] = {0};
+    if (ioctl(controller, EVIOCGBIT(EV_FF, sizeof(features)), features) < 0)
+    {
+        debug(0, "Error: The force feedback controller does not support effects\n");
+        return FFB_STATUS_ERROR;
+    }
+
+    /* Only channels the controller is known to play are marked, so nothing is sent while unbound */
+    memcpy(state->channelEffects, state->wantedEffects, sizeof(state->channelEffects));
+
+    for (int i = 0; i < FFB_MAX_CHANNELS; i++)
+    {
+        FFBEffectType type = state->channelEffects[i];
+        if (type == FFB_EFFECT_NONE)
+            continue;
+
+        int feature = getEffectFeature(type);
+        if (!testBit(feature, features))
+        {
+            debug(0, "Warning: The controller can't play the effect for channel %d\n", i + 1);
+            state->channelEffects[i] = FFB_EFFECT_NONE;
+            continue;
+        }
+
+        struct ff_effect *effect = &state->effects[i];
+        memset(effect, 0, sizeof(struct ff_effect));
+        effect->type = feature;
+        effect->id = -1;
+        effect->direction = FFB_DIRECTION_WHEEL;
+        setEffectValue(effect, type, type == FFB_EFFECT_CONSTANT ? FFB_CENTRE : 0);
+        state->applied[i] = type == FFB_EFFECT_CONSTANT ? FFB_CENTRE : 0;
+
+        if (ioctl(controller, EVIOCSFF, effect) < 0)
+        {
+            debug(0, "Warning: Failed to upload the effect for channel %d\n", i + 1);
+            state->channelEffects[i] = FFB_EFFECT_NONE;
+            continue;
+        }
+
+        struct input_event play = {.type = EV_FF, .code = effect->id, .value = 1};
+        if (write(controller, &play, sizeof(play)) != sizeof(play))
+        {
+            debug(0, "Warning: Failed to start the effect for channel %d\n", i + 1);
+            ioctl(controller, EVIOCRMFF, effect->id);
+            state->channelEffects[i] = FFB_EFFECT_NONE;
+        }
+    }
+
+    /* Wheels centre themselves unless told not to, which would fight a spring from the game */
+    for (int i = 0; i < FFB_MAX_CHANNELS; i++)
+    {
+        if (state->channelEffects[i] == FFB_EFFECT_SPRING && testBit(FF_AUTOCENTER, features))
+        {
+            struct input_event autocenter = {.type = EV_FF, .code = FF_AUTOCENTER, .value = 0};
+            if (write(controller, &autocenter, sizeof(autocenter)) != sizeof(autocenter))
+                debug(1, "Warning: Failed to turn off the controller's autocentre\n");
+            break;
+        }
+    }
+
     state->controller = controller;
 
     return FFB_STATUS_SUCCESS;
 }
 
-void *ffbThread(void *_args)
+/**
+ * Remove the effects from the bound controller and close it
+ *
+ * The FFB thread must be stopped first. The controller may already be
+ * gone, in which case there is nothing to remove.
+ *
+ * @param state The force feedback state
+ */
+void unbindController(FFBState *state)
 {
-    FFBState *args = (FFBState *)_args;
+    if (state->controller < 0)
+        return;
+
+    for (int i = 0; i < FFB_MAX_CHANNELS; i++)
+    {
+        if (state->channelEffects[i] != FFB_EFFECT_NONE)
+            ioctl(state->controller, EVIOCRMFF, state->effects[i].id);
+    }
+    close(state->controller);
+    state->controller = -1;
+    memset(state->channelEffects, 0, sizeof(state->channelEffects));
+}
+
+/**
+ * Start the FFB thread
+ *
+ * The thread is managed by the thread manager, so it is started
+ * again every time the inputs are reinitialised.
+ *
+ * @param state The bound force feedback state
+ * @returns The status of the operation
+ */
+FFBStatus startFFB(FFBState *state)
+{
+    if (createThread(state->type == FFB_EMULATION_TYPE_ANALOGUE ? analogueThread : driveBoardThread, state) != THREAD_STATUS_SUCCESS)
+        return FFB_STATUS_ERROR;
+
+    return FFB_STATUS_SUCCESS;
+}
+
+/**
+ * Hand a new analogue output value to the FFB thread
+ *
+ * Never blocks. Only the latest value of each channel is kept, and the
+ * thread is only woken when it has nothing pending already.
+ *
+ * @param state The force feedback state
+ * @param channel The analogue output channel, counting from 0
+ * @param value The value the game wrote
+ */
+void pushFFB(FFBState *state, int channel, unsigned short value)
+{
+    if (state->type != FFB_EMULATION_TYPE_ANALOGUE || channel < 0 || channel >= FFB_MAX_CHANNELS ||
+        state->channelEffects[channel] == FFB_EFFECT_NONE)
+        return;
+
+    __atomic_store_n(&state->channels[channel], value, __ATOMIC_RELAXED);
+    if (__atomic_fetch_or(&state->pending, 1u << channel, __ATOMIC_RELEASE) == 0)
+        wakeFFB(state);
+}
+
+void wakeFFB(FFBState *state)
+{
+    uint64_t counter = 1;
+    if (state->wakeIO >= 0 && write(state->wakeIO, &counter, sizeof(counter)) != sizeof(counter))
+        debug(1, "Warning: Failed to wake the FFB thread\n");
+}
+
+/* Play the channels marked in pending, skipping any already at their value */
+static void updateEffects(FFBState *state, unsigned int pending)
+{
+    for (int i = 0; i < FFB_MAX_CHANNELS && pending; i++, pending >>= 1)
+    {
+        if (!(pending & 1) || state->channelEffects[i] == FFB_EFFECT_NONE)
+            continue;
+
+        unsigned short value = __atomic_load_n(&state->channels[i], __ATOMIC_RELAXED);
+        if (value == state->applied[i])
+            continue;
+
+        /* Updating an uploaded effect changes it while it keeps playing */
+        setEffectValue(&state->effects[i], state->channelEffects[i], value);
+        if (ioctl(state->controller, EVIOCSFF, &state->effects[i]) < 0)
+        {
+            debug(1, "Warning: Failed to update the effect for channel %d\n", i + 1);
+            continue;
+        }
+        state->applied[i] = value;
+    }
+}
+
+static void *analogueThread(void *_args)
+{
+    FFBState *state = (FFBState *)_args;
+    uint64_t counter;
+
+    while (getThreadsRunning())
+    {
+        if (read(state->wakeIO, &counter, sizeof(counter)) != sizeof(counter) && errno != EINTR)
+            break;
+
+        updateEffects(state, __atomic_exchange_n(&state->pending, 0, __ATOMIC_ACQUIRE));
+    }
+
+    return 0;
+}
+
+/*
+ * Drive boards are served from the FFB thread itself. Each read is
+ * decoded in full before the effects are touched, so a burst of commands
+ * costs at most one update per channel, and a read never takes more than
+ * a buffer's worth of bytes so the wheel is never far behind the game.
+ */
+static void *driveBoardThread(void *_args)
+{
+    FFBState *state = (FFBState *)_args;
+    const DriveBoard *board = getDriveBoard(state->type);
+    unsigned char buffer[64];
+    uint64_t counter;
+
+    struct pollfd fds[2] = {
+        {.fd = state->wakeIO, .events = POLLIN},
+        {.fd = state->serial, .events = POLLIN},
+    };
+
+    while (getThreadsRunning())
+    {
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        if ((fds[0].revents & POLLIN) && read(state->wakeIO, &counter, sizeof(counter)) != sizeof(counter))
+            break;
+
+        if (fds[1].revents & (POLLERR | POLLHUP | POLLNVAL))
+        {
+            debug(0, "Error: Lost the connection to the %s drive board\n", board->name);
+            break;
+        }
+
+        if (!(fds[1].revents & POLLIN))
+            continue;
+
+        int bytes = read(state->serial, buffer, sizeof(buffer));
+        for (int i = 0; i < bytes; i++)
+            board->decode(state, buffer[i]);
 
-    debug(0, "Hello from the thread %d\n", args->serial);
+        updateEffects(state, state->pending);
+        state->pending = 0;
+    }
 
     return 0;
 }
@@ -2,6 +2,15 @@
 #define FFB_H_
 
 #include <pthread.h>
+#include <linux/input.h>
+
+#include "hardware/transport.h"
+
+/* Analogue output channels that can drive an effect, one effect per channel */
+#define FFB_MAX_CHANNELS 8
+
+/* Longest command a drive board takes */
+#define FFB_MAX_COMMAND_SIZE 8
 
 typedef enum
 {
@@ -13,19 +22,53 @@ typedef enum
 typedef enum
 {
     FFB_EMULATION_TYPE_SEGA,
-    FFB_EMULATION_TYPE_NAMCO
+    FFB_EMULATION_TYPE_NAMCO,
+    FFB_EMULATION_TYPE_ANALOGUE
 } FFBEmulationType;
 
+typedef enum
+{
+    FFB_EFFECT_NONE,
+    FFB_EFFECT_CONSTANT,
+    FFB_EFFECT_SPRING,
+    FFB_EFFECT_FRICTION,
+    FFB_EFFECT_RUMBLE
+} FFBEffectType;
+
 typedef struct
 {
     FFBEmulationType type;
     int controller;
     int serial;
     pthread_t threadID;
+    int wakeIO;
+    SerialLink link;
+
+    /* The effect asked of each channel, and what the bound controller can play of them */
+    FFBEffectType wantedEffects[FFB_MAX_CHANNELS];
+    FFBEffectType channelEffects[FFB_MAX_CHANNELS];
+
+    /* Latest value of each channel and which have changed, written by the bus responder */
+    unsigned short channels[FFB_MAX_CHANNELS];
+    unsigned int pending;
+
+    /* The effects on the controller, only touched by the FFB thread once bound */
+    struct ff_effect effects[FFB_MAX_CHANNELS];
+    unsigned short applied[FFB_MAX_CHANNELS];
+
+    /* The drive board command being received, only touched by the FFB thread */
+    unsigned char command[FFB_MAX_COMMAND_SIZE];
+    int commandLength;
 } FFBState;
 
 FFBStatus initFFB(FFBState *state, FFBEmulationType type, char *serialPath);
 FFBStatus bindController(FFBState *state, int controller);
+void unbindController(FFBState *state);
+FFBStatus startFFB(FFBState *state);
+void pushFFB(FFBState *state, int channel, unsigned short value);
+void wakeFFB(FFBState *state);
 FFBStatus closeFFB(FFBState *state);
+FFBEffectType ffbEffectFromString(const char *name);
+FFBEmulationType ffbEmulationFromString(const char *name);
 
 #endif // FFB_H_
@@ -1,8 +1,20 @@
 #include "hardware/device.h"
+#include "hardware/transport.h"
 #include "console/debug.h"
 
+#include <poll.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#ifdef USE_LIBURING
+#include <liburing.h>
+#endif
+
 #ifdef USE_LIBGPIOD
 #include <gpiod.h>
+#include <pthread.h>
 
 #define GPIO_CONSUMER_NAME "modernjvs"
 
@@ -102,11 +114,19 @@ static int detect_gpio_chip_number(void)
 }
 
 #ifdef GPIOD_API_V2
-// libgpiod v2 API - we need to keep track of line requests per pin
-// Note: This implementation assumes single-threaded access to GPIO
-static struct gpiod_line_request *line_request = NULL;
-static int current_pin = -1;
-static int current_direction = -1;
+// libgpiod v2 API - we keep one line request per pin so that several pins,
+// such as the sense lines of more than one bus, can be held at the same time
+#define GPIO_MAX_LINES 16
+
+typedef struct
+{
+  struct gpiod_line_request *request;
+  int pin;
+  int direction;
+} GPIOLine;
+
+static GPIOLine gpio_lines[GPIO_MAX_LINES];
+static pthread_mutex_t gpio_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 // Helper function to open GPIO chip
 static struct gpiod_chip *open_gpio_chip(void)
@@ -116,176 +136,672 @@ static struct gpiod_chip *open_gpio_chip(void)
   snprintf(chip_path, sizeof(chip_path), "/dev/gpiochip%d", chip_number);
   return gpiod_chip_open(chip_path);
 }
-#endif
 
-#endif
+// Find the cached request for a pin, or a free slot to hold a new one
+static GPIOLine *get_gpio_line(int pin)
+{
+  GPIOLine *freeLine = NULL;
+  for (int i = 0; i < GPIO_MAX_LINES; i++)
+  {
+    if (gpio_lines[i].request && gpio_lines[i].pin == pin)
+      return &gpio_lines[i];
+    if (!gpio_lines[i].request && !freeLine)
+      freeLine = &gpio_lines[i];
+  }
+  return freeLine;
+}
 
-#define TIMEOUT_SELECT 200
+static void release_gpio_line(GPIOLine *line)
+{
+  if (line->request)
+  {
+    gpiod_line_request_release(line->request);
+    line->request = NULL;
+  }
+  line->pin = -1;
+  line->direction = -1;
+}
 
-int serialIO = -1;
-int localSenseLinePin = 12;
-int localSenseLineType = 0;
+// Request a single line in the given direction, with an initial value for outputs
+static int request_gpio_line(GPIOLine *line, int pin, int dir, int value)
+{
+  struct gpiod_chip *chip = open_gpio_chip();
+  if (!chip)
+    return 0;
+
+  struct gpiod_line_settings *settings = gpiod_line_settings_new();
+  if (!settings)
+  {
+    gpiod_chip_close(chip);
+    return 0;
+  }
+
+  if (dir == IN)
+  {
+    gpiod_line_settings_set_direction(settings, GPIOD_LINE_DIRECTION_INPUT);
+  }
+  else
+  {
+    gpiod_line_settings_set_direction(settings, GPIOD_LINE_DIRECTION_OUTPUT);
+    gpiod_line_settings_set_output_value(settings,
+      value == LOW ? GPIOD_LINE_VALUE_INACTIVE : GPIOD_LINE_VALUE_ACTIVE);
+  }
+
+  struct gpiod_line_config *config = gpiod_line_config_new();
+  if (!config)
+  {
+    gpiod_line_settings_free(settings);
+    gpiod_chip_close(chip);
+    return 0;
+  }
+
+  unsigned int offset = (unsigned int)pin;
+  if (gpiod_line_config_add_line_settings(config, &offset, 1, settings))
+  {
+    gpiod_line_config_free(config);
+    gpiod_line_settings_free(settings);
+    gpiod_chip_close(chip);
+    return 0;
+  }
+
+  struct gpiod_request_config *req_config = gpiod_request_config_new();
+  if (!req_config)
+  {
+    gpiod_line_config_free(config);
+    gpiod_line_settings_free(settings);
+    gpiod_chip_close(chip);
+    return 0;
+  }
+
+  gpiod_request_config_set_consumer(req_config, GPIO_CONSUMER_NAME);
+
+  line->request = gpiod_chip_request_lines(chip, req_config, config);
+
+  gpiod_request_config_free(req_config);
+  gpiod_line_config_free(config);
+  gpiod_line_settings_free(settings);
+  gpiod_chip_close(chip);
+
+  if (!line->request)
+    return 0;
+
+  line->pin = pin;
+  line->direction = dir;
+  return 1;
+}
+#endif
+
+#endif
 
-int setSerialAttributes(int fd, int myBaud);
 int setupGPIO(int pin);
 int setGPIODirection(int pin, int dir);
 int writeGPIO(int pin, int value);
 
-int initDevice(char *devicePath, int senseLineType, int senseLinePin)
+/* How long the bus can be silent before a partially read packet is dropped */
+#define BUS_IDLE_TIMEOUT 200
+
+/* Events handled per wait, the serial/socket fd, the wake eventfd and the idle timer */
+#define MAX_DEVICE_EVENTS 4
+
+static int openPollSet(JVSDevice *device)
 {
-  if ((serialIO = open(devicePath, O_RDWR | O_NOCTTY | O_SYNC | O_NDELAY)) < 0)
+  if ((device->pollIO = epoll_create1(EPOLL_CLOEXEC)) < 0)
     return 0;
 
-  /* Setup the serial connection */
-  setSerialAttributes(serialIO, B115200);
+  if ((device->wakeIO = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+    return 0;
 
-  /* Copy variables over from config */
-  localSenseLineType = senseLineType;
-  localSenseLinePin = senseLinePin;
+  if ((device->idleIO = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0)
+    return 0;
 
-  /* Setup the GPIO pins */
-  if (localSenseLineType && setupGPIO(localSenseLinePin) == -1)
-    debug(0, "Sense line pin %d not available\n", senseLinePin);
+  return watchDevice(device, device->wakeIO, 1) && watchDevice(device, device->idleIO, 1);
+}
 
-  /* Setup the GPIO pins initial state */
-  switch (senseLineType)
+static void closePollSet(JVSDevice *device)
+{
+  int *fds[] = {&device->idleIO, &device->wakeIO, &device->pollIO};
+  for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++)
   {
-  case 0:
-    debug(1, "Debug: No sense line set\n");
+    if (*fds[i] >= 0)
+      close(*fds[i]);
+    *fds[i] = -1;
+  }
+}
+
+/* Start or stop the idle timer, it repeats for as long as the bus keeps talking */
+static void armIdleTimer(JVSDevice *device, int arm)
+{
+  struct itimerspec timeout = {0};
+  if (arm)
+  {
+    timeout.it_value.tv_nsec = BUS_IDLE_TIMEOUT * 1000000L;
+    timeout.it_interval = timeout.it_value;
+  }
+
+  timerfd_settime(device->idleIO, 0, &timeout, NULL);
+  device->idleArmed = arm;
+}
+
+/* Note that data arrived, starting the idle timer if the bus was quiet */
+static void markBusActive(JVSDevice *device)
+{
+  device->busActive = 1;
+  if (!device->idleArmed)
+  {
+    armIdleTimer(device, 1);
+    device->syscalls++;
+  }
+}
+
+/* Handle the idle timer firing, returns 1 if nothing arrived for a whole period */
+static int checkBusIdle(JVSDevice *device)
+{
+  uint64_t counter;
+
+  device->syscalls++;
+  if (read(device->idleIO, &counter, sizeof(counter)) != sizeof(counter))
+    return 0;
+
+  /* Stop the timer until the bus talks again */
+  if (!device->busActive)
+  {
+    armIdleTimer(device, 0);
+    device->syscalls++;
+    return 1;
+  }
+
+  device->busActive = 0;
+  return 0;
+}
+
+#ifdef USE_LIBURING
+/*
+ * The io_uring engine keeps a read posted on the bus fd at all times,
+ * along with polls on the wake eventfd and idle timer. Responses are
+ * queued on the ring and go out with the next wait, so a request and
+ * its response normally cost a single io_uring_enter.
+ */
+#define RING_ENTRIES 8
+#define RING_BUFFER_SIZE 512
+
+typedef enum
+{
+  RING_OPERATION_READ = 1,
+  RING_OPERATION_WAKE,
+  RING_OPERATION_IDLE,
+  RING_OPERATION_WRITE,
+  RING_OPERATION_CANCEL
+} JVSRingOperation;
+
+struct JVSRing
+{
+  struct io_uring ring;
+  int fd;
+  unsigned char buffer[RING_BUFFER_SIZE];
+  int start;
+  int length;
+  int readPosted;
+  int readError;
+  int wakePosted;
+  int idlePosted;
+  int writesInFlight;
+  int writesQueued;
+};
+
+static int postRing(struct JVSRing *ring, JVSRingOperation operation, int fd, void *buffer, unsigned int length)
+{
+  struct io_uring_sqe *sqe = io_uring_get_sqe(&ring->ring);
+  if (!sqe)
+    return 0;
+
+  switch (operation)
+  {
+  case RING_OPERATION_READ:
+    io_uring_prep_read(sqe, fd, buffer, length, 0);
     break;
-  case 1:
-    debug(1, "Debug: Float/Sync sense line set\n");
-    setGPIODirection(senseLinePin, IN);
+  case RING_OPERATION_WRITE:
+    io_uring_prep_write(sqe, fd, buffer, length, 0);
     break;
-  case 2:
-    debug(1, "Debug: Complex sense line set\n");
-    setGPIODirection(senseLinePin, OUT);
+  case RING_OPERATION_CANCEL:
+    /* Whatever is cancelled is found by the operation it was posted with */
+    io_uring_prep_cancel(sqe, buffer, 0);
     break;
   default:
-    debug(0, "Debug: Invalid sense line type set\n");
+    /* The eventfd and timerfd are non-blocking, so poll them rather than read */
+    io_uring_prep_poll_add(sqe, fd, POLLIN);
     break;
   }
 
-  /* Initially float the sense line */
-  setSenseLine(0);
+  io_uring_sqe_set_data(sqe, (void *)(uintptr_t)operation);
+  return 1;
+}
+
+/* Handle every completion waiting on the ring, idle is set if the bus went quiet, returns 0 if the bus failed */
+static int reapRing(JVSDevice *device, int *idle)
+{
+  struct JVSRing *ring = device->ring;
+  struct io_uring_cqe *cqe;
+  uint64_t counter;
+  int status = 1;
+
+  while (io_uring_peek_cqe(&ring->ring, &cqe) == 0)
+  {
+    switch ((JVSRingOperation)(uintptr_t)io_uring_cqe_get_data(cqe))
+    {
+    case RING_OPERATION_READ:
+      ring->readPosted = 0;
+      if (cqe->res > 0)
+      {
+        ring->start = 0;
+        ring->length = cqe->res;
+        ring->readError = 0;
+      }
+      else if (cqe->res < 0 && cqe->res != -EAGAIN && cqe->res != -EINTR)
+      {
+        /* A bus that has gone away fails every read, so only say so once */
+        if (cqe->res != ring->readError)
+          debug(0, "Error: Failed to read from the bus: %s\n", strerror(-cqe->res));
+        ring->readError = cqe->res;
+        status = 0;
+      }
+      else
+      {
+        *idle = 1;
+      }
+      break;
+    case RING_OPERATION_WAKE:
+      ring->wakePosted = 0;
+      device->syscalls++;
+      if (read(device->wakeIO, &counter, sizeof(counter)) == sizeof(counter))
+        device->interrupted = 1;
+      break;
+    case RING_OPERATION_IDLE:
+      ring->idlePosted = 0;
+      if (checkBusIdle(device))
+        *idle = 1;
+      break;
+    case RING_OPERATION_WRITE:
+      ring->writesInFlight--;
+      if (cqe->res < 0)
+        debug(0, "Error: Failed to write to the bus: %s\n", strerror(-cqe->res));
+      break;
+    case RING_OPERATION_CANCEL:
+      break;
+    }
+    io_uring_cqe_seen(&ring->ring, cqe);
+  }
+
+  return status;
+}
+
+/* Post whatever reads are missing, submit queued writes and wait for a completion */
+static int waitRing(JVSDevice *device, int *idle)
+{
+  struct JVSRing *ring = device->ring;
+
+  if (!ring->readPosted && ring->length == 0)
+    ring->readPosted = postRing(ring, RING_OPERATION_READ, ring->fd, ring->buffer, sizeof(ring->buffer));
+  if (!ring->wakePosted)
+    ring->wakePosted = postRing(ring, RING_OPERATION_WAKE, device->wakeIO, NULL, 0);
+  if (!ring->idlePosted)
+    ring->idlePosted = postRing(ring, RING_OPERATION_IDLE, device->idleIO, NULL, 0);
+
+  /* Queued writes complete straight away, so wait for something beyond them */
+  unsigned int waitCount = 1 + ring->writesQueued;
+
+  device->syscalls++;
+  ring->writesQueued = 0;
+  int result = io_uring_submit_and_wait(&ring->ring, waitCount);
+
+  return reapRing(device, idle) && result >= 0;
+}
+
+int attachDeviceRing(JVSDevice *device, int fd)
+{
+  struct JVSRing *ring = calloc(1, sizeof(struct JVSRing));
+  if (!ring)
+    return 0;
+
+  if (io_uring_queue_init(RING_ENTRIES, &ring->ring, 0) < 0)
+  {
+    debug(1, "Debug: io_uring is not available, using epoll for bus I/O\n");
+    free(ring);
+    return 0;
+  }
+
+  /* io_uring fails reads on non-blocking files straight away rather than parking them */
+  int flags = fcntl(fd, F_GETFL);
+  if (flags < 0 || fcntl(fd, F_SETFL, flags & ~O_NONBLOCK) < 0)
+  {
+    io_uring_queue_exit(&ring->ring);
+    free(ring);
+    return 0;
+  }
 
+  ring->fd = fd;
+  device->ring = ring;
+  debug(1, "Debug: Using io_uring for bus I/O\n");
   return 1;
 }
 
-int closeDevice(void)
+void detachDeviceRing(JVSDevice *device)
 {
-  tcflush(serialIO, TCIOFLUSH);
-  
-#ifdef USE_LIBGPIOD
-#ifdef GPIOD_API_V2
-  // Clean up libgpiod v2 resources
-  if (line_request)
+  struct JVSRing *ring = device->ring;
+  if (!ring)
+    return;
+
+  device->ring = NULL;
+
+  /* The kernel can still write into the buffer while the read is posted, so cancel everything and wait for it all to come back */
+  JVSRingOperation operations[] = {RING_OPERATION_READ, RING_OPERATION_WAKE, RING_OPERATION_IDLE, RING_OPERATION_WRITE};
+  int *posted[] = {&ring->readPosted, &ring->wakePosted, &ring->idlePosted, &ring->writesInFlight};
+
+  for (int i = 0; i < 4; i++)
   {
-    gpiod_line_request_release(line_request);
-    line_request = NULL;
+    if (*posted[i])
+      postRing(ring, RING_OPERATION_CANCEL, -1, (void *)(uintptr_t)operations[i], 0);
   }
-  current_pin = -1;
-  current_direction = -1;
-#else
-  // Clean up libgpiod v1 cached chip
-  if (cached_chip_v1)
+  io_uring_submit(&ring->ring);
+
+  struct __kernel_timespec timeout = {.tv_sec = 1, .tv_nsec = 0};
+  while (ring->readPosted || ring->wakePosted || ring->idlePosted || ring->writesInFlight > 0)
   {
-    gpiod_chip_close(cached_chip_v1);
-    cached_chip_v1 = NULL;
-    cached_chip_number_v1 = -1;
+    struct io_uring_cqe *cqe;
+    if (io_uring_wait_cqe_timeout(&ring->ring, &cqe, &timeout) < 0)
+    {
+      /* Better to leave the ring be than free memory the kernel may still use */
+      debug(0, "Error: Failed to cancel the reads and writes on the bus\n");
+      return;
+    }
+
+    switch ((JVSRingOperation)(uintptr_t)io_uring_cqe_get_data(cqe))
+    {
+    case RING_OPERATION_READ:
+      ring->readPosted = 0;
+      break;
+    case RING_OPERATION_WAKE:
+      ring->wakePosted = 0;
+      break;
+    case RING_OPERATION_IDLE:
+      ring->idlePosted = 0;
+      break;
+    case RING_OPERATION_WRITE:
+      ring->writesInFlight--;
+      break;
+    case RING_OPERATION_CANCEL:
+      break;
+    }
+    io_uring_cqe_seen(&ring->ring, cqe);
   }
-#endif
-#endif
-  
-  return close(serialIO) == 0;
+
+  io_uring_queue_exit(&ring->ring);
+  free(ring);
 }
 
-int readBytes(unsigned char *buffer, int amount)
+int readDeviceRing(JVSDevice *device, unsigned char *buffer, int amount)
 {
-  fd_set fd_serial;
-  struct timeval tv;
+  struct JVSRing *ring = device->ring;
+
+  while (ring->length == 0)
+  {
+    if (device->interrupted)
+    {
+      device->interrupted = 0;
+      return -1;
+    }
 
-  FD_ZERO(&fd_serial);
-  FD_SET(serialIO, &fd_serial);
+    int idle = 0;
+    if (!waitRing(device, &idle) || (ring->length == 0 && idle))
+      return -1;
+  }
 
-  tv.tv_sec = 0;
-  tv.tv_usec = TIMEOUT_SELECT * 1000;
+  /* Don't hold the response back while we are still working through buffered input */
+  if (ring->writesQueued)
+  {
+    device->syscalls++;
+    ring->writesQueued = 0;
+    io_uring_submit(&ring->ring);
+  }
 
-  int filesReadyToRead = select(serialIO + 1, &fd_serial, NULL, NULL, &tv);
+  markBusActive(device);
 
-  if (filesReadyToRead < 1)
-    return -1;
+  int bytesRead = ring->length < amount ? ring->length : amount;
+  memcpy(buffer, ring->buffer + ring->start, bytesRead);
+  ring->start += bytesRead;
+  ring->length -= bytesRead;
+  return bytesRead;
+}
+
+int writeDeviceRing(JVSDevice *device, unsigned char *buffer, int amount)
+{
+  struct JVSRing *ring = device->ring;
 
-  if (!FD_ISSET(serialIO, &fd_serial))
+  /* The caller reuses its buffer, so the last response must be out first */
+  while (ring->writesInFlight > 0)
+  {
+    int idle = 0;
+    if (!waitRing(device, &idle))
+      return -1;
+  }
+
+  if (!postRing(ring, RING_OPERATION_WRITE, ring->fd, buffer, amount))
     return -1;
 
-  return read(serialIO, buffer, amount);
+  ring->writesInFlight++;
+  ring->writesQueued++;
+  return amount;
+}
+#else
+int attachDeviceRing(JVSDevice *device, int fd)
+{
+  (void)device;
+  (void)fd;
+  return 0;
 }
 
-int writeBytes(unsigned char *buffer, int amount)
+void detachDeviceRing(JVSDevice *device)
 {
-  return write(serialIO, buffer, amount);
+  (void)device;
 }
 
-/* Sets the configuration of the serial port */
-int setSerialAttributes(int fd, int myBaud)
+int readDeviceRing(JVSDevice *device, unsigned char *buffer, int amount)
 {
-  struct termios options;
-  int status;
-  tcgetattr(fd, &options);
+  (void)device;
+  (void)buffer;
+  (void)amount;
+  return -1;
+}
 
-  cfmakeraw(&options);
-  cfsetispeed(&options, myBaud);
-  cfsetospeed(&options, myBaud);
+int writeDeviceRing(JVSDevice *device, unsigned char *buffer, int amount)
+{
+  (void)device;
+  (void)buffer;
+  (void)amount;
+  return -1;
+}
+#endif
 
-  options.c_cflag |= (CLOCAL | CREAD);
-  options.c_cflag &= ~PARENB;
-  options.c_cflag &= ~CSTOPB;
-  options.c_cflag &= ~CSIZE;
-  options.c_cflag |= CS8;
-  options.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG);
-  options.c_oflag &= ~OPOST;
+int initDevice(JVSDevice *device, char *devicePath, int senseLineType, int senseLinePin, int lowLatency, int latencyProbe)
+{
+  const char *address;
+
+  device->transport = getTransport(devicePath, &address);
+  device->serialIO = -1;
+  device->listenIO = -1;
+  device->address[0] = '\0';
+  device->pollIO = -1;
+  device->wakeIO = -1;
+  device->idleIO = -1;
+  device->idleArmed = 0;
+  device->busActive = 0;
+  device->interrupted = 0;
+  device->ring = NULL;
+  device->syscalls = 0;
+  device->lowLatency = lowLatency;
+  device->latencyProbe = latencyProbe;
+  device->latencyTimer = -1;
+  device->latencyTimerPath[0] = '\0';
+  device->serialFlags = -1;
+
+  if (!openPollSet(device))
+  {
+    closePollSet(device);
+    return 0;
+  }
 
-  options.c_cc[VMIN] = 0;
-  options.c_cc[VTIME] = 0; // One seconds (10 deciseconds)
+  if (!device->transport->open(device, address))
+  {
+    closePollSet(device);
+    return 0;
+  }
 
-  tcsetattr(fd, TCSANOW, &options);
+  debug(1, "Debug: Using the %s transport for %s\n", device->transport->name, devicePath);
 
-  ioctl(fd, TIOCMGET, &status);
+  /* Copy variables over from config */
+  device->senseLineType = senseLineType;
+  device->senseLinePin = senseLinePin;
 
-  status |= TIOCM_DTR;
-  status |= TIOCM_RTS;
+  /* Setup the GPIO pins */
+  if (device->senseLineType && setupGPIO(device->senseLinePin) == -1)
+    debug(0, "Sense line pin %d not available\n", senseLinePin);
 
-  ioctl(fd, TIOCMSET, &status);
+  /* Setup the GPIO pins initial state */
+  switch (senseLineType)
+  {
+  case 0:
+    debug(1, "Debug: No sense line set\n");
+    break;
+  case 1:
+    debug(1, "Debug: Float/Sync sense line set\n");
+    setGPIODirection(senseLinePin, IN);
+    break;
+  case 2:
+    debug(1, "Debug: Complex sense line set\n");
+    setGPIODirection(senseLinePin, OUT);
+    break;
+  default:
+    debug(0, "Debug: Invalid sense line type set\n");
+    break;
+  }
+
+  /* Initially float the sense line */
+  setSenseLine(device, 0);
+
+  return 1;
+}
+
+int closeDevice(JVSDevice *device)
+{
+  /* Only give back our own sense line, other buses may still be using the chip */
+  if (device->senseLineType)
+    releaseGPIO(device->senseLinePin);
+
+  detachDeviceRing(device);
 
-  usleep(100 * 1000); // 10mS
+  int closed = device->transport->close(device);
+  device->serialIO = -1;
+  device->listenIO = -1;
 
-  struct serial_struct serial_settings;
+  closePollSet(device);
+  return closed;
+}
+
+/**
+ * Add or remove a file descriptor from the device's poll set
+ *
+ * @param device The device the fd belongs to
+ * @param fd The file descriptor to watch for input
+ * @param watch 1 to start watching, 0 to stop
+ * @returns 1 on success, 0 on failure
+ */
+int watchDevice(JVSDevice *device, int fd, int watch)
+{
+  struct epoll_event event = {.events = EPOLLIN, .data.fd = fd};
+  return epoll_ctl(device->pollIO, watch ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, fd, &event) == 0;
+}
 
-  // Try to set ASYNC_LOW_LATENCY flag if supported by the device
-  // This ioctl is not supported by all serial devices (e.g., Bluetooth serial ports)
-  // so we check for errors and continue gracefully if it fails
-  if (ioctl(fd, TIOCGSERIAL, &serial_settings) == 0)
+/**
+ * Wait for a file descriptor to have input
+ *
+ * Blocks until the fd is readable, the device is woken or the
+ * bus has been idle for longer than BUS_IDLE_TIMEOUT. The idle timer
+ * only runs while data is arriving, so a quiet bus doesn't wake us.
+ *
+ * @param device The device to wait on
+ * @param fd The file descriptor to wait for, it must be in the poll set
+ * @returns 1 if the fd is readable, 0 if woken or idle
+ */
+int waitDevice(JVSDevice *device, int fd)
+{
+  struct epoll_event events[MAX_DEVICE_EVENTS];
+  uint64_t counter;
+
+  while (1)
   {
-    serial_settings.flags |= ASYNC_LOW_LATENCY;
-    if (ioctl(fd, TIOCSSERIAL, &serial_settings) != 0)
+    /* A wake that came in alongside data is handled on the next wait */
+    if (device->interrupted)
     {
-      // Failed to set serial settings, but continue anyway
-      // This is not critical for operation
-      debug(1, "Warning: Could not set ASYNC_LOW_LATENCY flag (not supported by device)\n");
+      device->interrupted = 0;
+      return 0;
     }
+
+    device->syscalls++;
+    int eventCount = epoll_wait(device->pollIO, events, MAX_DEVICE_EVENTS, -1);
+    if (eventCount < 0)
+      return 0;
+
+    int ready = 0, idle = 0;
+    for (int i = 0; i < eventCount; i++)
+    {
+      if (events[i].data.fd == fd)
+      {
+        ready = 1;
+      }
+      else if (events[i].data.fd == device->wakeIO)
+      {
+        device->syscalls++;
+        if (read(device->wakeIO, &counter, sizeof(counter)) == sizeof(counter))
+          device->interrupted = 1;
+      }
+      else if (events[i].data.fd == device->idleIO)
+      {
+        idle = checkBusIdle(device);
+      }
+    }
+
+    if (ready)
+    {
+      markBusActive(device);
+      return 1;
+    }
+
+    if (idle)
+      return 0;
   }
-  else
-  {
-    // Device doesn't support TIOCGSERIAL (e.g., Bluetooth serial port)
-    // This is normal for some device types, continue without setting the flag
-    debug(1, "Serial device does not support TIOCGSERIAL ioctl (normal for Bluetooth devices)\n");
-  }
+}
 
-  tcflush(serialIO, TCIOFLUSH);
-  usleep(100 * 1000); // Required to make flush work, for some reason
+/**
+ * Wake anything waiting on the device
+ *
+ * This is safe to call from a signal handler.
+ *
+ * @param device The device to wake
+ * @returns 1 on success, 0 on failure
+ */
+int wakeDevice(JVSDevice *device)
+{
+  uint64_t counter = 1;
+  return write(device->wakeIO, &counter, sizeof(counter)) == sizeof(counter);
+}
 
-  return 0;
+int readBytes(JVSDevice *device, unsigned char *buffer, int amount)
+{
+  return device->transport->read(device, buffer, amount);
+}
+
+int writeBytes(JVSDevice *device, unsigned char *buffer, int amount)
+{
+  return device->transport->write(device, buffer, amount);
 }
 
 #ifdef USE_LIBGPIOD
@@ -312,255 +828,100 @@ int setupGPIO(int pin)
 
 int setGPIODirection(int pin, int dir)
 {
-  struct gpiod_chip *chip = open_gpio_chip();
-  if (!chip)
-    return 0;
-  
-  // Release existing request only if we're changing pins or direction
-  if (line_request && (current_pin != pin || current_direction != dir))
-  {
-    gpiod_line_request_release(line_request);
-    line_request = NULL;
-    current_pin = -1;
-    current_direction = -1;
-  }
-  
-  // If we already have a request for this pin and direction, reuse it
-  if (line_request && current_pin == pin && current_direction == dir)
-  {
-    gpiod_chip_close(chip);
-    return 1;
-  }
-  
-  struct gpiod_line_settings *settings = gpiod_line_settings_new();
-  if (!settings)
-  {
-    gpiod_chip_close(chip);
-    return 0;
-  }
-  
-  if (dir == IN)
-  {
-    gpiod_line_settings_set_direction(settings, GPIOD_LINE_DIRECTION_INPUT);
-  }
-  else
-  {
-    gpiod_line_settings_set_direction(settings, GPIOD_LINE_DIRECTION_OUTPUT);
-    gpiod_line_settings_set_output_value(settings, GPIOD_LINE_VALUE_INACTIVE);
-  }
-  
-  struct gpiod_line_config *config = gpiod_line_config_new();
-  if (!config)
-  {
-    gpiod_line_settings_free(settings);
-    gpiod_chip_close(chip);
-    return 0;
-  }
-  
-  unsigned int offset = (unsigned int)pin;
-  int ret = gpiod_line_config_add_line_settings(config, &offset, 1, settings);
-  if (ret)
-  {
-    gpiod_line_config_free(config);
-    gpiod_line_settings_free(settings);
-    gpiod_chip_close(chip);
-    return 0;
-  }
-  
-  struct gpiod_request_config *req_config = gpiod_request_config_new();
-  if (!req_config)
+  pthread_mutex_lock(&gpio_mutex);
+
+  GPIOLine *line = get_gpio_line(pin);
+  if (!line)
   {
-    gpiod_line_config_free(config);
-    gpiod_line_settings_free(settings);
-    gpiod_chip_close(chip);
+    pthread_mutex_unlock(&gpio_mutex);
     return 0;
   }
-  
-  gpiod_request_config_set_consumer(req_config, GPIO_CONSUMER_NAME);
-  
-  line_request = gpiod_chip_request_lines(chip, req_config, config);
-  
-  gpiod_request_config_free(req_config);
-  gpiod_line_config_free(config);
-  gpiod_line_settings_free(settings);
-  gpiod_chip_close(chip);
-  
-  if (line_request)
+
+  // If we already have a request for this pin and direction, reuse it
+  if (line->request && line->direction == dir)
   {
-    current_pin = pin;
-    current_direction = dir;
+    pthread_mutex_unlock(&gpio_mutex);
     return 1;
   }
-  
-  return 0;
+
+  release_gpio_line(line);
+  int result = request_gpio_line(line, pin, dir, LOW);
+
+  pthread_mutex_unlock(&gpio_mutex);
+  return result;
 }
 
 int writeGPIO(int pin, int value)
 {
-  struct gpiod_chip *chip = open_gpio_chip();
-  if (!chip)
-    return 0;
-  
-  // Release existing request if we're changing pins or if it's not configured as OUTPUT
-  if (line_request && (current_pin != pin || current_direction != OUT))
-  {
-    gpiod_line_request_release(line_request);
-    line_request = NULL;
-    current_pin = -1;
-    current_direction = -1;
-  }
-  
-  // If we already have an output request for this pin, just update the value
-  if (line_request && current_pin == pin && current_direction == OUT)
-  {
-    enum gpiod_line_value gpio_value = (value == LOW) ? GPIOD_LINE_VALUE_INACTIVE : GPIOD_LINE_VALUE_ACTIVE;
-    int ret = gpiod_line_request_set_value(line_request, pin, gpio_value);
-    gpiod_chip_close(chip);
-    return (ret == 0) ? 1 : 0;
-  }
-  
-  struct gpiod_line_settings *settings = gpiod_line_settings_new();
-  if (!settings)
-  {
-    gpiod_chip_close(chip);
-    return 0;
-  }
-  
-  gpiod_line_settings_set_direction(settings, GPIOD_LINE_DIRECTION_OUTPUT);
-  gpiod_line_settings_set_output_value(settings, 
-    value == LOW ? GPIOD_LINE_VALUE_INACTIVE : GPIOD_LINE_VALUE_ACTIVE);
-  
-  struct gpiod_line_config *config = gpiod_line_config_new();
-  if (!config)
-  {
-    gpiod_line_settings_free(settings);
-    gpiod_chip_close(chip);
-    return 0;
-  }
-  
-  unsigned int offset = (unsigned int)pin;
-  int ret = gpiod_line_config_add_line_settings(config, &offset, 1, settings);
-  if (ret)
-  {
-    gpiod_line_config_free(config);
-    gpiod_line_settings_free(settings);
-    gpiod_chip_close(chip);
-    return 0;
-  }
-  
-  struct gpiod_request_config *req_config = gpiod_request_config_new();
-  if (!req_config)
+  pthread_mutex_lock(&gpio_mutex);
+
+  GPIOLine *line = get_gpio_line(pin);
+  if (!line)
   {
-    gpiod_line_config_free(config);
-    gpiod_line_settings_free(settings);
-    gpiod_chip_close(chip);
+    pthread_mutex_unlock(&gpio_mutex);
     return 0;
   }
-  
-  gpiod_request_config_set_consumer(req_config, GPIO_CONSUMER_NAME);
-  
-  line_request = gpiod_chip_request_lines(chip, req_config, config);
-  
-  gpiod_request_config_free(req_config);
-  gpiod_line_config_free(config);
-  gpiod_line_settings_free(settings);
-  gpiod_chip_close(chip);
-  
-  if (line_request)
-  {
-    current_pin = pin;
-    current_direction = OUT;
-    return 1;
-  }
-  
-  return 0;
-}
 
-int readGPIO(int pin)
-{
-  struct gpiod_chip *chip = open_gpio_chip();
-  if (!chip)
-    return -1;
-  
-  // Release existing request if we're changing pins
-  if (line_request && current_pin != pin)
-  {
-    gpiod_line_request_release(line_request);
-    line_request = NULL;
-    current_pin = -1;
-    current_direction = -1;
-  }
-  
-  // If we don't have a request or it's not configured as input, create/recreate it
-  if (!line_request || current_direction != IN)
-  {
-    if (line_request)
-    {
-      gpiod_line_request_release(line_request);
-      line_request = NULL;
-    }
-    
-    struct gpiod_line_settings *settings = gpiod_line_settings_new();
-    if (!settings)
-    {
-      gpiod_chip_close(chip);
-      return -1;
-    }
-    
-    gpiod_line_settings_set_direction(settings, GPIOD_LINE_DIRECTION_INPUT);
-    
-    struct gpiod_line_config *config = gpiod_line_config_new();
-    if (!config)
-    {
-      gpiod_line_settings_free(settings);
-      gpiod_chip_close(chip);
-      return -1;
-    }
-    
-    unsigned int offset = (unsigned int)pin;
-    int ret = gpiod_line_config_add_line_settings(config, &offset, 1, settings);
-    if (ret)
-    {
-      gpiod_line_config_free(config);
-      gpiod_line_settings_free(settings);
-      gpiod_chip_close(chip);
-      return -1;
-    }
-    
-    struct gpiod_request_config *req_config = gpiod_request_config_new();
-    if (!req_config)
-    {
-      gpiod_line_config_free(config);
-      gpiod_line_settings_free(settings);
-      gpiod_chip_close(chip);
-      return -1;
-    }
-    
-    gpiod_request_config_set_consumer(req_config, GPIO_CONSUMER_NAME);
-    
-    line_request = gpiod_chip_request_lines(chip, req_config, config);
-    
-    gpiod_request_config_free(req_config);
-    gpiod_line_config_free(config);
-    gpiod_line_settings_free(settings);
-    
-    if (!line_request)
+  // If we already have an output request for this pin, just update the value
+  if (line->request && line->direction == OUT)
+  {
+    enum gpiod_line_value gpio_value = (value == LOW) ? GPIOD_LINE_VALUE_INACTIVE : GPIOD_LINE_VALUE_ACTIVE;
+    int ret = gpiod_line_request_set_value(line->request, pin, gpio_value);
+    pthread_mutex_unlock(&gpio_mutex);
+    return (ret == 0) ? 1 : 0;
+  }
+
+  // Otherwise (re)request the line as an output with the desired value
+  release_gpio_line(line);
+  int result = request_gpio_line(line, pin, OUT, value);
+
+  pthread_mutex_unlock(&gpio_mutex);
+  return result;
+}
+
+int readGPIO(int pin)
+{
+  pthread_mutex_lock(&gpio_mutex);
+
+  GPIOLine *line = get_gpio_line(pin);
+  if (!line)
+  {
+    pthread_mutex_unlock(&gpio_mutex);
+    return -1;
+  }
+
+  // If we don't have a request or it's not configured as input, create/recreate it
+  if (!line->request || line->direction != IN)
+  {
+    release_gpio_line(line);
+    if (!request_gpio_line(line, pin, IN, LOW))
     {
-      gpiod_chip_close(chip);
+      pthread_mutex_unlock(&gpio_mutex);
       return -1;
     }
-    
-    current_pin = pin;
-    current_direction = IN;
   }
-  
-  enum gpiod_line_value value = gpiod_line_request_get_value(line_request, pin);
-  
-  gpiod_chip_close(chip);
-  
+
+  enum gpiod_line_value value = gpiod_line_request_get_value(line->request, pin);
+
+  pthread_mutex_unlock(&gpio_mutex);
+
   return (value == GPIOD_LINE_VALUE_ACTIVE) ? 1 : 0;
 }
 
+int releaseGPIO(int pin)
+{
+  pthread_mutex_lock(&gpio_mutex);
+
+  for (int i = 0; i < GPIO_MAX_LINES; i++)
+  {
+    if (gpio_lines[i].request && gpio_lines[i].pin == pin)
+      release_gpio_line(&gpio_lines[i]);
+  }
+
+  pthread_mutex_unlock(&gpio_mutex);
+  return 1;
+}
+
 #else
 // libgpiod v1 API implementation
 
@@ -664,6 +1025,22 @@ int readGPIO(int pin)
   return value;
 }
 
+int releaseGPIO(int pin)
+{
+  struct gpiod_chip *chip = get_cached_chip_v1();
+  if (!chip)
+    return 0;
+
+  struct gpiod_line *line = gpiod_chip_get_line(chip, pin);
+  if (!line)
+    return 0;
+
+  if (gpiod_line_is_requested(line))
+    gpiod_line_release(line);
+
+  return 1;
+}
+
 #endif  // GPIOD_API_V2
 
 #else  // USE_LIBGPIOD
@@ -748,31 +1125,495 @@ int readGPIO(int pin)
   return (atoi(value_str));
 }
 
+int releaseGPIO(int pin)
+{
+  /* Sysfs pins stay exported, put the line back to a floating input */
+  return setGPIODirection(pin, IN);
+}
+
+#endif  // USE_LIBGPIOD
+
+/*
+ * GPIO banks hold a set of output lines, such as the lamps and relays
+ * driven from the general purpose outputs, so that they can all be
+ * updated together. With libgpiod the lines are requested together and
+ * set with a single call, sysfs has no way to do that so each line keeps
+ * its value file open and is written in turn.
+ */
+#ifdef USE_LIBGPIOD
+
+#ifdef GPIOD_API_V2
+struct GPIOBank
+{
+  struct gpiod_line_request *request;
+  int count;
+};
+
+GPIOBank *requestGPIOBank(const char *chipPath, const int *pins, int count)
+{
+  if (count < 1 || count > GPIO_BANK_MAX_LINES)
+    return NULL;
+
+  GPIOBank *bank = calloc(1, sizeof(GPIOBank));
+  if (!bank)
+    return NULL;
+
+  struct gpiod_chip *chip = chipPath ? gpiod_chip_open(chipPath) : open_gpio_chip();
+  if (!chip)
+  {
+    free(bank);
+    return NULL;
+  }
+
+  unsigned int offsets[GPIO_BANK_MAX_LINES];
+  for (int i = 0; i < count; i++)
+    offsets[i] = pins[i];
+
+  struct gpiod_line_settings *settings = gpiod_line_settings_new();
+  struct gpiod_line_config *config = gpiod_line_config_new();
+  struct gpiod_request_config *req_config = gpiod_request_config_new();
+
+  if (settings && config && req_config)
+  {
+    gpiod_line_settings_set_direction(settings, GPIOD_LINE_DIRECTION_OUTPUT);
+    gpiod_line_settings_set_output_value(settings, GPIOD_LINE_VALUE_INACTIVE);
+    gpiod_request_config_set_consumer(req_config, GPIO_CONSUMER_NAME);
+
+    if (gpiod_line_config_add_line_settings(config, offsets, count, settings) == 0)
+      bank->request = gpiod_chip_request_lines(chip, req_config, config);
+  }
+
+  gpiod_request_config_free(req_config);
+  gpiod_line_config_free(config);
+  gpiod_line_settings_free(settings);
+  gpiod_chip_close(chip);
+
+  if (!bank->request)
+  {
+    free(bank);
+    return NULL;
+  }
+
+  bank->count = count;
+  return bank;
+}
+
+int setGPIOBank(GPIOBank *bank, const int *values)
+{
+  enum gpiod_line_value lineValues[GPIO_BANK_MAX_LINES];
+  for (int i = 0; i < bank->count; i++)
+    lineValues[i] = values[i] ? GPIOD_LINE_VALUE_ACTIVE : GPIOD_LINE_VALUE_INACTIVE;
+
+  return gpiod_line_request_set_values(bank->request, lineValues) == 0;
+}
+
+void releaseGPIOBank(GPIOBank *bank)
+{
+  if (!bank)
+    return;
+
+  gpiod_line_request_release(bank->request);
+  free(bank);
+}
+
+struct GPIOInputs
+{
+  struct gpiod_line_request *request;
+  struct gpiod_edge_event_buffer *events;
+  unsigned int offsets[GPIO_INPUTS_MAX_LINES];
+  int count;
+};
+
+GPIOInputs *requestGPIOInputs(const int *pins, int count)
+{
+  if (count < 1 || count > GPIO_INPUTS_MAX_LINES)
+    return NULL;
+
+  GPIOInputs *inputs = calloc(1, sizeof(GPIOInputs));
+  if (!inputs)
+    return NULL;
+
+  struct gpiod_chip *chip = open_gpio_chip();
+  if (!chip || (inputs->events = gpiod_edge_event_buffer_new(GPIO_INPUTS_MAX_LINES)) == NULL)
+  {
+    if (chip)
+      gpiod_chip_close(chip);
+    free(inputs);
+    return NULL;
+  }
+
+  for (int i = 0; i < count; i++)
+    inputs->offsets[i] = pins[i];
+
+  struct gpiod_line_settings *settings = gpiod_line_settings_new();
+  struct gpiod_line_config *config = gpiod_line_config_new();
+  struct gpiod_request_config *req_config = gpiod_request_config_new();
+
+  if (settings && config && req_config)
+  {
+    gpiod_line_settings_set_direction(settings, GPIOD_LINE_DIRECTION_INPUT);
+    gpiod_line_settings_set_edge_detection(settings, GPIOD_LINE_EDGE_BOTH);
+    gpiod_line_settings_set_bias(settings, GPIOD_LINE_BIAS_PULL_UP);
+    gpiod_request_config_set_consumer(req_config, GPIO_CONSUMER_NAME);
+
+    if (gpiod_line_config_add_line_settings(config, inputs->offsets, count, settings) == 0)
+      inputs->request = gpiod_chip_request_lines(chip, req_config, config);
+  }
+
+  gpiod_request_config_free(req_config);
+  gpiod_line_config_free(config);
+  gpiod_line_settings_free(settings);
+  gpiod_chip_close(chip);
+
+  if (!inputs->request)
+  {
+    gpiod_edge_event_buffer_free(inputs->events);
+    free(inputs);
+    return NULL;
+  }
+
+  inputs->count = count;
+  return inputs;
+}
+
+int waitGPIOInputs(GPIOInputs *inputs, int timeout)
+{
+  struct pollfd event = {.fd = gpiod_line_request_get_fd(inputs->request), .events = POLLIN};
+  int ready = poll(&event, 1, timeout);
+  if (ready <= 0)
+    return ready < 0 && errno != EINTR ? -1 : 0;
+
+  /* The values are read afterwards, the events only say that something changed */
+  return gpiod_line_request_read_edge_events(inputs->request, inputs->events, GPIO_INPUTS_MAX_LINES) < 0 ? -1 : 1;
+}
+
+int readGPIOInputs(GPIOInputs *inputs, int *values)
+{
+  for (int i = 0; i < inputs->count; i++)
+  {
+    enum gpiod_line_value value = gpiod_line_request_get_value(inputs->request, inputs->offsets[i]);
+    if (value == GPIOD_LINE_VALUE_ERROR)
+      return 0;
+    values[i] = value == GPIOD_LINE_VALUE_ACTIVE;
+  }
+  return 1;
+}
+
+void releaseGPIOInputs(GPIOInputs *inputs)
+{
+  if (!inputs)
+    return;
+
+  gpiod_line_request_release(inputs->request);
+  gpiod_edge_event_buffer_free(inputs->events);
+  free(inputs);
+}
+
+#else
+/* The bank keeps its own chip handle, the sense line's cached one may be reopened */
+struct GPIOBank
+{
+  struct gpiod_chip *chip;
+  struct gpiod_line_bulk lines;
+};
+
+GPIOBank *requestGPIOBank(const char *chipPath, const int *pins, int count)
+{
+  if (count < 1 || count > GPIO_BANK_MAX_LINES)
+    return NULL;
+
+  GPIOBank *bank = calloc(1, sizeof(GPIOBank));
+  if (!bank)
+    return NULL;
+
+  bank->chip = chipPath ? gpiod_chip_open(chipPath) : gpiod_chip_open_by_number(detect_gpio_chip_number());
+  if (!bank->chip)
+  {
+    free(bank);
+    return NULL;
+  }
+
+  unsigned int offsets[GPIO_BANK_MAX_LINES];
+  int defaults[GPIO_BANK_MAX_LINES] = {0};
+  for (int i = 0; i < count; i++)
+    offsets[i] = pins[i];
+
+  if (gpiod_chip_get_lines(bank->chip, offsets, count, &bank->lines) != 0 ||
+      gpiod_line_request_bulk_output(&bank->lines, GPIO_CONSUMER_NAME, defaults) != 0)
+  {
+    gpiod_chip_close(bank->chip);
+    free(bank);
+    return NULL;
+  }
+
+  return bank;
+}
+
+int setGPIOBank(GPIOBank *bank, const int *values)
+{
+  return gpiod_line_set_value_bulk(&bank->lines, values) == 0;
+}
+
+void releaseGPIOBank(GPIOBank *bank)
+{
+  if (!bank)
+    return;
+
+  gpiod_line_release_bulk(&bank->lines);
+  gpiod_chip_close(bank->chip);
+  free(bank);
+}
+
+/* Each line has its own event fd in the v1 API, so they are polled together */
+struct GPIOInputs
+{
+  struct gpiod_chip *chip;
+  struct gpiod_line *lines[GPIO_INPUTS_MAX_LINES];
+  struct pollfd events[GPIO_INPUTS_MAX_LINES];
+  int count;
+};
+
+GPIOInputs *requestGPIOInputs(const int *pins, int count)
+{
+  if (count < 1 || count > GPIO_INPUTS_MAX_LINES)
+    return NULL;
+
+  GPIOInputs *inputs = calloc(1, sizeof(GPIOInputs));
+  if (!inputs)
+    return NULL;
+
+  if ((inputs->chip = gpiod_chip_open_by_number(detect_gpio_chip_number())) == NULL)
+  {
+    free(inputs);
+    return NULL;
+  }
+
+  for (int i = 0; i < count; i++)
+  {
+    struct gpiod_line *line = gpiod_chip_get_line(inputs->chip, pins[i]);
+    if (!line || gpiod_line_request_both_edges_events(line, GPIO_CONSUMER_NAME) != 0)
+    {
+      releaseGPIOInputs(inputs);
+      return NULL;
+    }
+
+    inputs->lines[i] = line;
+    inputs->events[i].fd = gpiod_line_event_get_fd(line);
+    inputs->events[i].events = POLLIN;
+    inputs->count = i + 1;
+  }
+
+  return inputs;
+}
+
+int waitGPIOInputs(GPIOInputs *inputs, int timeout)
+{
+  int ready = poll(inputs->events, inputs->count, timeout);
+  if (ready <= 0)
+    return ready < 0 && errno != EINTR ? -1 : 0;
+
+  struct gpiod_line_event event;
+  for (int i = 0; i < inputs->count; i++)
+  {
+    if ((inputs->events[i].revents & POLLIN) && gpiod_line_event_read(inputs->lines[i], &event) != 0)
+      return -1;
+  }
+  return 1;
+}
+
+int readGPIOInputs(GPIOInputs *inputs, int *values)
+{
+  for (int i = 0; i < inputs->count; i++)
+  {
+    if ((values[i] = gpiod_line_get_value(inputs->lines[i])) < 0)
+      return 0;
+  }
+  return 1;
+}
+
+void releaseGPIOInputs(GPIOInputs *inputs)
+{
+  if (!inputs)
+    return;
+
+  for (int i = 0; i < inputs->count; i++)
+    gpiod_line_release(inputs->lines[i]);
+  gpiod_chip_close(inputs->chip);
+  free(inputs);
+}
+#endif  // GPIOD_API_V2
+
+#else  // USE_LIBGPIOD
+
+struct GPIOBank
+{
+  int count;
+  int pins[GPIO_BANK_MAX_LINES];
+  int valueIO[GPIO_BANK_MAX_LINES];
+};
+
+GPIOBank *requestGPIOBank(const char *chipPath, const int *pins, int count)
+{
+  if (count < 1 || count > GPIO_BANK_MAX_LINES)
+    return NULL;
+
+  if (chipPath)
+    debug(0, "Warning: GPIO chips can only be picked with libgpiod, using sysfs numbering\n");
+
+  GPIOBank *bank = calloc(1, sizeof(GPIOBank));
+  if (!bank)
+    return NULL;
+
+  for (int i = 0; i < count; i++)
+  {
+    char path[100];
+    snprintf(path, sizeof(path), "/sys/class/gpio/gpio%d/value", pins[i]);
+
+    bank->pins[i] = pins[i];
+    bank->valueIO[i] = -1;
+    bank->count = i + 1;
+
+    /* The pin may already be exported, so only the direction has to work */
+    setupGPIO(pins[i]);
+    if (!setGPIODirection(pins[i], OUT) || (bank->valueIO[i] = open(path, O_WRONLY | O_CLOEXEC)) < 0)
+    {
+      releaseGPIOBank(bank);
+      return NULL;
+    }
+  }
+
+  return bank;
+}
+
+int setGPIOBank(GPIOBank *bank, const int *values)
+{
+  int success = 1;
+  for (int i = 0; i < bank->count; i++)
+  {
+    if (pwrite(bank->valueIO[i], values[i] ? "1" : "0", 1, 0) != 1)
+      success = 0;
+  }
+  return success;
+}
+
+void releaseGPIOBank(GPIOBank *bank)
+{
+  if (!bank)
+    return;
+
+  for (int i = 0; i < bank->count; i++)
+  {
+    if (bank->valueIO[i] >= 0)
+      close(bank->valueIO[i]);
+    setGPIODirection(bank->pins[i], IN);
+  }
+  free(bank);
+}
+
+/* Sysfs value files report an edge as a priority event once the edge file is set */
+struct GPIOInputs
+{
+  int count;
+  int pins[GPIO_INPUTS_MAX_LINES];
+  struct pollfd events[GPIO_INPUTS_MAX_LINES];
+};
+
+GPIOInputs *requestGPIOInputs(const int *pins, int count)
+{
+  if (count < 1 || count > GPIO_INPUTS_MAX_LINES)
+    return NULL;
+
+  GPIOInputs *inputs = calloc(1, sizeof(GPIOInputs));
+  if (!inputs)
+    return NULL;
+
+  for (int i = 0; i < count; i++)
+  {
+    char path[100];
+    int edgeIO = -1;
+
+    inputs->pins[i] = pins[i];
+    inputs->events[i].fd = -1;
+    inputs->events[i].events = POLLPRI | POLLERR;
+    inputs->count = i + 1;
+
+    setupGPIO(pins[i]);
+    snprintf(path, sizeof(path), "/sys/class/gpio/gpio%d/edge", pins[i]);
+    int edgeSet = setGPIODirection(pins[i], IN) && (edgeIO = open(path, O_WRONLY | O_CLOEXEC)) >= 0 && write(edgeIO, "both", 4) == 4;
+    if (edgeIO >= 0)
+      close(edgeIO);
+
+    snprintf(path, sizeof(path), "/sys/class/gpio/gpio%d/value", pins[i]);
+    if (!edgeSet || (inputs->events[i].fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+    {
+      releaseGPIOInputs(inputs);
+      return NULL;
+    }
+  }
+
+  return inputs;
+}
+
+int waitGPIOInputs(GPIOInputs *inputs, int timeout)
+{
+  int ready = poll(inputs->events, inputs->count, timeout);
+  if (ready <= 0)
+    return ready < 0 && errno != EINTR ? -1 : 0;
+
+  /* The event stays raised until the value is read again, which readGPIOInputs does */
+  return 1;
+}
+
+int readGPIOInputs(GPIOInputs *inputs, int *values)
+{
+  for (int i = 0; i < inputs->count; i++)
+  {
+    char value;
+    if (pread(inputs->events[i].fd, &value, 1, 0) != 1)
+      return 0;
+    values[i] = value == '1';
+  }
+  return 1;
+}
+
+void releaseGPIOInputs(GPIOInputs *inputs)
+{
+  if (!inputs)
+    return;
+
+  for (int i = 0; i < inputs->count; i++)
+  {
+    if (inputs->events[i].fd >= 0)
+      close(inputs->events[i].fd);
+  }
+  free(inputs);
+}
+
 #endif  // USE_LIBGPIOD
 
-int setSenseLine(int state)
+int setSenseLine(JVSDevice *device, int state)
 {
-  if (localSenseLineType == 0)
+  if (device->senseLineType == 0)
     return 1;
 
-  switch (localSenseLineType)
+  switch (device->senseLineType)
   {
   /* Normal Float Style */
   case 1:
   {
     if (!state)
     {
-      if (!setGPIODirection(localSenseLinePin, IN))
+      if (!setGPIODirection(device->senseLinePin, IN))
       {
-        debug(1, "Warning: Failed to float sense line %d\n", localSenseLinePin);
+        debug(1, "Warning: Failed to float sense line %d\n", device->senseLinePin);
         return 0;
       }
     }
     else
     {
-      if (!writeGPIO(localSenseLinePin, LOW))
+      if (!writeGPIO(device->senseLinePin, LOW))
       {
-        debug(1, "Warning: Failed to sink sense line %d\n", localSenseLinePin);
+        debug(1, "Warning: Failed to sink sense line %d\n", device->senseLinePin);
         return 0;
       }
     }
@@ -784,17 +1625,17 @@ int setSenseLine(int state)
   {
     if (!state)
     {
-      if (!writeGPIO(localSenseLinePin, 0))
+      if (!writeGPIO(device->senseLinePin, 0))
       {
-        debug(1, "Warning: Failed to set sense line to 1 %d\n", localSenseLinePin);
+        debug(1, "Warning: Failed to set sense line to 1 %d\n", device->senseLinePin);
         return 0;
       }
     }
     else
     {
-      if (!writeGPIO(localSenseLinePin, 1))
+      if (!writeGPIO(device->senseLinePin, 1))
       {
-        debug(1, "Warning: Failed to sink sense line %d\n", localSenseLinePin);
+        debug(1, "Warning: Failed to sink sense line %d\n", device->senseLinePin);
         return 0;
       }
     }
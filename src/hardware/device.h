@@ -19,13 +19,69 @@
 #define LOW 0
 #define HIGH 1
 
-int initDevice(char *devicePath, int senseLineType, int senseLinePin);
-int closeDevice(void);
-int readBytes(unsigned char *buffer, int amount);
-int writeBytes(unsigned char *buffer, int amount);
-int setSenseLine(int state);
+#define DEVICE_ADDRESS_LENGTH 108
+
+struct JVSTransport;
+struct JVSRing;
+
+/* A single RS485 connection and the sense line that goes with it */
+typedef struct
+{
+    const struct JVSTransport *transport;
+    int serialIO;
+    int listenIO;
+    char address[DEVICE_ADDRESS_LENGTH];
+    int pollIO;
+    int wakeIO;
+    int idleIO;
+    int idleArmed;
+    int busActive;
+    int interrupted;
+    struct JVSRing *ring;
+    unsigned long syscalls;
+    int lowLatency;
+    int latencyProbe;
+    int latencyTimer;
+    char latencyTimerPath[DEVICE_ADDRESS_LENGTH];
+    int serialFlags;
+    int senseLineType;
+    int senseLinePin;
+} JVSDevice;
+
+int initDevice(JVSDevice *device, char *devicePath, int senseLineType, int senseLinePin, int lowLatency, int latencyProbe);
+int closeDevice(JVSDevice *device);
+int readBytes(JVSDevice *device, unsigned char *buffer, int amount);
+int writeBytes(JVSDevice *device, unsigned char *buffer, int amount);
+int setSenseLine(JVSDevice *device, int state);
+int watchDevice(JVSDevice *device, int fd, int watch);
+int waitDevice(JVSDevice *device, int fd);
+int wakeDevice(JVSDevice *device);
+int attachDeviceRing(JVSDevice *device, int fd);
+void detachDeviceRing(JVSDevice *device);
+int readDeviceRing(JVSDevice *device, unsigned char *buffer, int amount);
+int writeDeviceRing(JVSDevice *device, unsigned char *buffer, int amount);
 int setupGPIO(int pin);
 int setGPIODirection(int pin, int dir);
 int readGPIO(int pin);
+int releaseGPIO(int pin);
+
+/* A group of output lines on one chip, set together in a single call */
+#define GPIO_BANK_MAX_LINES 32
+
+typedef struct GPIOBank GPIOBank;
+
+GPIOBank *requestGPIOBank(const char *chipPath, const int *pins, int count);
+int setGPIOBank(GPIOBank *bank, const int *values);
+void releaseGPIOBank(GPIOBank *bank);
+
+/* A group of input lines on the default chip, woken by an edge on any of them */
+#define GPIO_INPUTS_MAX_LINES 32
+
+typedef struct GPIOInputs GPIOInputs;
+
+GPIOInputs *requestGPIOInputs(const int *pins, int count);
+int waitGPIOInputs(GPIOInputs *inputs, int timeout);
+int readGPIOInputs(GPIOInputs *inputs, int *values);
+void releaseGPIOInputs(GPIOInputs *inputs);
 
 #endif // DEVICE_H_
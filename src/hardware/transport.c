@@ -0,0 +1,792 @@
+#define _GNU_SOURCE
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/stat.h>
+#include <limits.h>
+#include <poll.h>
+
+#include "hardware/transport.h"
+#include "console/debug.h"
+
+#define DEFAULT_TCP_HOST "127.0.0.1"
+
+/* FTDI adapters default to 16ms, which holds every response back by up to that long */
+#define LATENCY_TIMER_MINIMUM 1
+
+#define LATENCY_PROBE_COUNT 8
+#define LATENCY_PROBE_TIMEOUT 100
+#define LATENCY_PROBE_BYTE 0x55
+
+static const JVSTransport serialTransport;
+static const JVSTransport ptyTransport;
+static const JVSTransport unixTransport;
+static const JVSTransport tcpTransport;
+
+static const struct
+{
+  const char *scheme;
+  const JVSTransport *transport;
+} transportSchemes[] = {
+    {"pty:", &ptyTransport},
+    {"unix:", &unixTransport},
+    {"tcp:", &tcpTransport},
+};
+
+/**
+ * Get the transport for a device path
+ *
+ * Looks at the scheme at the start of the path and picks the
+ * transport that handles it, anything without a scheme is a serial port.
+ *
+ * @param devicePath The DEVICE_PATH from the config
+ * @param address Set to the part of the path after the scheme
+ * @returns The transport to use
+ */
+const JVSTransport *getTransport(const char *devicePath, const char **address)
+{
+  for (size_t i = 0; i < sizeof(transportSchemes) / sizeof(transportSchemes[0]); i++)
+  {
+    size_t length = strlen(transportSchemes[i].scheme);
+    if (strncmp(devicePath, transportSchemes[i].scheme, length) == 0)
+    {
+      *address = devicePath + length;
+      return transportSchemes[i].transport;
+    }
+  }
+
+  *address = devicePath;
+  return &serialTransport;
+}
+
+/* Read until the fd is drained or the buffer is full, a short read means it is empty */
+static int drainRead(JVSDevice *device, unsigned char *buffer, int amount)
+{
+  int bytesRead = 0;
+  while (bytesRead < amount)
+  {
+    ssize_t wanted = amount - bytesRead;
+    device->syscalls++;
+    ssize_t result = read(device->serialIO, buffer + bytesRead, wanted);
+    if (result > 0)
+    {
+      bytesRead += result;
+      if (result < wanted)
+        break;
+      continue;
+    }
+
+    if (result < 0 && (errno == EAGAIN || errno == EINTR))
+      break;
+
+    return bytesRead > 0 ? bytesRead : -1;
+  }
+
+  return bytesRead;
+}
+
+/* Sets the configuration of the serial port */
+static int setSerialAttributes(int fd, int myBaud)
+{
+  struct termios options;
+  int status;
+  tcgetattr(fd, &options);
+
+  cfmakeraw(&options);
+  cfsetispeed(&options, myBaud);
+  cfsetospeed(&options, myBaud);
+
+  options.c_cflag |= (CLOCAL | CREAD);
+  options.c_cflag &= ~PARENB;
+  options.c_cflag &= ~CSTOPB;
+  options.c_cflag &= ~CSIZE;
+  options.c_cflag |= CS8;
+  options.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG);
+  options.c_oflag &= ~OPOST;
+
+  options.c_cc[VMIN] = 0;
+  options.c_cc[VTIME] = 0; // One seconds (10 deciseconds)
+
+  tcsetattr(fd, TCSANOW, &options);
+
+  ioctl(fd, TIOCMGET, &status);
+
+  status |= TIOCM_DTR;
+  status |= TIOCM_RTS;
+
+  ioctl(fd, TIOCMSET, &status);
+
+  usleep(100 * 1000); // 10mS
+
+  tcflush(fd, TCIOFLUSH);
+  usleep(100 * 1000); // Required to make flush work, for some reason
+
+  return 0;
+}
+
+/* Reads and writes shared by the serial and pty transports */
+static int fdRead(JVSDevice *device, unsigned char *buffer, int amount)
+{
+  if (device->ring)
+    return readDeviceRing(device, buffer, amount);
+
+  if (!waitDevice(device, device->serialIO))
+    return -1;
+
+  return drainRead(device, buffer, amount);
+}
+
+static int fdWrite(JVSDevice *device, unsigned char *buffer, int amount)
+{
+  if (device->ring)
+    return writeDeviceRing(device, buffer, amount);
+
+  device->syscalls++;
+  return write(device->serialIO, buffer, amount);
+}
+
+static int readSysfsValue(const char *path)
+{
+  char value[16];
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+
+  ssize_t length = read(fd, value, sizeof(value) - 1);
+  close(fd);
+  if (length <= 0)
+    return -1;
+
+  value[length] = '\0';
+  return atoi(value);
+}
+
+static int writeSysfsValue(const char *path, int value)
+{
+  char buffer[16];
+  int fd = open(path, O_WRONLY | O_CLOEXEC);
+  if (fd < 0)
+    return 0;
+
+  int length = snprintf(buffer, sizeof(buffer), "%d", value);
+  int written = write(fd, buffer, length) == length;
+  close(fd);
+  return written;
+}
+
+/*
+ * Find the USB serial driver behind the tty and turn its latency down.
+ * ftdi_sio exposes the adapter's latency timer in sysfs, other drivers
+ * such as cp210x have no timer and only get ASYNC_LOW_LATENCY. Whatever
+ * we change is put back in serialClose.
+ */
+static void setLowLatency(JVSDevice *device, const char *address)
+{
+  struct serial_struct serialSettings;
+  if (ioctl(device->serialIO, TIOCGSERIAL, &serialSettings) == 0)
+  {
+    int flags = serialSettings.flags;
+    serialSettings.flags |= ASYNC_LOW_LATENCY;
+    if (!(flags & ASYNC_LOW_LATENCY) && ioctl(device->serialIO, TIOCSSERIAL, &serialSettings) == 0)
+      device->serialFlags = flags;
+    else if (!(flags & ASYNC_LOW_LATENCY))
+      debug(1, "Warning: Could not set ASYNC_LOW_LATENCY flag (not supported by device)\n");
+  }
+  else
+  {
+    // Device doesn't support TIOCGSERIAL (e.g., Bluetooth serial port)
+    debug(1, "Serial device does not support TIOCGSERIAL ioctl (normal for Bluetooth devices)\n");
+  }
+
+  char resolved[PATH_MAX];
+  if (!realpath(address, resolved))
+    return;
+
+  const char *ttyName = strrchr(resolved, '/') ? strrchr(resolved, '/') + 1 : resolved;
+  char tty[64];
+  size_t ttyLength = strlen(ttyName);
+  if (ttyLength >= sizeof(tty))
+    return;
+  memcpy(tty, ttyName, ttyLength + 1);
+
+  char path[PATH_MAX], driverPath[PATH_MAX];
+  const char *driver = "unknown";
+  snprintf(path, sizeof(path), "/sys/class/tty/%s/device/driver", tty);
+  ssize_t length = readlink(path, driverPath, sizeof(driverPath) - 1);
+  if (length > 0)
+  {
+    driverPath[length] = '\0';
+    driver = strrchr(driverPath, '/') ? strrchr(driverPath, '/') + 1 : driverPath;
+  }
+
+  snprintf(device->latencyTimerPath, sizeof(device->latencyTimerPath), "/sys/class/tty/%s/device/latency_timer", tty);
+  int latencyTimer = readSysfsValue(device->latencyTimerPath);
+  if (latencyTimer < 0)
+  {
+    debug(1, "Debug: %s uses the %s driver which has no latency timer\n", tty, driver);
+    return;
+  }
+
+  if (latencyTimer <= LATENCY_TIMER_MINIMUM)
+  {
+    debug(1, "Debug: %s latency timer on %s is already %d ms\n", driver, tty, latencyTimer);
+    return;
+  }
+
+  if (!writeSysfsValue(device->latencyTimerPath, LATENCY_TIMER_MINIMUM))
+  {
+    debug(0, "Warning: Could not lower the %s latency timer on %s, responses may be held back by up to %d ms\n", driver, tty, latencyTimer);
+    return;
+  }
+
+  device->latencyTimer = latencyTimer;
+  debug(1, "Debug: Lowered the %s latency timer on %s from %d ms to %d ms\n", driver, tty, latencyTimer, LATENCY_TIMER_MINIMUM);
+}
+
+static void restoreLatency(JVSDevice *device)
+{
+  if (device->latencyTimer >= 0 && !writeSysfsValue(device->latencyTimerPath, device->latencyTimer))
+    debug(0, "Warning: Could not restore the latency timer at %s\n", device->latencyTimerPath);
+  device->latencyTimer = -1;
+
+  struct serial_struct serialSettings;
+  if (device->serialFlags >= 0 && ioctl(device->serialIO, TIOCGSERIAL, &serialSettings) == 0)
+  {
+    serialSettings.flags = device->serialFlags;
+    ioctl(device->serialIO, TIOCSSERIAL, &serialSettings);
+  }
+  device->serialFlags = -1;
+}
+
+static long elapsedMicroseconds(struct timespec *start)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) * 1000000L + (now.tv_nsec - start->tv_nsec) / 1000L;
+}
+
+/*
+ * Time how long a byte takes to come back round the link. RS485 adapters
+ * that leave their receiver enabled hear their own transmission, and the
+ * pty transport reads it back from the slave end, so this is the best
+ * turnaround a response can have. Only use it on a serial bus while the
+ * game board is off or with a loopback plug fitted, as the probe bytes go
+ * out on the bus.
+ */
+static void probeLatency(JVSDevice *device, int writeFD, int readFD)
+{
+  long fastest = -1, total = 0;
+  int received = 0;
+
+  for (int i = 0; i < LATENCY_PROBE_COUNT; i++)
+  {
+    unsigned char probe = LATENCY_PROBE_BYTE, echo = 0;
+    struct timespec start;
+
+    tcflush(readFD, TCIFLUSH);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (write(writeFD, &probe, 1) != 1)
+      break;
+
+    struct pollfd pollFD = {.fd = readFD, .events = POLLIN};
+    while (echo != probe && elapsedMicroseconds(&start) < LATENCY_PROBE_TIMEOUT * 1000L)
+    {
+      if (poll(&pollFD, 1, LATENCY_PROBE_TIMEOUT) != 1 || read(readFD, &echo, 1) != 1)
+        break;
+    }
+
+    if (echo != probe)
+      continue;
+
+    long roundTrip = elapsedMicroseconds(&start);
+    if (fastest < 0 || roundTrip < fastest)
+      fastest = roundTrip;
+    total += roundTrip;
+    received++;
+  }
+
+  tcflush(readFD, TCIFLUSH);
+
+  if (received == 0)
+  {
+    debug(0, "Latency probe: No echo on %s, fit a loopback plug to measure the turnaround\n", device->transport->name);
+    return;
+  }
+
+  debug(0, "Latency probe: %s turnaround floor is %.2f ms, average %.2f ms over %d probes\n",
+        device->transport->name, fastest / 1000.0, total / 1000.0 / received, received);
+}
+
+static int serialOpen(JVSDevice *device, const char *address)
+{
+  if ((device->serialIO = open(address, O_RDWR | O_NOCTTY | O_SYNC | O_NDELAY | O_CLOEXEC)) < 0)
+    return 0;
+
+  /* Setup the serial connection */
+  setSerialAttributes(device->serialIO, B115200);
+
+  if (device->lowLatency)
+    setLowLatency(device, address);
+
+  if (device->latencyProbe)
+    probeLatency(device, device->serialIO, device->serialIO);
+
+  if (!watchDevice(device, device->serialIO, 1))
+  {
+    /* The adapter keeps its latency timer until it is replugged, so put it back */
+    restoreLatency(device);
+    close(device->serialIO);
+    return 0;
+  }
+
+  attachDeviceRing(device, device->serialIO);
+  return 1;
+}
+
+static int serialClose(JVSDevice *device)
+{
+  tcflush(device->serialIO, TCIOFLUSH);
+  restoreLatency(device);
+  return close(device->serialIO) == 0;
+}
+
+/**
+ * Remove what an earlier run left at a path before it is used again
+ *
+ * We run as root, so a mistyped path must never take a real file or
+ * device node with it. Only a UNIX socket, or a link to a pseudo
+ * terminal slave, is taken to be ours.
+ *
+ * @param path The path to clear
+ * @param socket 1 if a UNIX socket is expected there, 0 for a pty link
+ * @returns 1 if the path is free to use, 0 if something else is there
+ */
+static int removeStalePath(const char *path, int socket)
+{
+  struct stat status;
+  if (lstat(path, &status) != 0)
+    return errno == ENOENT;
+
+  int stale = 0;
+  if (socket)
+  {
+    stale = S_ISSOCK(status.st_mode);
+  }
+  else if (S_ISLNK(status.st_mode))
+  {
+    char target[PATH_MAX];
+    ssize_t length = readlink(path, target, sizeof(target));
+    stale = length > 9 && strncmp(target, "/dev/pts/", 9) == 0;
+  }
+
+  if (!stale)
+  {
+    debug(0, "Error: %s already exists and is not a %s, it will not be replaced\n", path, socket ? "UNIX socket" : "pseudo terminal link");
+    return 0;
+  }
+
+  return unlink(path) == 0 || errno == ENOENT;
+}
+
+/*
+ * The pty transport hands the slave end to an emulator, optionally
+ * through a symlink so it has a stable name to open. We keep our own
+ * copy of the slave open so reads on the master don't fail with EIO
+ * while nothing is attached.
+ */
+static int openPseudoTerminal(const char *address, int *slave, const char **slaveName)
+{
+  int master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if (master < 0)
+    return -1;
+
+  char *name = NULL;
+  if (grantpt(master) != 0 || unlockpt(master) != 0 || (name = ptsname(master)) == NULL)
+  {
+    close(master);
+    return -1;
+  }
+
+  if ((*slave = open(name, O_RDWR | O_NOCTTY | O_CLOEXEC)) < 0)
+  {
+    close(master);
+    return -1;
+  }
+
+  struct termios options;
+  tcgetattr(*slave, &options);
+  cfmakeraw(&options);
+  tcsetattr(*slave, TCSANOW, &options);
+
+  if (address[0] != '\0')
+  {
+    if (!removeStalePath(address, 0))
+    {
+      close(*slave);
+      close(master);
+      return -1;
+    }
+
+    if (symlink(name, address) != 0)
+    {
+      debug(0, "Error: Could not link %s to %s\n", address, name);
+      close(*slave);
+      close(master);
+      return -1;
+    }
+  }
+
+  *slaveName = address[0] != '\0' ? address : name;
+  return master;
+}
+
+static int ptyOpen(JVSDevice *device, const char *address)
+{
+  int slave;
+  const char *slaveName;
+  int master = openPseudoTerminal(address, &slave, &slaveName);
+  if (master < 0)
+    return 0;
+
+  strncpy(device->address, address, sizeof(device->address) - 1);
+  device->address[sizeof(device->address) - 1] = '\0';
+
+  if (device->latencyProbe)
+    probeLatency(device, master, slave);
+
+  if (!watchDevice(device, master, 1))
+  {
+    close(slave);
+    close(master);
+    if (device->address[0] != '\0')
+      unlink(device->address);
+    return 0;
+  }
+
+  debug(0, "JVS pseudo terminal available at %s\n", slaveName);
+
+  device->serialIO = master;
+  device->listenIO = slave;
+  attachDeviceRing(device, master);
+  return 1;
+}
+
+static int ptyClose(JVSDevice *device)
+{
+  if (device->address[0] != '\0')
+    unlink(device->address);
+
+  close(device->listenIO);
+  return close(device->serialIO) == 0;
+}
+
+/*
+ * The socket transports listen for a single peer and only accept
+ * one connection at a time, like a real RS485 bus with one master.
+ * Data is received straight into the packet decoder's buffer.
+ */
+static int streamAccept(JVSDevice *device)
+{
+  int client = accept4(device->listenIO, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+  if (client < 0)
+    return 0;
+
+  if (device->transport == &tcpTransport)
+  {
+    int noDelay = 1;
+    setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+  }
+
+  /* Stop listening while the peer is connected */
+  watchDevice(device, device->listenIO, 0);
+  if (!watchDevice(device, client, 1))
+  {
+    close(client);
+    watchDevice(device, device->listenIO, 1);
+    return 0;
+  }
+
+  debug(1, "Debug: %s transport client connected\n", device->transport->name);
+  device->serialIO = client;
+  return 1;
+}
+
+static void streamDisconnect(JVSDevice *device)
+{
+  debug(1, "Debug: %s transport client disconnected\n", device->transport->name);
+  close(device->serialIO);
+  device->serialIO = -1;
+  watchDevice(device, device->listenIO, 1);
+}
+
+static int streamRead(JVSDevice *device, unsigned char *buffer, int amount)
+{
+  /* Until someone connects there is nothing to read */
+  if (device->serialIO < 0)
+  {
+    if (!waitDevice(device, device->listenIO) || !streamAccept(device))
+      return -1;
+    return 0;
+  }
+
+  if (!waitDevice(device, device->serialIO))
+    return -1;
+
+  /* Drain the socket the same way as drainRead, but stop the peer on hang up */
+  int bytesRead = 0;
+  while (bytesRead < amount)
+  {
+    ssize_t wanted = amount - bytesRead;
+    device->syscalls++;
+    ssize_t result = recv(device->serialIO, buffer + bytesRead, wanted, MSG_DONTWAIT);
+    if (result > 0)
+    {
+      bytesRead += result;
+      if (result < wanted)
+        break;
+      continue;
+    }
+
+    if (result == 0 || (errno != EAGAIN && errno != EINTR))
+    {
+      streamDisconnect(device);
+      return bytesRead > 0 ? bytesRead : -1;
+    }
+    break;
+  }
+
+  return bytesRead;
+}
+
+static int streamWrite(JVSDevice *device, unsigned char *buffer, int amount)
+{
+  if (device->serialIO < 0)
+    return -1;
+
+  device->syscalls++;
+  ssize_t written = send(device->serialIO, buffer, amount, MSG_NOSIGNAL);
+  if (written < 0 && errno != EAGAIN && errno != EINTR)
+    streamDisconnect(device);
+
+  return written;
+}
+
+static int streamClose(JVSDevice *device)
+{
+  if (device->serialIO >= 0)
+    close(device->serialIO);
+
+  if (device->address[0] != '\0')
+    unlink(device->address);
+
+  return close(device->listenIO) == 0;
+}
+
+static int streamListen(JVSDevice *device, int fd)
+{
+  if (listen(fd, 1) != 0 || !watchDevice(device, fd, 1))
+  {
+    close(fd);
+    return 0;
+  }
+
+  device->serialIO = -1;
+  device->listenIO = fd;
+  return 1;
+}
+
+static int unixOpen(JVSDevice *device, const char *address)
+{
+  struct sockaddr_un socketAddress;
+  memset(&socketAddress, 0, sizeof(socketAddress));
+  socketAddress.sun_family = AF_UNIX;
+
+  if (address[0] == '\0' || strlen(address) >= sizeof(socketAddress.sun_path))
+  {
+    debug(0, "Error: Invalid UNIX socket path %s\n", address);
+    return 0;
+  }
+  strcpy(socketAddress.sun_path, address);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return 0;
+
+  /* Remove a socket left behind by a previous run */
+  if (!removeStalePath(address, 1))
+  {
+    close(fd);
+    return 0;
+  }
+
+  if (bind(fd, (struct sockaddr *)&socketAddress, sizeof(socketAddress)) != 0)
+  {
+    close(fd);
+    return 0;
+  }
+
+  strncpy(device->address, address, sizeof(device->address) - 1);
+  device->address[sizeof(device->address) - 1] = '\0';
+
+  return streamListen(device, fd);
+}
+
+static int tcpOpen(JVSDevice *device, const char *address)
+{
+  char host[DEVICE_ADDRESS_LENGTH] = DEFAULT_TCP_HOST;
+  const char *port = address;
+
+  /* Accept host:port, [IPv6 host]:port and a bare port */
+  const char *separator = strrchr(address, ':');
+  if (address[0] == '[')
+  {
+    const char *bracket = strchr(address, ']');
+    size_t hostLength = bracket ? (size_t)(bracket - address - 1) : 0;
+    if (!bracket || bracket[1] != ':' || hostLength == 0 || hostLength >= sizeof(host))
+    {
+      debug(0, "Error: Invalid TCP address %s, IPv6 hosts are written as [host]:port\n", address);
+      return 0;
+    }
+    memcpy(host, address + 1, hostLength);
+    host[hostLength] = '\0';
+    port = bracket + 2;
+  }
+  else if (separator && strchr(address, ':') != separator)
+  {
+    debug(0, "Error: Invalid TCP address %s, IPv6 hosts must be in brackets\n", address);
+    return 0;
+  }
+  else if (separator)
+  {
+    size_t hostLength = separator - address;
+    if (hostLength > 0 && hostLength < sizeof(host))
+    {
+      memcpy(host, address, hostLength);
+      host[hostLength] = '\0';
+    }
+    port = separator + 1;
+  }
+
+  struct addrinfo hints, *result;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+
+  if (getaddrinfo(host, port, &hints, &result) != 0)
+  {
+    debug(0, "Error: Invalid TCP address %s\n", address);
+    return 0;
+  }
+
+  int fd = -1;
+  for (struct addrinfo *info = result; info != NULL; info = info->ai_next)
+  {
+    fd = socket(info->ai_family, info->ai_socktype | SOCK_CLOEXEC, info->ai_protocol);
+    if (fd < 0)
+      continue;
+
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    if (bind(fd, info->ai_addr, info->ai_addrlen) == 0)
+      break;
+
+    close(fd);
+    fd = -1;
+  }
+
+  freeaddrinfo(result);
+
+  if (fd < 0)
+    return 0;
+
+  return streamListen(device, fd);
+}
+
+static const JVSTransport serialTransport = {
+    .name = "Serial",
+    .open = serialOpen,
+    .close = serialClose,
+    .read = fdRead,
+    .write = fdWrite,
+};
+
+static const JVSTransport ptyTransport = {
+    .name = "PTY",
+    .open = ptyOpen,
+    .close = ptyClose,
+    .read = fdRead,
+    .write = fdWrite,
+};
+
+static const JVSTransport unixTransport = {
+    .name = "UNIX",
+    .open = unixOpen,
+    .close = streamClose,
+    .read = streamRead,
+    .write = streamWrite,
+};
+
+static const JVSTransport tcpTransport = {
+    .name = "TCP",
+    .open = tcpOpen,
+    .close = streamClose,
+    .read = streamRead,
+    .write = streamWrite,
+};
+
+/**
+ * Open a serial link that isn't a JVS bus
+ *
+ * Peripherals such as drive boards hang off their own serial port,
+ * which can also be a pty: path to test against an emulator. The link
+ * is non-blocking and the caller does its own waiting.
+ *
+ * @param link The link to open
+ * @param path A serial port, or pty: followed by where to link the slave
+ * @param baud The baud rate of a serial port, such as B38400
+ * @returns 1 on success, 0 otherwise
+ */
+int openSerialLink(SerialLink *link, const char *path, speed_t baud)
+{
+  link->fd = -1;
+  link->holdIO = -1;
+  link->address[0] = '\0';
+
+  if (strncmp(path, "pty:", 4) == 0)
+  {
+    const char *slaveName;
+    if ((link->fd = openPseudoTerminal(path + 4, &link->holdIO, &slaveName)) < 0)
+      return 0;
+
+    strncpy(link->address, path + 4, sizeof(link->address) - 1);
+    link->address[sizeof(link->address) - 1] = '\0';
+    debug(0, "Pseudo terminal available at %s\n", slaveName);
+    return 1;
+  }
+
+  if ((link->fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC)) < 0)
+    return 0;
+
+  setSerialAttributes(link->fd, baud);
+  return 1;
+}
+
+void closeSerialLink(SerialLink *link)
+{
+  if (link->address[0] != '\0')
+    unlink(link->address);
+  link->address[0] = '\0';
+
+  if (link->holdIO >= 0)
+    close(link->holdIO);
+  link->holdIO = -1;
+
+  if (link->fd >= 0)
+    close(link->fd);
+  link->fd = -1;
+}
@@ -0,0 +1,36 @@
+#ifndef TRANSPORT_H_
+#define TRANSPORT_H_
+
+#include "hardware/device.h"
+
+/*
+ * The link a bus talks JVS over, picked by the DEVICE_PATH scheme:
+ *
+ *   /dev/ttyUSB0              A real RS485 serial port
+ *   pty:/tmp/jvs              A pseudo terminal, the slave is linked at the path
+ *   unix:/run/modernjvs.sock  A UNIX domain stream socket
+ *   tcp:127.0.0.1:5000        A TCP socket, the host defaults to the loopback
+ *   tcp:[::1]:5000            A TCP socket on an IPv6 host
+ */
+typedef struct JVSTransport
+{
+    const char *name;
+    int (*open)(JVSDevice *device, const char *address);
+    int (*close)(JVSDevice *device);
+    int (*read)(JVSDevice *device, unsigned char *buffer, int amount);
+    int (*write)(JVSDevice *device, unsigned char *buffer, int amount);
+} JVSTransport;
+
+/* A serial port or pty: link to a peripheral that isn't on the JVS bus */
+typedef struct
+{
+    int fd;
+    int holdIO;
+    char address[DEVICE_ADDRESS_LENGTH];
+} SerialLink;
+
+const JVSTransport *getTransport(const char *devicePath, const char **address);
+int openSerialLink(SerialLink *link, const char *path, speed_t baud);
+void closeSerialLink(SerialLink *link);
+
+#endif // TRANSPORT_H_
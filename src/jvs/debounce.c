@@ -0,0 +1,154 @@
+#include <string.h>
+
+#include "jvs/debounce.h"
+
+/**
+ * Setup the switch holds for an IO
+ *
+ * @param debounce The holds to setup
+ * @param holdTime How long a press is held for at least, in milliseconds, 0 to only hold it for one read
+ */
+void initSwitchDebounce(SwitchDebounce *debounce, int holdTime)
+{
+	memset(debounce, 0, sizeof(SwitchDebounce));
+	debounce->holdTime = holdTime < 0 ? 0 : holdTime > MAX_SWITCH_DEBOUNCE ? MAX_SWITCH_DEBOUNCE : holdTime;
+
+	for (int player = 0; player < DEBOUNCE_MAX_PLAYERS; player++)
+	{
+		for (int bit = 0; bit < DEBOUNCE_SWITCHES; bit++)
+		{
+			debounce->holds[player][bit].player = player;
+			debounce->holds[player][bit].bit = bit;
+		}
+	}
+}
+
+static void addHold(SwitchDebounce *debounce, SwitchHold *hold)
+{
+	unsigned int delta = hold->expires - debounce->now;
+	SwitchHold **slot;
+	if (delta < DEBOUNCE_WHEEL_SLOTS)
+		slot = &debounce->wheel[0][hold->expires & (DEBOUNCE_WHEEL_SLOTS - 1)];
+	else
+		slot = &debounce->wheel[1][(hold->expires >> DEBOUNCE_WHEEL_BITS) & (DEBOUNCE_WHEEL_SLOTS - 1)];
+
+	hold->next = *slot;
+	*slot = hold;
+	hold->pending = 1;
+}
+
+static void expireHold(SwitchDebounce *debounce, SwitchHold *hold)
+{
+	/* Pressed again since it was added, so it has further to go */
+	if ((int)(hold->expires - debounce->now) > 0)
+	{
+		addHold(debounce, hold);
+		return;
+	}
+
+	hold->pending = 0;
+	debounce->held[hold->player] &= ~(1 << hold->bit);
+}
+
+/**
+ * Move the holds on to the time of a read
+ *
+ * Each millisecond since the last read moves the wheel on by one slot,
+ * and every 64 the holds further out drop down into the first level.
+ *
+ * @param debounce The holds to move on
+ * @param now The time of the read, in milliseconds
+ */
+void advanceSwitchDebounce(SwitchDebounce *debounce, unsigned int now)
+{
+	memset(debounce->reported, 0, sizeof(debounce->reported));
+
+	/* After a long gap every hold has run out, so drop them all rather than ticking through it */
+	if (!debounce->started || now - debounce->now > MAX_SWITCH_DEBOUNCE + DEBOUNCE_WHEEL_SLOTS)
+	{
+		memset(debounce->wheel, 0, sizeof(debounce->wheel));
+		memset(debounce->held, 0, sizeof(debounce->held));
+		for (int player = 0; player < DEBOUNCE_MAX_PLAYERS; player++)
+			for (int bit = 0; bit < DEBOUNCE_SWITCHES; bit++)
+				debounce->holds[player][bit].pending = 0;
+
+		debounce->started = 1;
+		debounce->now = now;
+		return;
+	}
+
+	while (debounce->now != now)
+	{
+		debounce->now++;
+
+		if ((debounce->now & (DEBOUNCE_WHEEL_SLOTS - 1)) == 0)
+		{
+			SwitchHold **slot = &debounce->wheel[1][(debounce->now >> DEBOUNCE_WHEEL_BITS) & (DEBOUNCE_WHEEL_SLOTS - 1)];
+			SwitchHold *hold = *slot;
+			*slot = NULL;
+			while (hold)
+			{
+				SwitchHold *next = hold->next;
+				addHold(debounce, hold);
+				hold = next;
+			}
+		}
+
+		SwitchHold **slot = &debounce->wheel[0][debounce->now & (DEBOUNCE_WHEEL_SLOTS - 1)];
+		SwitchHold *hold = *slot;
+		*slot = NULL;
+		while (hold)
+		{
+			SwitchHold *next = hold->next;
+			expireHold(debounce, hold);
+			hold = next;
+		}
+	}
+}
+
+/**
+ * Hold the switches a read found pressed
+ *
+ * They are reported by this read even if they have already been let go,
+ * and then for at least the hold time.
+ *
+ * @param debounce The holds for the IO
+ * @param player The player the switches belong to, or 0 for the system switches
+ * @param pressed The switches that were pressed since the last read
+ */
+void holdSwitches(SwitchDebounce *debounce, int player, int pressed)
+{
+	if (player < 0 || player >= DEBOUNCE_MAX_PLAYERS || !pressed)
+		return;
+
+	debounce->reported[player] |= pressed;
+	if (!debounce->holdTime)
+		return;
+
+	for (int bit = 0; bit < DEBOUNCE_SWITCHES; bit++)
+	{
+		if (!(pressed & (1 << bit)))
+			continue;
+
+		SwitchHold *hold = &debounce->holds[player][bit];
+		hold->expires = debounce->now + debounce->holdTime;
+		debounce->held[player] |= 1 << bit;
+		if (!hold->pending)
+			addHold(debounce, hold);
+	}
+}
+
+/**
+ * Get the switches still being held for a player
+ *
+ * @param debounce The holds for the IO
+ * @param player The player, or 0 for the system switches
+ * @returns The switches held or pressed since the last read
+ */
+int getHeldSwitches(SwitchDebounce *debounce, int player)
+{
+	if (player < 0 || player >= DEBOUNCE_MAX_PLAYERS)
+		return 0;
+
+	return debounce->held[player] | debounce->reported[player];
+}
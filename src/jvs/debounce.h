@@ -0,0 +1,39 @@
+#ifndef DEBOUNCE_H_
+#define DEBOUNCE_H_
+
+/* Holds run on a two level timer wheel, 1ms ticks for the first 64ms then 64ms ticks after that */
+#define DEBOUNCE_WHEEL_BITS 6
+#define DEBOUNCE_WHEEL_SLOTS (1 << DEBOUNCE_WHEEL_BITS)
+#define DEBOUNCE_WHEEL_LEVELS 2
+
+#define MAX_SWITCH_DEBOUNCE 1000 // ms
+#define DEBOUNCE_MAX_PLAYERS 9   // The system switches and 8 players
+#define DEBOUNCE_SWITCHES 16
+
+typedef struct SwitchHold
+{
+    struct SwitchHold *next;
+    unsigned int expires;
+    unsigned char player;
+    unsigned char bit;
+    unsigned char pending;
+} SwitchHold;
+
+/* Only the responder touches this, when the game reads the switches */
+typedef struct
+{
+    unsigned int holdTime; // ms
+    unsigned int now;      // ms
+    int started;
+    SwitchHold *wheel[DEBOUNCE_WHEEL_LEVELS][DEBOUNCE_WHEEL_SLOTS];
+    SwitchHold holds[DEBOUNCE_MAX_PLAYERS][DEBOUNCE_SWITCHES];
+    int held[DEBOUNCE_MAX_PLAYERS];
+    int reported[DEBOUNCE_MAX_PLAYERS];
+} SwitchDebounce;
+
+void initSwitchDebounce(SwitchDebounce *debounce, int holdTime);
+void advanceSwitchDebounce(SwitchDebounce *debounce, unsigned int now);
+void holdSwitches(SwitchDebounce *debounce, int player, int pressed);
+int getHeldSwitches(SwitchDebounce *debounce, int player);
+
+#endif // DEBOUNCE_H_
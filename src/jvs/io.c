@@ -1,13 +1,18 @@
 #include <string.h>
 #include <math.h>
+#include <time.h>
 
 #include "jvs/io.h"
+#include "jvs/persist.h"
 #include "console/debug.h"
 
 int initIO(JVSIO *io)
 {
 	for (int player = 0; player < (io->capabilities.players + 1); player++)
-		io->state.inputSwitch[player] = 0;
+		memset(io->state.inputSwitch[player], 0, sizeof(io->state.inputSwitch[player]));
+	memset(io->state.switchLatch, 0, sizeof(io->state.switchLatch));
+	initSwitchDebounce(&io->debounce, 0);
+	memset(&io->turbo, 0, sizeof(io->turbo));
 
 	for (int analogueChannels = 0; analogueChannels < io->capabilities.analogueInChannels; analogueChannels++)
 		io->state.analogueChannel[analogueChannels] = 0;
@@ -18,6 +23,15 @@ int initIO(JVSIO *io)
 	for (int player = 0; player < io->capabilities.coins; player++)
 		io->state.coinCount[player] = 0;
 
+	memset(io->state.gunPosition, 0, sizeof(io->state.gunPosition));
+	memset(io->state.gpo, 0, sizeof(io->state.gpo));
+	memset(io->state.analogueOut, 0, sizeof(io->state.analogueOut));
+	memset(io->state.payout, 0, sizeof(io->state.payout));
+	memset(io->state.gpi, 0, sizeof(io->state.gpi));
+	io->state.gpiLatch = 0;
+	memset(io->state.keypad, 0, sizeof(io->state.keypad));
+	io->state.keypadLatch = 0;
+
 	io->analogueMax = pow(2, io->capabilities.analogueInBits) - 1;
 	io->gunXMax = pow(2, io->capabilities.gunXBits) - 1;
 	io->gunYMax = pow(2, io->capabilities.gunYBits) - 1;
@@ -25,8 +39,72 @@ int initIO(JVSIO *io)
 	return 1;
 }
 
-int setSwitch(JVSIO *io, JVSPlayer player, JVSInput switchNumber, int value)
+/* The switch sources in use, the shared source is always taken */
+static unsigned int switchSources = 1 << JVS_SHARED_SWITCH_SOURCE;
+
+/**
+ * Claim a source of switches for a device
+ *
+ * Each device presses and releases its own switches, so letting go of a
+ * button on one device leaves it held if another device still holds it.
+ *
+ * @returns The source to set switches with, or the shared source if they have all been claimed
+ */
+int claimSwitchSource(void)
+{
+	unsigned int sources = __atomic_load_n(&switchSources, __ATOMIC_RELAXED);
+	for (int source = 0; source < JVS_MAX_SWITCH_SOURCES; source++)
+	{
+		if (sources & (1u << source))
+			continue;
+
+		if (__atomic_compare_exchange_n(&switchSources, &sources, sources | (1u << source), 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			return source;
+
+		/* Someone else claimed one first, so look again from the start */
+		source = -1;
+	}
+
+	debug(0, "Warning: Only %d switch sources are supported, devices will share switches\n", JVS_MAX_SWITCH_SOURCES);
+	return JVS_SHARED_SWITCH_SOURCE;
+}
+
+/**
+ * Release a source of switches when its device goes away
+ *
+ * Anything the device still held is let go.
+ *
+ * @param io The IO the device was sending to, chained IO included
+ * @param source The source to release
+ */
+void releaseSwitchSource(JVSIO *io, int source)
+{
+	if (source <= JVS_SHARED_SWITCH_SOURCE || source >= JVS_MAX_SWITCH_SOURCES)
+		return;
+
+	for (; io != NULL; io = io->chainedIO)
+	{
+		for (int player = 0; player < (io->capabilities.players + 1); player++)
+			__atomic_store_n(&io->state.inputSwitch[player][source], 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&io->state.gpi[source], 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&io->state.keypad[source], 0, __ATOMIC_RELAXED);
+	}
+
+	__atomic_fetch_and(&switchSources, ~(1u << source), __ATOMIC_RELAXED);
+}
+
+int setSwitch(JVSIO *io, int source, JVSPlayer player, JVSInput switchNumber, int value)
 {
+	if (source < 0 || source >= JVS_MAX_SWITCH_SOURCES)
+		source = JVS_SHARED_SWITCH_SOURCE;
+
+	/* General purpose inputs and keypad keys are mapped like switches but don't belong to a player */
+	if (switchNumber >= GPI_1 && switchNumber <= GPI_16)
+		return setGPI(io, source, switchNumber - GPI_1, value);
+
+	if (switchNumber >= KEYPAD_0 && switchNumber <= KEYPAD_HASH)
+		return setKeypad(io, source, switchNumber - KEYPAD_0, value);
+
 	if (player > io->capabilities.players)
 	{
 		printf("Error: That player %d does not exist.\n", player);
@@ -35,16 +113,116 @@ int setSwitch(JVSIO *io, JVSPlayer player, JVSInput switchNumber, int value)
 
 	if (value)
 	{
-		io->state.inputSwitch[player] |= switchNumber;
+		/* A new press is latched until the game has read it, however quickly it is let go */
+		if (!(__atomic_fetch_or(&io->state.inputSwitch[player][source], switchNumber, __ATOMIC_RELAXED) & switchNumber))
+			__atomic_fetch_or(&io->state.switchLatch[player], switchNumber, __ATOMIC_RELAXED);
 	}
 	else
 	{
-		io->state.inputSwitch[player] &= ~switchNumber;
+		__atomic_fetch_and(&io->state.inputSwitch[player][source], ~switchNumber, __ATOMIC_RELAXED);
 	}
 
 	return 1;
 }
 
+/* Every source's switches ORed together, with any still held */
+static int rawSwitches(JVSIO *io, JVSPlayer player)
+{
+	int switches = getHeldSwitches(&io->debounce, player);
+	for (int source = 0; source < JVS_MAX_SWITCH_SOURCES; source++)
+		switches |= __atomic_load_n(&io->state.inputSwitch[player][source], __ATOMIC_RELAXED);
+	return switches;
+}
+
+/**
+ * Make a switch fire repeatedly while it is held
+ *
+ * The switch is on for the first rate reads after it is pressed, then off
+ * for the next rate reads and so on, so it keeps in step with the game.
+ *
+ * @param io The IO the switch is on
+ * @param player The player the switch belongs to
+ * @param switchNumber The switch to repeat
+ * @param rate How many reads it stays on and then off for
+ * @returns 1 on success, 0 if it isn't a switch on the IO
+ */
+int setTurbo(JVSIO *io, JVSPlayer player, JVSInput switchNumber, int rate)
+{
+	if (player > io->capabilities.players || player >= DEBOUNCE_MAX_PLAYERS)
+		return 0;
+
+	if (switchNumber <= 0 || switchNumber > BUTTON_START || (switchNumber & (switchNumber - 1)))
+		return 0;
+
+	if (rate < 1 || rate > MAX_TURBO_RATE)
+		rate = DEFAULT_TURBO_RATE;
+
+	io->turbo.mask[player] |= switchNumber;
+	io->turbo.rate[player][__builtin_ctz(switchNumber)] = rate;
+	return 1;
+}
+
+/* Work out which turbo switches are in the off half of their cycle on this read */
+static void pollTurbo(JVSIO *io, int player)
+{
+	SwitchTurbo *turbo = &io->turbo;
+	int pressed = rawSwitches(io, player) & turbo->mask[player];
+	int off = 0;
+
+	for (int held = pressed; held; held &= held - 1)
+	{
+		int bit = __builtin_ctz(held);
+		if (!(turbo->pressed[player] & (1 << bit)))
+			turbo->start[player][bit] = turbo->polls;
+		else if (((turbo->polls - turbo->start[player][bit]) / turbo->rate[player][bit]) & 1)
+			off |= 1 << bit;
+	}
+
+	turbo->pressed[player] = pressed;
+	turbo->off[player] = off;
+}
+
+/**
+ * Take the presses since the game last read the switches
+ *
+ * Called by the responder before it reads the switches, so the holds and
+ * turbo switches move on at the rate the game polls rather than on timers
+ * of their own.
+ *
+ * @param io The IO the switches are on
+ */
+void pollSwitches(JVSIO *io)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	advanceSwitchDebounce(&io->debounce, (unsigned int)(now.tv_sec * 1000 + now.tv_nsec / 1000000));
+
+	io->turbo.polls++;
+	for (int player = 0; player < (io->capabilities.players + 1) && player < DEBOUNCE_MAX_PLAYERS; player++)
+	{
+		holdSwitches(&io->debounce, player, __atomic_exchange_n(&io->state.switchLatch[player], 0, __ATOMIC_RELAXED));
+		if (io->turbo.mask[player])
+			pollTurbo(io, player);
+	}
+}
+
+/**
+ * Get the switches the game sees for a player
+ *
+ * @param io The IO the switches are on
+ * @param player The player, or SYSTEM
+ * @returns Every source's switches ORed together, with any still held and without turbo switches in their off half
+ */
+int getSwitches(JVSIO *io, JVSPlayer player)
+{
+	if (player > io->capabilities.players)
+		return 0;
+
+	if (player < DEBOUNCE_MAX_PLAYERS)
+		return rawSwitches(io, player) & ~io->turbo.off[player];
+	return rawSwitches(io, player);
+}
+
 int incrementCoin(JVSIO *io, JVSPlayer player, int amount)
 {
 	if (player == SYSTEM)
@@ -55,6 +233,7 @@ int incrementCoin(JVSIO *io, JVSPlayer player, int amount)
 		return 0;
 
 	io->state.coinCount[player - 1] = io->state.coinCount[player - 1] + amount;
+	markCoinsChanged();
 	return 1;
 }
 
@@ -62,24 +241,125 @@ int setAnalogue(JVSIO *io, JVSInput channel, double value)
 {
 	if (channel >= io->capabilities.analogueInChannels)
 		return 0;
-	io->state.analogueChannel[channel] = (int)((double)value * (double)io->analogueMax);
+
+	/* Changes too small to show at the IO's resolution are left out, so the responder's cache line stays clean */
+	int analogue = (int)((double)value * (double)io->analogueMax);
+	if (io->state.analogueChannel[channel] != analogue)
+		io->state.analogueChannel[channel] = analogue;
+	return 1;
+}
+
+/**
+ * Set an analogue channel from a fixed point value
+ *
+ * @param io The IO to set the channel on
+ * @param channel The analogue channel to set
+ * @param value The value from 0 to 0xFFFF
+ * @returns 1 on success, 0 if there is no such channel
+ */
+int setAnalogueFixed(JVSIO *io, JVSInput channel, unsigned int value)
+{
+	if (channel >= io->capabilities.analogueInChannels || value > 0xFFFF)
+		return 0;
+
+	int analogue = value * io->analogueMax / 0xFFFF;
+	if (io->state.analogueChannel[channel] != analogue)
+		io->state.analogueChannel[channel] = analogue;
 	return 1;
 }
 
+static int validGun(JVSIO *io, int gun)
+{
+	return gun >= 0 && gun < io->capabilities.gunChannels && gun < JVS_MAX_GUNS;
+}
+
+static unsigned int gunAxis(double value, int max)
+{
+	value = value > 1 ? 1 : value;
+	value = value < 0 ? 0 : value;
+	return (unsigned int)(value * max);
+}
+
+/**
+ * Set one axis of a gun
+ *
+ * Gun channels come in pairs, the even channel is the X axis and the
+ * odd channel the Y axis of gun channel / 2. The other axis is left
+ * as it is.
+ *
+ * @param io The IO the gun is on
+ * @param channel The axis to set
+ * @param value The position from 0 to 1
+ * @returns 1 on success, 0 if there is no such gun
+ */
 int setGun(JVSIO *io, JVSInput channel, double value)
 {
-	// Bounds check to prevent array overflow
-	if (channel >= io->capabilities.gunChannels * 2)
+	int gun = channel / 2;
+	if (!validGun(io, gun))
 		return 0;
 
-	if (channel % 2 == 0)
-	{
-		io->state.gunChannel[channel] = (int)((double)value * (double)io->gunXMax);
-	}
-	else
-	{
-		io->state.gunChannel[channel] = (int)((double)((double)1.0 - value) * (double)io->gunYMax);
-	}
+	unsigned int mask = channel % 2 == 0 ? 0xFFFF0000 : 0x0000FFFF;
+	unsigned int axis = channel % 2 == 0 ? gunAxis(value, io->gunXMax) << 16 : gunAxis(1.0 - value, io->gunYMax);
+
+	unsigned int position = __atomic_load_n(&io->state.gunPosition[gun], __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&io->state.gunPosition[gun], &position, (position & ~mask) | axis,
+										1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+	return 1;
+}
+
+/**
+ * Set where a gun is pointing
+ *
+ * Both axes are written in one go, so the game never reads the X of one
+ * position with the Y of another.
+ *
+ * @param io The IO the gun is on
+ * @param gun The gun, counting from 0, which is usually the player
+ * @param x The X position from 0 to 1
+ * @param y The Y position from 0 to 1, with 0 at the bottom
+ * @returns 1 on success, 0 if there is no such gun
+ */
+int setGunPosition(JVSIO *io, int gun, double x, double y)
+{
+	if (!validGun(io, gun))
+		return 0;
+
+	unsigned int position = gunAxis(x, io->gunXMax) << 16 | gunAxis(1.0 - y, io->gunYMax);
+	__atomic_store_n(&io->state.gunPosition[gun], position, __ATOMIC_RELAXED);
+	return 1;
+}
+
+/**
+ * Set where a gun is pointing from a fixed point position
+ *
+ * The same as setGunPosition for positions that are already whole
+ * numbers, such as those from a gun calibration.
+ *
+ * @param io The IO the gun is on
+ * @param gun The gun, counting from 0, which is usually the player
+ * @param x The X position from 0 to 65535
+ * @param y The Y position from 0 to 65535, with 0 at the bottom
+ * @returns 1 on success, 0 if there is no such gun
+ */
+int setGunPositionFixed(JVSIO *io, int gun, unsigned int x, unsigned int y)
+{
+	if (!validGun(io, gun) || x > 0xFFFF || y > 0xFFFF)
+		return 0;
+
+	unsigned int position = (x * io->gunXMax / 0xFFFF) << 16 | (0xFFFF - y) * io->gunYMax / 0xFFFF;
+	__atomic_store_n(&io->state.gunPosition[gun], position, __ATOMIC_RELAXED);
+	return 1;
+}
+
+int getGunPosition(JVSIO *io, int gun, unsigned short *x, unsigned short *y)
+{
+	if (!validGun(io, gun))
+		return 0;
+
+	unsigned int position = __atomic_load_n(&io->state.gunPosition[gun], __ATOMIC_RELAXED);
+	*x = position >> 16;
+	*y = position & 0xFFFF;
 	return 1;
 }
 
@@ -88,7 +368,8 @@ int setRotary(JVSIO *io, JVSInput channel, int value)
 	if (channel >= io->capabilities.rotaryChannels)
 		return 0;
 
-	io->state.rotaryChannel[channel] = value;
+	/* Rotary channels are 16 bit counters that wrap, so a spinner can turn forever */
+	io->state.rotaryChannel[channel] = value & 0xFFFF;
 	return 1;
 }
 
@@ -100,6 +381,269 @@ int getRotary(JVSIO *io, JVSInput channel)
 	return io->state.rotaryChannel[channel];
 }
 
+/**
+ * Set a byte of general purpose outputs
+ *
+ * GPO bits are numbered from the most significant bit of
+ * the first byte, so bit 0 is GPO 1 on the board.
+ *
+ * @param io The IO to set the outputs on
+ * @param byteIndex The byte to set
+ * @param value The new value of the byte
+ * @returns The bits that changed
+ */
+unsigned char setGPOByte(JVSIO *io, int byteIndex, unsigned char value)
+{
+	if (byteIndex < 0 || byteIndex >= JVS_MAX_GPO_BYTES)
+		return 0;
+
+	unsigned char changed = io->state.gpo[byteIndex] ^ value;
+	io->state.gpo[byteIndex] = value;
+	return changed;
+}
+
+/**
+ * Set a single general purpose output
+ *
+ * @param io The IO to set the output on
+ * @param bitIndex The output to set, counting from 0
+ * @param operation 0 to clear the output, 1 to set it and 2 to invert it
+ * @returns The bits that changed in the byte holding the output
+ */
+unsigned char setGPOBit(JVSIO *io, int bitIndex, int operation)
+{
+	int byteIndex = bitIndex / 8;
+	if (bitIndex < 0 || byteIndex >= JVS_MAX_GPO_BYTES)
+		return 0;
+
+	unsigned char mask = 0x80 >> (bitIndex % 8);
+	unsigned char value = io->state.gpo[byteIndex];
+	switch (operation)
+	{
+	case 0:
+		value &= ~mask;
+		break;
+	case 1:
+		value |= mask;
+		break;
+	default:
+		value ^= mask;
+		break;
+	}
+
+	return setGPOByte(io, byteIndex, value);
+}
+
+/**
+ * Set an analogue output channel
+ *
+ * @param io The IO to set the output on
+ * @param channel The channel to set, counting from 0
+ * @param value The new value of the channel
+ * @returns 1 if the value changed, 0 otherwise
+ */
+int setAnalogueOut(JVSIO *io, int channel, unsigned short value)
+{
+	if (channel < 0 || channel >= JVS_MAX_ANALOGUE_OUT || io->state.analogueOut[channel] == value)
+		return 0;
+
+	io->state.analogueOut[channel] = value;
+	return 1;
+}
+
+/* Turn a bit on or off in one source's word, latching it if it is newly on */
+static void setSourceBit(unsigned short *words, unsigned short *latch, int source, unsigned short bit, int value)
+{
+	if (source < 0 || source >= JVS_MAX_SWITCH_SOURCES)
+		source = JVS_SHARED_SWITCH_SOURCE;
+
+	if (value)
+	{
+		if (!(__atomic_fetch_or(&words[source], bit, __ATOMIC_RELAXED) & bit))
+			__atomic_fetch_or(latch, bit, __ATOMIC_RELAXED);
+	}
+	else
+	{
+		__atomic_fetch_and(&words[source], (unsigned short)~bit, __ATOMIC_RELAXED);
+	}
+}
+
+/* Every source's word ORed together, with anything turned on since the last read */
+static unsigned short readSourceBits(unsigned short *words, unsigned short *latch)
+{
+	unsigned short bits = __atomic_exchange_n(latch, 0, __ATOMIC_RELAXED);
+	for (int source = 0; source < JVS_MAX_SWITCH_SOURCES; source++)
+		bits |= __atomic_load_n(&words[source], __ATOMIC_RELAXED);
+	return bits;
+}
+
+/**
+ * Set a general purpose input
+ *
+ * GPI bits are numbered from the most significant bit, the same as the
+ * outputs, so the bytes can be sent as they are.
+ *
+ * @param io The IO to set the input on
+ * @param source The source of switches setting it
+ * @param index The input to set, counting from 0
+ * @param value 1 if the input is on, 0 otherwise
+ * @returns 1 on success, 0 if there is no such input
+ */
+int setGPI(JVSIO *io, int source, int index, int value)
+{
+	if (index < 0 || index >= JVS_MAX_GPI)
+		return 0;
+
+	setSourceBit(io->state.gpi, &io->state.gpiLatch, source, 0x8000 >> index, value);
+	return 1;
+}
+
+/**
+ * Get the general purpose inputs the game reads
+ *
+ * An input turned on since the last read is on in this one, however
+ * quickly it was turned off again.
+ *
+ * @param io The IO the inputs are on
+ * @returns The inputs with GPI 1 in the top bit
+ */
+unsigned short getGPI(JVSIO *io)
+{
+	return readSourceBits(io->state.gpi, &io->state.gpiLatch);
+}
+
+/**
+ * Press or release a keypad key
+ *
+ * @param io The IO the keypad is on
+ * @param source The source of switches pressing it
+ * @param key The key code, 0 to 9 for the digits then star and hash
+ * @param value 1 if the key is held, 0 otherwise
+ * @returns 1 on success, 0 if there is no such key
+ */
+int setKeypad(JVSIO *io, int source, int key, int value)
+{
+	if (key < 0 || key > KEYPAD_HASH - KEYPAD_0)
+		return 0;
+
+	setSourceBit(io->state.keypad, &io->state.keypadLatch, source, 1 << key, value);
+	return 1;
+}
+
+/**
+ * Get the keypad byte the game reads
+ *
+ * A key pressed since the last read counts as held for this one.
+ *
+ * @param io The IO the keypad is on
+ * @returns The code of the lowest held key with the top bit set, or 0 if none are held
+ */
+unsigned char getKeypad(JVSIO *io)
+{
+	unsigned short held = readSourceBits(io->state.keypad, &io->state.keypadLatch);
+	if (!held)
+		return 0x00;
+
+	return 0x80 | __builtin_ctz(held);
+}
+
+static int validHopper(JVSIO *io, int hopper)
+{
+	return hopper >= 0 && hopper < io->capabilities.hopper && hopper < JVS_MAX_HOPPERS;
+}
+
+/**
+ * Set how many tokens a hopper has left to pay out
+ *
+ * The payout counts are shared with the thread that dispenses them,
+ * so they are only changed atomically.
+ *
+ * @param io The IO the hopper is on
+ * @param hopper The hopper, counting from 0
+ * @param amount How many tokens to pay out
+ * @returns 1 on success, 0 if there is no such hopper
+ */
+int setPayout(JVSIO *io, int hopper, unsigned int amount)
+{
+	if (!validHopper(io, hopper))
+		return 0;
+
+	__atomic_store_n(&io->state.payout[hopper], amount, __ATOMIC_RELAXED);
+	return 1;
+}
+
+/**
+ * Add tokens to what a hopper has left to pay out
+ *
+ * A payout already running carries on with the extra tokens added, up to
+ * the most CMD_REMAINING_PAYOUT can report.
+ *
+ * @param io The IO the hopper is on
+ * @param hopper The hopper, counting from 0
+ * @param amount How many tokens to add
+ * @returns 1 on success, 0 if there is no such hopper
+ */
+int addPayout(JVSIO *io, int hopper, unsigned int amount)
+{
+	if (!validHopper(io, hopper))
+		return 0;
+
+	unsigned int payout = __atomic_load_n(&io->state.payout[hopper], __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&io->state.payout[hopper], &payout, amount > JVS_MAX_PAYOUT - payout ? JVS_MAX_PAYOUT : payout + amount,
+										1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+	return 1;
+}
+
+/**
+ * Take tokens off what a hopper has left to pay out, stopping at none
+ *
+ * @param io The IO the hopper is on
+ * @param hopper The hopper, counting from 0
+ * @param amount How many tokens to take off
+ * @returns 1 on success, 0 if there is no such hopper
+ */
+int subtractPayout(JVSIO *io, int hopper, unsigned int amount)
+{
+	if (!validHopper(io, hopper))
+		return 0;
+
+	unsigned int payout = __atomic_load_n(&io->state.payout[hopper], __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&io->state.payout[hopper], &payout, payout > amount ? payout - amount : 0,
+										1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+	return 1;
+}
+
+unsigned int getPayout(JVSIO *io, int hopper)
+{
+	if (!validHopper(io, hopper))
+		return 0;
+
+	return __atomic_load_n(&io->state.payout[hopper], __ATOMIC_RELAXED);
+}
+
+/**
+ * Pay a single token out of a hopper
+ *
+ * @param io The IO the hopper is on
+ * @param hopper The hopper, counting from 0
+ * @returns 1 if a token was paid out, 0 if the hopper had nothing left to pay
+ */
+int dispensePayout(JVSIO *io, int hopper)
+{
+	if (!validHopper(io, hopper))
+		return 0;
+
+	unsigned int payout = __atomic_load_n(&io->state.payout[hopper], __ATOMIC_RELAXED);
+	while (payout > 0)
+	{
+		if (__atomic_compare_exchange_n(&io->state.payout[hopper], &payout, payout - 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			return 1;
+	}
+	return 0;
+}
+
 JVSInput jvsInputFromString(char *jvsInputString)
 {
 	for (long unsigned int i = 0; i < sizeof(jvsInputConversion) / sizeof(jvsInputConversion[0]); i++)
@@ -4,7 +4,24 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "jvs/debounce.h"
+
 #define JVS_MAX_STATE_SIZE 100
+#define JVS_MAX_GUNS 8
+#define JVS_MAX_GPO_BYTES 32
+#define JVS_MAX_ANALOGUE_OUT 16
+#define JVS_MAX_HOPPERS 4
+#define JVS_MAX_PAYOUT 0xFFFFFF // The most CMD_REMAINING_PAYOUT can report
+#define JVS_MAX_GPI 16
+#define JVS_MAX_GPI_BYTES ((JVS_MAX_GPI + 7) / 8)
+
+/* Each device holds its own switches, so a player's sources fill exactly one cache line */
+#define JVS_MAX_SWITCH_SOURCES 16
+#define JVS_SHARED_SWITCH_SOURCE 0
+
+/* Turbo switches flick on and off every so many times the game reads them */
+#define DEFAULT_TURBO_RATE 2
+#define MAX_TURBO_RATE 255
 #define MAX_JVS_NAME_SIZE 2048
 
 typedef enum
@@ -53,6 +70,34 @@ typedef enum
     ROTARY_8 = 7,
     ROTARY_9 = 8,
     ROTARY_10 = 9,
+    GPI_1 = 200, // General Purpose Inputs, numbered away from the switch bits
+    GPI_2 = 201,
+    GPI_3 = 202,
+    GPI_4 = 203,
+    GPI_5 = 204,
+    GPI_6 = 205,
+    GPI_7 = 206,
+    GPI_8 = 207,
+    GPI_9 = 208,
+    GPI_10 = 209,
+    GPI_11 = 210,
+    GPI_12 = 211,
+    GPI_13 = 212,
+    GPI_14 = 213,
+    GPI_15 = 214,
+    GPI_16 = 215,
+    KEYPAD_0 = 220, // Keypad keys, in the order of their key codes
+    KEYPAD_1 = 221,
+    KEYPAD_2 = 222,
+    KEYPAD_3 = 223,
+    KEYPAD_4 = 224,
+    KEYPAD_5 = 225,
+    KEYPAD_6 = 226,
+    KEYPAD_7 = 227,
+    KEYPAD_8 = 228,
+    KEYPAD_9 = 229,
+    KEYPAD_STAR = 230,
+    KEYPAD_HASH = 231,
 
     /* Things that aren't actually doable */
     COIN = 98,
@@ -108,6 +153,34 @@ static const struct
     {"ROTARY_8", ROTARY_8},
     {"ROTARY_9", ROTARY_9},
     {"ROTARY_10", ROTARY_10},
+    {"GPI_1", GPI_1},
+    {"GPI_2", GPI_2},
+    {"GPI_3", GPI_3},
+    {"GPI_4", GPI_4},
+    {"GPI_5", GPI_5},
+    {"GPI_6", GPI_6},
+    {"GPI_7", GPI_7},
+    {"GPI_8", GPI_8},
+    {"GPI_9", GPI_9},
+    {"GPI_10", GPI_10},
+    {"GPI_11", GPI_11},
+    {"GPI_12", GPI_12},
+    {"GPI_13", GPI_13},
+    {"GPI_14", GPI_14},
+    {"GPI_15", GPI_15},
+    {"GPI_16", GPI_16},
+    {"KEYPAD_0", KEYPAD_0},
+    {"KEYPAD_1", KEYPAD_1},
+    {"KEYPAD_2", KEYPAD_2},
+    {"KEYPAD_3", KEYPAD_3},
+    {"KEYPAD_4", KEYPAD_4},
+    {"KEYPAD_5", KEYPAD_5},
+    {"KEYPAD_6", KEYPAD_6},
+    {"KEYPAD_7", KEYPAD_7},
+    {"KEYPAD_8", KEYPAD_8},
+    {"KEYPAD_9", KEYPAD_9},
+    {"KEYPAD_STAR", KEYPAD_STAR},
+    {"KEYPAD_HASH", KEYPAD_HASH},
     {"COIN", COIN},
 };
 
@@ -135,10 +208,18 @@ static const struct
 typedef struct
 {
     int coinCount[JVS_MAX_STATE_SIZE];
-    int inputSwitch[JVS_MAX_STATE_SIZE];
+    int inputSwitch[JVS_MAX_STATE_SIZE][JVS_MAX_SWITCH_SOURCES] __attribute__((aligned(64))); // the game sees each player's sources ORed together
+    int switchLatch[JVS_MAX_STATE_SIZE]; // switches pressed since the game last read them
     int analogueChannel[JVS_MAX_STATE_SIZE];
-    int gunChannel[JVS_MAX_STATE_SIZE];
+    unsigned int gunPosition[JVS_MAX_GUNS]; // X in the high half and Y in the low half, so a read never mixes two positions
     int rotaryChannel[JVS_MAX_STATE_SIZE];
+    unsigned char gpo[JVS_MAX_GPO_BYTES];
+    unsigned short analogueOut[JVS_MAX_ANALOGUE_OUT];
+    unsigned int payout[JVS_MAX_HOPPERS];
+    unsigned short gpi[JVS_MAX_SWITCH_SOURCES]; // GPI 1 in the top bit, each source's ORed together like the switches
+    unsigned short gpiLatch;                    // inputs turned on since the game last read them
+    unsigned short keypad[JVS_MAX_SWITCH_SOURCES];
+    unsigned short keypadLatch;
 } JVSState;
 
 typedef struct
@@ -170,6 +251,17 @@ typedef struct
     char displayName[MAX_JVS_NAME_SIZE];
 } JVSCapabilities;
 
+/* Only the responder touches this, when the game reads the switches */
+typedef struct
+{
+    unsigned int polls;
+    int mask[DEBOUNCE_MAX_PLAYERS];
+    int pressed[DEBOUNCE_MAX_PLAYERS];
+    int off[DEBOUNCE_MAX_PLAYERS]; // turbo switches the game sees let go on this poll
+    unsigned char rate[DEBOUNCE_MAX_PLAYERS][DEBOUNCE_SWITCHES];
+    unsigned int start[DEBOUNCE_MAX_PLAYERS][DEBOUNCE_SWITCHES];
+} SwitchTurbo;
+
 typedef struct JVSIO
 {
     int deviceID;
@@ -181,6 +273,8 @@ typedef struct JVSIO
     int gunYMax;
     JVSState state;
     JVSCapabilities capabilities;
+    SwitchDebounce debounce;
+    SwitchTurbo turbo;
     struct JVSIO *chainedIO;
 } JVSIO;
 
@@ -188,12 +282,33 @@ JVSCapabilities *getCapabilities(void);
 JVSState *getState(void);
 
 int initIO(JVSIO *io);
-int setSwitch(JVSIO *io, JVSPlayer player, JVSInput switchNumber, int value);
+int claimSwitchSource(void);
+void releaseSwitchSource(JVSIO *io, int source);
+int setSwitch(JVSIO *io, int source, JVSPlayer player, JVSInput switchNumber, int value);
+void pollSwitches(JVSIO *io);
+int setTurbo(JVSIO *io, JVSPlayer player, JVSInput switchNumber, int rate);
+int getSwitches(JVSIO *io, JVSPlayer player);
 int incrementCoin(JVSIO *io, JVSPlayer player, int amount);
 int setAnalogue(JVSIO *io, JVSInput channel, double value);
+int setAnalogueFixed(JVSIO *io, JVSInput channel, unsigned int value);
 int setGun(JVSIO *io, JVSInput channel, double value);
+int setGunPosition(JVSIO *io, int gun, double x, double y);
+int setGunPositionFixed(JVSIO *io, int gun, unsigned int x, unsigned int y);
+int getGunPosition(JVSIO *io, int gun, unsigned short *x, unsigned short *y);
 int setRotary(JVSIO *io, JVSInput channel, int value);
 int getRotary(JVSIO *io, JVSInput channel);
+unsigned char setGPOByte(JVSIO *io, int byteIndex, unsigned char value);
+unsigned char setGPOBit(JVSIO *io, int bitIndex, int operation);
+int setAnalogueOut(JVSIO *io, int channel, unsigned short value);
+int setGPI(JVSIO *io, int source, int index, int value);
+unsigned short getGPI(JVSIO *io);
+int setKeypad(JVSIO *io, int source, int key, int value);
+unsigned char getKeypad(JVSIO *io);
+int setPayout(JVSIO *io, int hopper, unsigned int amount);
+int addPayout(JVSIO *io, int hopper, unsigned int amount);
+int subtractPayout(JVSIO *io, int hopper, unsigned int amount);
+unsigned int getPayout(JVSIO *io, int hopper);
+int dispensePayout(JVSIO *io, int hopper);
 
 JVSInput jvsInputFromString(char *jvsInputString);
 JVSPlayer jvsPlayerFromString(char *jvsPlayerString);
@@ -1,18 +1,10 @@
 #include "jvs/jvs.h"
+#include "jvs/persist.h"
 #include "hardware/device.h"
 #include "console/debug.h"
 
 #include <time.h>
 
-/* The in and out packets used to read and write to and from*/
-JVSPacket inputPacket, outputPacket;
-
-/* The in and out buffer used to read and write to and from */
-unsigned char outputBuffer[JVS_MAX_PACKET_SIZE], inputBuffer[JVS_MAX_PACKET_SIZE];
-
-/* Packet counter for debugging */
-static unsigned long packetCounter = 0;
-
 /**
  * Get the name of a JVS command
  *
@@ -63,15 +55,18 @@ static const char *getCommandName(unsigned char cmd)
 /**
  * Initialise the JVS emulation
  *
- * Setup the JVS emulation on a specific device path with an
- * IO mapping provided.
+ * Setup the JVS emulation on a bus whose device has already
+ * been opened, with an IO mapping provided.
  *
- * @param devicePath The linux filepath for the RS485 adapter
- * @param capabilitiesSetup The representation of the IO to emulate
+ * @param bus The bus to serve the IO on
+ * @param jvsIO The representation of the IO to emulate
  * @returns 1 if the device was initialised successfully, 0 otherwise.
  */
-int initJVS(JVSIO *jvsIO)
+int initJVS(JVSBus *bus, JVSIO *jvsIO)
 {
+	bus->io = jvsIO;
+	bus->outputPacket.length = 0;
+
 	/* Calculate the alignments for analogue and gun channels, default is left */
 	if (!jvsIO->capabilities.rightAlignBits)
 	{
@@ -81,7 +76,7 @@ int initJVS(JVSIO *jvsIO)
 	}
 
 	/* Float the sense line ready for connection */
-	setSenseLine(0);
+	setSenseLine(&bus->device, 0);
 
 	return 1;
 }
@@ -92,11 +87,16 @@ int initJVS(JVSIO *jvsIO)
  * Disconnects from the device communicating with the
  * arcade machine so JVS can be shutdown safely.
  *
+ * @param bus The bus to disconnect
  * @returns 1 if the device disconnected successfully, 0 otherwise.
  */
-int disconnectJVS(void)
+int disconnectJVS(JVSBus *bus)
 {
-	return closeDevice();
+	if (bus->packetCounter > 0)
+		debug(1, "Bus I/O made %lu system calls for %lu packets, %.2f per poll\n",
+			  bus->device.syscalls, bus->packetCounter, (double)bus->device.syscalls / bus->packetCounter);
+
+	return closeDevice(&bus->device);
 }
 
 /**
@@ -192,52 +192,96 @@ static void writeFeatures(JVSPacket *packet, JVSCapabilities *capabilities)
 	packet->length += 1;
 }
 
+/* Boards count from 0 along the chain, the same as the outputs and displays are indexed by */
+static int getBoard(JVSBus *bus, JVSIO *io)
+{
+	int board = 0;
+	for (JVSIO *chained = bus->io; chained != NULL && chained != io; chained = chained->chainedIO)
+		board++;
+	return board;
+}
+
+/**
+ * Pass changed outputs on to the output worker
+ *
+ * The worker drives the lamps, solenoids and other devices
+ * hanging off the outputs, so the responder never waits on them.
+ *
+ * @param bus The bus the outputs were written on
+ * @param io The IO that was written to
+ * @param byteIndex The GPO byte that was written
+ * @param changed The bits of the byte that changed
+ */
+static void publishGPO(JVSBus *bus, JVSIO *io, int byteIndex, unsigned char changed)
+{
+	if (!changed || !bus->outputQueue)
+		return;
+
+	OutputEvent event = {.board = getBoard(bus, io), .byte = byteIndex, .value = io->state.gpo[byteIndex]};
+	clock_gettime(CLOCK_MONOTONIC, &event.time);
+	pushOutput(bus->outputQueue, &event);
+}
+
+/* Force feedback follows the analogue outputs of the first board on the bus */
+static void publishAnalogueOut(JVSBus *bus, JVSIO *io, int channel)
+{
+	if (!bus->ffb || io != bus->io)
+		return;
+
+	pushFFB(bus->ffb, channel, io->state.analogueOut[channel]);
+}
+
 /**
  * Processes and responds to an entire JVS packet
  *
  * Follows the JVS spec and proceses and responds
  * to a single entire JVS packet.
  *
+ * @param bus The bus to read the packet from and respond on
  * @returns The status of the entire operation
  */
-JVSStatus processPacket(JVSIO *jvsIO)
+JVSStatus processPacket(JVSBus *bus)
 {
+	JVSIO *jvsIO = bus->io;
+	JVSPacket *inputPacket = &bus->inputPacket;
+	JVSPacket *outputPacket = &bus->outputPacket;
+
 	/* Initially read in a packet */
-	JVSStatus readPacketStatus = readPacket(&inputPacket);
+	JVSStatus readPacketStatus = readPacket(bus, inputPacket);
 	if (readPacketStatus != JVS_STATUS_SUCCESS)
 		return readPacketStatus;
 
 	/* Check if the packet is for us and loop through connected boards */
-	if (inputPacket.destination != BROADCAST)
+	if (inputPacket->destination != BROADCAST)
 	{
-		while (inputPacket.destination != jvsIO->deviceID && jvsIO->chainedIO != NULL)
+		while (inputPacket->destination != jvsIO->deviceID && jvsIO->chainedIO != NULL)
 		{
 			jvsIO = jvsIO->chainedIO;
 		}
 
-		if (inputPacket.destination != jvsIO->deviceID)
+		if (inputPacket->destination != jvsIO->deviceID)
 		{
 			return JVS_STATUS_NOT_FOR_US;
 		}
 	}
 
 	/* Handle re-transmission requests */
-	if (inputPacket.data[0] == CMD_RETRANSMIT)
-		return writePacket(&outputPacket);
+	if (inputPacket->data[0] == CMD_RETRANSMIT)
+		return writePacket(bus, outputPacket);
 
 	/* Setup the output packet */
-	outputPacket.length = 0;
-	outputPacket.destination = BUS_MASTER;
+	outputPacket->length = 0;
+	outputPacket->destination = BUS_MASTER;
 
 	int index = 0;
 
 	/* Set the entire packet success line */
-	outputPacket.data[outputPacket.length++] = STATUS_SUCCESS;
+	outputPacket->data[outputPacket->length++] = STATUS_SUCCESS;
 
-	while (index < inputPacket.length - 1)
+	while (index < inputPacket->length - 1)
 	{
 		int size = 1;
-		switch (inputPacket.data[index])
+		switch (inputPacket->data[index])
 		{
 
 		/* The arcade hardware sends a reset command and we clear our memory */
@@ -251,7 +295,7 @@ JVSStatus processPacket(JVSIO *jvsIO)
 				jvsIO = jvsIO->chainedIO;
 				jvsIO->deviceID = -1;
 			}
-			setSenseLine(0);
+			setSenseLine(&bus->device, 0);
 		}
 		break;
 
@@ -266,13 +310,13 @@ JVSStatus processPacket(JVSIO *jvsIO)
 				ioToAssign = jvsIO->chainedIO;
 			}
 
-			ioToAssign->deviceID = inputPacket.data[index + 1];
+			ioToAssign->deviceID = inputPacket->data[index + 1];
 			debug(1, "CMD_ASSIGN_ADDR - Assigning address 0x%02X\n", ioToAssign->deviceID);
-			outputPacket.data[outputPacket.length++] = REPORT_SUCCESS;
+			outputPacket->data[outputPacket->length++] = REPORT_SUCCESS;
 
 			if (jvsIO->deviceID != -1)
 			{
-				setSenseLine(1);
+				setSenseLine(&bus->device, 1);
 			}
 		}
 		break;
@@ -283,7 +327,7 @@ JVSStatus processPacket(JVSIO *jvsIO)
 			debug(1, "CMD_REQUEST_ID - Returning ID: %s\n", jvsIO->capabilities.name);
 			size_t nameLen = strlen(jvsIO->capabilities.name);
 			/* Calculate available space: total buffer - current position - REPORT_SUCCESS byte - null terminator byte */
-			size_t availableSpace = JVS_MAX_PACKET_SIZE - outputPacket.length - 2;
+			size_t availableSpace = JVS_MAX_PACKET_SIZE - outputPacket->length - 2;
 			
 			/* Check if the name fits in the packet buffer */
 			if (nameLen > availableSpace)
@@ -292,11 +336,11 @@ JVSStatus processPacket(JVSIO *jvsIO)
 				nameLen = availableSpace;
 			}
 			
-			outputPacket.data[outputPacket.length] = REPORT_SUCCESS;
-			memcpy(&outputPacket.data[outputPacket.length + 1], jvsIO->capabilities.name, nameLen);
+			outputPacket->data[outputPacket->length] = REPORT_SUCCESS;
+			memcpy(&outputPacket->data[outputPacket->length + 1], jvsIO->capabilities.name, nameLen);
 			/* Always add null terminator within bounds */
-			outputPacket.data[outputPacket.length + 1 + nameLen] = '\0';
-			outputPacket.length += nameLen + 2;  // +1 for REPORT_SUCCESS, +1 for null terminator
+			outputPacket->data[outputPacket->length + 1 + nameLen] = '\0';
+			outputPacket->length += nameLen + 2;  // +1 for REPORT_SUCCESS, +1 for null terminator
 		}
 		break;
 
@@ -304,9 +348,9 @@ JVSStatus processPacket(JVSIO *jvsIO)
 		case CMD_COMMAND_VERSION:
 		{
 			debug(1, "CMD_COMMAND_VERSION - Returning version 0x%02X\n", jvsIO->capabilities.commandVersion);
-			outputPacket.data[outputPacket.length] = REPORT_SUCCESS;
-			outputPacket.data[outputPacket.length + 1] = jvsIO->capabilities.commandVersion;
-			outputPacket.length += 2;
+			outputPacket->data[outputPacket->length] = REPORT_SUCCESS;
+			outputPacket->data[outputPacket->length + 1] = jvsIO->capabilities.commandVersion;
+			outputPacket->length += 2;
 		}
 		break;
 
@@ -314,9 +358,9 @@ JVSStatus processPacket(JVSIO *jvsIO)
 		case CMD_JVS_VERSION:
 		{
 			debug(1, "CMD_JVS_VERSION - Returning version 0x%02X\n", jvsIO->capabilities.jvsVersion);
-			outputPacket.data[outputPacket.length] = REPORT_SUCCESS;
-			outputPacket.data[outputPacket.length + 1] = jvsIO->capabilities.jvsVersion;
-			outputPacket.length += 2;
+			outputPacket->data[outputPacket->length] = REPORT_SUCCESS;
+			outputPacket->data[outputPacket->length + 1] = jvsIO->capabilities.jvsVersion;
+			outputPacket->length += 2;
 		}
 		break;
 
@@ -324,9 +368,9 @@ JVSStatus processPacket(JVSIO *jvsIO)
 		case CMD_COMMS_VERSION:
 		{
 			debug(1, "CMD_COMMS_VERSION - Returning version 0x%02X\n", jvsIO->capabilities.commsVersion);
-			outputPacket.data[outputPacket.length] = REPORT_SUCCESS;
-			outputPacket.data[outputPacket.length + 1] = jvsIO->capabilities.commsVersion;
-			outputPacket.length += 2;
+			outputPacket->data[outputPacket->length] = REPORT_SUCCESS;
+			outputPacket->data[outputPacket->length + 1] = jvsIO->capabilities.commsVersion;
+			outputPacket->length += 2;
 		}
 		break;
 
@@ -334,7 +378,7 @@ JVSStatus processPacket(JVSIO *jvsIO)
 		case CMD_CAPABILITIES:
 		{
 			debug(1, "CMD_CAPABILITIES - Returning capabilities\n");
-			writeFeatures(&outputPacket, &jvsIO->capabilities);
+			writeFeatures(outputPacket, &jvsIO->capabilities);
 		}
 		break;
 
@@ -343,22 +387,24 @@ JVSStatus processPacket(JVSIO *jvsIO)
 		{
 			size = 3;
 			debug(1, "CMD_READ_SWITCHES - Players: %d, Switches: %d\n", 
-				inputPacket.data[index + 1], inputPacket.data[index + 2]);
-			outputPacket.data[outputPacket.length] = REPORT_SUCCESS;
-			outputPacket.data[outputPacket.length + 1] = jvsIO->state.inputSwitch[0];
-			outputPacket.length += 2;
-			for (int i = 0; i < inputPacket.data[index + 1]; i++)
+				inputPacket->data[index + 1], inputPacket->data[index + 2]);
+			outputPacket->data[outputPacket->length] = REPORT_SUCCESS;
+			pollSwitches(jvsIO);
+			outputPacket->data[outputPacket->length + 1] = getSwitches(jvsIO, SYSTEM);
+			outputPacket->length += 2;
+			for (int i = 0; i < inputPacket->data[index + 1]; i++)
 			{
-				for (int j = 0; j < inputPacket.data[index + 2]; j++)
+				int switches = getSwitches(jvsIO, i + 1);
+				for (int j = 0; j < inputPacket->data[index + 2]; j++)
 				{
 					// Bounds check to prevent buffer overflow
 					// Check before writing to ensure we have space for the next byte
-					if (outputPacket.length + 1 > JVS_MAX_PACKET_SIZE)
+					if (outputPacket->length + 1 > JVS_MAX_PACKET_SIZE)
 					{
 						debug(0, "Error: Output packet size exceeded in CMD_READ_SWITCHES\n");
 						return JVS_STATUS_ERROR;
 					}
-					outputPacket.data[outputPacket.length++] = jvsIO->state.inputSwitch[i + 1] >> (8 - (j * 8));
+					outputPacket->data[outputPacket->length++] = switches >> (8 - (j * 8));
 				}
 			}
 		}
@@ -367,22 +413,22 @@ JVSStatus processPacket(JVSIO *jvsIO)
 		case CMD_READ_COINS:
 		{
 			size = 2;
-			int numberCoinSlots = inputPacket.data[index + 1];
+			int numberCoinSlots = inputPacket->data[index + 1];
 			debug(1, "CMD_READ_COINS - Reading %d coin slot(s)\n", numberCoinSlots);
-			outputPacket.data[outputPacket.length++] = REPORT_SUCCESS;
+			outputPacket->data[outputPacket->length++] = REPORT_SUCCESS;
 
 			for (int i = 0; i < numberCoinSlots; i++)
 			{
 				// Bounds check to prevent buffer overflow
-				if (outputPacket.length + 2 > JVS_MAX_PACKET_SIZE)
+				if (outputPacket->length + 2 > JVS_MAX_PACKET_SIZE)
 				{
 					debug(0, "Error: Output packet size exceeded in CMD_READ_COINS\n");
 					return JVS_STATUS_ERROR;
 				}
 				// Send coin count as 2 bytes (high byte with 5-bit limit, then low byte)
-				outputPacket.data[outputPacket.length] = (jvsIO->state.coinCount[i] >> 8) & 0x1F;
-				outputPacket.data[outputPacket.length + 1] = jvsIO->state.coinCount[i] & 0xFF;
-				outputPacket.length += 2;
+				outputPacket->data[outputPacket->length] = (jvsIO->state.coinCount[i] >> 8) & 0x1F;
+				outputPacket->data[outputPacket->length + 1] = jvsIO->state.coinCount[i] & 0xFF;
+				outputPacket->length += 2;
 			}
 		}
 		break;
@@ -390,24 +436,24 @@ JVSStatus processPacket(JVSIO *jvsIO)
 		case CMD_READ_ANALOGS:
 		{
 			size = 2;
-			int numberChannels = inputPacket.data[index + 1];
+			int numberChannels = inputPacket->data[index + 1];
 			debug(1, "CMD_READ_ANALOGS - Reading %d analog channel(s)\n", numberChannels);
 
-			outputPacket.data[outputPacket.length++] = REPORT_SUCCESS;
+			outputPacket->data[outputPacket->length++] = REPORT_SUCCESS;
 
 			for (int i = 0; i < numberChannels; i++)
 			{
 				// Bounds check to prevent buffer overflow
-				if (outputPacket.length + 2 > JVS_MAX_PACKET_SIZE)
+				if (outputPacket->length + 2 > JVS_MAX_PACKET_SIZE)
 				{
 					debug(0, "Error: Output packet size exceeded in CMD_READ_ANALOGS\n");
 					return JVS_STATUS_ERROR;
 				}
 				/* By default left align the data */
 				int analogueData = jvsIO->state.analogueChannel[i] << jvsIO->analogueRestBits;
-				outputPacket.data[outputPacket.length] = analogueData >> 8;
-				outputPacket.data[outputPacket.length + 1] = analogueData;
-				outputPacket.length += 2;
+				outputPacket->data[outputPacket->length] = analogueData >> 8;
+				outputPacket->data[outputPacket->length + 1] = analogueData;
+				outputPacket->length += 2;
 			}
 		}
 		break;
@@ -415,22 +461,22 @@ JVSStatus processPacket(JVSIO *jvsIO)
 		case CMD_READ_ROTARY:
 		{
 			size = 2;
-			int numberChannels = inputPacket.data[index + 1];
+			int numberChannels = inputPacket->data[index + 1];
 			debug(1, "CMD_READ_ROTARY - Reading %d rotary channel(s)\n", numberChannels);
 
-			outputPacket.data[outputPacket.length++] = REPORT_SUCCESS;
+			outputPacket->data[outputPacket->length++] = REPORT_SUCCESS;
 
 			for (int i = 0; i < numberChannels; i++)
 			{
 				// Bounds check to prevent buffer overflow
-				if (outputPacket.length + 2 > JVS_MAX_PACKET_SIZE)
+				if (outputPacket->length + 2 > JVS_MAX_PACKET_SIZE)
 				{
 					debug(0, "Error: Output packet size exceeded in CMD_READ_ROTARY\n");
 					return JVS_STATUS_ERROR;
 				}
-				outputPacket.data[outputPacket.length] = jvsIO->state.rotaryChannel[i] >> 8;
-				outputPacket.data[outputPacket.length + 1] = jvsIO->state.rotaryChannel[i] & 0xFF;
-				outputPacket.length += 2;
+				outputPacket->data[outputPacket->length] = jvsIO->state.rotaryChannel[i] >> 8;
+				outputPacket->data[outputPacket->length + 1] = jvsIO->state.rotaryChannel[i] & 0xFF;
+				outputPacket->length += 2;
 			}
 		}
 		break;
@@ -439,93 +485,123 @@ JVSStatus processPacket(JVSIO *jvsIO)
 		{
 			debug(1, "CMD_READ_KEYPAD - Reading keypad state\n");
 			// Bounds check to prevent buffer overflow
-			if (outputPacket.length + 2 > JVS_MAX_PACKET_SIZE)
+			if (outputPacket->length + 2 > JVS_MAX_PACKET_SIZE)
 			{
 				debug(0, "Error: Output packet size exceeded in CMD_READ_KEYPAD\n");
 				return JVS_STATUS_ERROR;
 			}
-			outputPacket.data[outputPacket.length] = REPORT_SUCCESS;
-			outputPacket.data[outputPacket.length + 1] = 0x00;
-			outputPacket.length += 2;
+			outputPacket->data[outputPacket->length] = REPORT_SUCCESS;
+			outputPacket->data[outputPacket->length + 1] = getKeypad(jvsIO);
+			outputPacket->length += 2;
 		}
 		break;
 
 		case CMD_READ_GPI:
 		{
 			size = 2;
-			int numberBytes = inputPacket.data[index + 1];
+			int numberBytes = inputPacket->data[index + 1];
 			debug(1, "CMD_READ_GPI - Reading %d byte(s) of GPI data\n", numberBytes);
-			outputPacket.data[outputPacket.length++] = REPORT_SUCCESS;
-			for (int i = 0; i < inputPacket.data[index + 1]; i++)
+			if (outputPacket->length + 1 + numberBytes > JVS_MAX_PACKET_SIZE)
+			{
+				debug(0, "Error: Output packet size exceeded in CMD_READ_GPI\n");
+				return JVS_STATUS_ERROR;
+			}
+			outputPacket->data[outputPacket->length++] = REPORT_SUCCESS;
+			unsigned short gpi = getGPI(jvsIO);
+			for (int i = 0; i < numberBytes; i++)
 			{
-				outputPacket.data[outputPacket.length++] = 0x00;
+				outputPacket->data[outputPacket->length++] = i < JVS_MAX_GPI_BYTES ? (gpi >> (8 * (JVS_MAX_GPI_BYTES - 1 - i))) & 0xFF : 0x00;
 			}
 		}
 		break;
 
 		case CMD_REMAINING_PAYOUT:
 		{
-			debug(1, "CMD_REMAINING_PAYOUT - Returning payout status\n");
 			size = 2;
-			outputPacket.data[outputPacket.length] = REPORT_SUCCESS;
-			outputPacket.data[outputPacket.length + 1] = 0;
-			outputPacket.data[outputPacket.length + 2] = 0;
-			outputPacket.data[outputPacket.length + 3] = 0;
-			outputPacket.data[outputPacket.length + 4] = 0;
-			outputPacket.length += 5;
+			int hopper = inputPacket->data[index + 1] - 1;
+			unsigned int payout = getPayout(jvsIO, hopper);
+			debug(1, "CMD_REMAINING_PAYOUT - Hopper %d has %u left to pay out\n", hopper + 1, payout);
+
+			/* The hopper status comes first, the simulated hoppers never jam or run dry */
+			outputPacket->data[outputPacket->length] = REPORT_SUCCESS;
+			outputPacket->data[outputPacket->length + 1] = 0;
+			outputPacket->data[outputPacket->length + 2] = (payout >> 16) & 0xFF;
+			outputPacket->data[outputPacket->length + 3] = (payout >> 8) & 0xFF;
+			outputPacket->data[outputPacket->length + 4] = payout & 0xFF;
+			outputPacket->length += 5;
 		}
 		break;
 
 		case CMD_SET_PAYOUT:
 		{
-			debug(1, "CMD_SET_PAYOUT - Setting payout value\n");
 			size = 4;
-			outputPacket.data[outputPacket.length++] = REPORT_SUCCESS;
+			int hopper = inputPacket->data[index + 1] - 1;
+			unsigned int payout = (inputPacket->data[index + 2] << 8) | inputPacket->data[index + 3];
+			debug(1, "CMD_SET_PAYOUT - Hopper %d to pay out %u more\n", hopper + 1, payout);
+			if (addPayout(jvsIO, hopper, payout))
+				markPayoutChanged();
+			outputPacket->data[outputPacket->length++] = REPORT_SUCCESS;
 		}
 		break;
 
 		case CMD_WRITE_GPO:
 		{
-			int numBytes = inputPacket.data[index + 1];
+			int numBytes = inputPacket->data[index + 1];
 			debug(1, "CMD_WRITE_GPO - Writing %d byte(s) to GPO\n", numBytes);
 			size = 2 + numBytes;
-			outputPacket.data[outputPacket.length] = REPORT_SUCCESS;
-			outputPacket.length += 1;
+			for (int i = 0; i < numBytes && index + 2 + i < inputPacket->length - 1; i++)
+				publishGPO(bus, jvsIO, i, setGPOByte(jvsIO, i, inputPacket->data[index + 2 + i]));
+			outputPacket->data[outputPacket->length] = REPORT_SUCCESS;
+			outputPacket->length += 1;
 		}
 		break;
 
 		case CMD_WRITE_GPO_BYTE:
 		{
 			debug(1, "CMD_WRITE_GPO_BYTE - Byte %d = 0x%02X\n", 
-				inputPacket.data[index + 1], inputPacket.data[index + 2]);
+				inputPacket->data[index + 1], inputPacket->data[index + 2]);
 			size = 3;
-			outputPacket.data[outputPacket.length++] = REPORT_SUCCESS;
+			int byteIndex = inputPacket->data[index + 1];
+			publishGPO(bus, jvsIO, byteIndex, setGPOByte(jvsIO, byteIndex, inputPacket->data[index + 2]));
+			outputPacket->data[outputPacket->length++] = REPORT_SUCCESS;
 		}
 		break;
 
 		case CMD_WRITE_GPO_BIT:
 		{
-			debug(1, "CMD_WRITE_GPO_BIT - Byte %d, Bit %d\n", 
-				inputPacket.data[index + 1], inputPacket.data[index + 2]);
+			debug(1, "CMD_WRITE_GPO_BIT - Bit %d, Operation %d\n", 
+				inputPacket->data[index + 1], inputPacket->data[index + 2]);
 			size = 3;
-			outputPacket.data[outputPacket.length++] = REPORT_SUCCESS;
+			int bitIndex = inputPacket->data[index + 1];
+			publishGPO(bus, jvsIO, bitIndex / 8, setGPOBit(jvsIO, bitIndex, inputPacket->data[index + 2]));
+			outputPacket->data[outputPacket->length++] = REPORT_SUCCESS;
 		}
 		break;
 
 		case CMD_WRITE_ANALOG:
 		{
-			int numChannels = inputPacket.data[index + 1];
+			int numChannels = inputPacket->data[index + 1];
 			debug(1, "CMD_WRITE_ANALOG - Writing %d analog channel(s)\n", numChannels);
 			size = numChannels * 2 + 2;
-			outputPacket.data[outputPacket.length++] = REPORT_SUCCESS;
+			for (int channel = 0; channel < numChannels && index + 3 + channel * 2 < inputPacket->length - 1; channel++)
+			{
+				unsigned short value = (inputPacket->data[index + 2 + channel * 2] << 8) | inputPacket->data[index + 3 + channel * 2];
+				if (setAnalogueOut(jvsIO, channel, value))
+					publishAnalogueOut(bus, jvsIO, channel);
+			}
+			outputPacket->data[outputPacket->length++] = REPORT_SUCCESS;
 		}
 		break;
 
 		case CMD_SUBTRACT_PAYOUT:
 		{
-			debug(1, "CMD_SUBTRACT_PAYOUT - Subtracting payout\n");
-			size = 3;
-			outputPacket.data[outputPacket.length++] = REPORT_SUCCESS;
+			size = 4;
+			int hopper = inputPacket->data[index + 1] - 1;
+			unsigned int amount = (inputPacket->data[index + 2] << 8) | inputPacket->data[index + 3];
+			debug(1, "CMD_SUBTRACT_PAYOUT - Hopper %d, subtracting %u\n", hopper + 1, amount);
+			if (subtractPayout(jvsIO, hopper, amount))
+				markPayoutChanged();
+			outputPacket->data[outputPacket->length++] = REPORT_SUCCESS;
 		}
 		break;
 
@@ -533,24 +609,29 @@ JVSStatus processPacket(JVSIO *jvsIO)
 		{
 			size = 4;
 			// - 1 because JVS is 1-indexed, but our array is 0-indexed
-			int slot_index = inputPacket.data[index + 1] - 1;
-			int coin_increment = ((int)(inputPacket.data[index + 3]) | ((int)(inputPacket.data[index + 2]) << 8));
+			int slot_index = inputPacket->data[index + 1] - 1;
+			int coin_increment = ((int)(inputPacket->data[index + 3]) | ((int)(inputPacket->data[index + 2]) << 8));
 			debug(1, "CMD_WRITE_COINS - Slot %d, incrementing by %d\n", slot_index + 1, coin_increment);
 
-			outputPacket.data[outputPacket.length++] = REPORT_SUCCESS;
+			outputPacket->data[outputPacket->length++] = REPORT_SUCCESS;
 
 			/* Prevent overflow of coins */
 			if (coin_increment + jvsIO->state.coinCount[slot_index] > 16383)
 				coin_increment = 16383 - jvsIO->state.coinCount[slot_index];
 			jvsIO->state.coinCount[slot_index] += coin_increment;
+			markCoinsChanged();
 		}
 		break;
 
 		case CMD_WRITE_DISPLAY:
 		{
-			debug(1, "CMD_WRITE_DISPLAY - Writing display data\n");
-			size = (inputPacket.data[index + 1] * 2) + 2;
-			outputPacket.data[outputPacket.length++] = REPORT_SUCCESS;
+			int numCharacters = inputPacket->data[index + 1];
+			debug(1, "CMD_WRITE_DISPLAY - Writing %d character(s) to the display\n", numCharacters);
+			size = (numCharacters * 2) + 2;
+			int board = getBoard(bus, jvsIO);
+			if (board < OUTPUT_MAX_BOARDS && bus->display[board] && index + size <= inputPacket->length - 1)
+				writeDisplay(bus->display[board], &inputPacket->data[index + 2], numCharacters);
+			outputPacket->data[outputPacket->length++] = REPORT_SUCCESS;
 		}
 		break;
 
@@ -558,16 +639,17 @@ JVSStatus processPacket(JVSIO *jvsIO)
 		{
 			size = 4;
 			// - 1 because JVS is 1-indexed, but our array is 0-indexed
-			int slot_index = inputPacket.data[index + 1] - 1;
-			int coin_decrement = ((int)(inputPacket.data[index + 3]) | ((int)(inputPacket.data[index + 2]) << 8));
+			int slot_index = inputPacket->data[index + 1] - 1;
+			int coin_decrement = ((int)(inputPacket->data[index + 3]) | ((int)(inputPacket->data[index + 2]) << 8));
 			debug(1, "CMD_DECREASE_COINS - Slot %d, decrementing by %d\n", slot_index + 1, coin_decrement);
 
-			outputPacket.data[outputPacket.length++] = REPORT_SUCCESS;
+			outputPacket->data[outputPacket->length++] = REPORT_SUCCESS;
 
 			/* Prevent underflow of coins */
 			if (coin_decrement > jvsIO->state.coinCount[slot_index])
 				coin_decrement = jvsIO->state.coinCount[slot_index];
 			jvsIO->state.coinCount[slot_index] -= coin_decrement;
+			markCoinsChanged();
 		}
 		break;
 
@@ -575,14 +657,14 @@ JVSStatus processPacket(JVSIO *jvsIO)
 		{
 			debug(1, "CMD_CONVEY_ID - Receiving main board ID\n");
 			size = 1;
-			outputPacket.data[outputPacket.length++] = REPORT_SUCCESS;
+			outputPacket->data[outputPacket->length++] = REPORT_SUCCESS;
 			char idData[100];
 			idData[0] = '\0'; // Initialize to empty string
 			for (int i = 1; i < 100; i++)
 			{
-				idData[i] = (char)inputPacket.data[index + i];
+				idData[i] = (char)inputPacket->data[index + i];
 				size++;
-				if (!inputPacket.data[index + i])
+				if (!inputPacket->data[index + i])
 					break;
 			}
 			debug(0, "CMD_CONVEY_ID - Main board ID: %s\n", idData);
@@ -592,17 +674,34 @@ JVSStatus processPacket(JVSIO *jvsIO)
 		/* The touch screen and light gun input, simply using analogue channels */
 		case CMD_READ_LIGHTGUN:
 		{
-			debug(1, "CMD_READ_LIGHTGUN - Reading light gun position\n");
 			size = 2;
 
-			int analogueXData = jvsIO->state.gunChannel[0] << jvsIO->gunXRestBits;
-			int analogueYData = jvsIO->state.gunChannel[1] << jvsIO->gunYRestBits;
-			outputPacket.data[outputPacket.length] = REPORT_SUCCESS;
-			outputPacket.data[outputPacket.length + 1] = analogueXData >> 8;
-			outputPacket.data[outputPacket.length + 2] = analogueXData;
-			outputPacket.data[outputPacket.length + 3] = analogueYData >> 8;
-			outputPacket.data[outputPacket.length + 4] = analogueYData;
-			outputPacket.length += 5;
+			/* Channels count from 1, a request for channel 0 gets the first gun as it always has */
+			int channel = inputPacket->data[index + 1];
+			int gun = channel > 0 ? channel - 1 : 0;
+			debug(1, "CMD_READ_LIGHTGUN - Reading light gun position %d\n", gun + 1);
+
+			if (outputPacket->length + 5 > JVS_MAX_PACKET_SIZE)
+			{
+				debug(0, "Error: Output packet size exceeded in CMD_READ_LIGHTGUN\n");
+				return JVS_STATUS_ERROR;
+			}
+
+			unsigned short x, y;
+			if (!getGunPosition(jvsIO, gun, &x, &y))
+			{
+				outputPacket->data[outputPacket->length++] = REPORT_PARAMETER_ERROR1;
+				break;
+			}
+
+			int analogueXData = x << jvsIO->gunXRestBits;
+			int analogueYData = y << jvsIO->gunYRestBits;
+			outputPacket->data[outputPacket->length] = REPORT_SUCCESS;
+			outputPacket->data[outputPacket->length + 1] = analogueXData >> 8;
+			outputPacket->data[outputPacket->length + 2] = analogueXData;
+			outputPacket->data[outputPacket->length + 3] = analogueYData >> 8;
+			outputPacket->data[outputPacket->length + 4] = analogueYData;
+			outputPacket->length += 5;
 		}
 		break;
 
@@ -611,18 +710,18 @@ JVSStatus processPacket(JVSIO *jvsIO)
 		{
 			debug(1, "CMD_NAMCO_SPECIFIC - Processing Namco command\n");
 
-			outputPacket.data[outputPacket.length++] = REPORT_SUCCESS;
+			outputPacket->data[outputPacket->length++] = REPORT_SUCCESS;
 
 			size = 2;
 
-			switch (inputPacket.data[index + 1])
+			switch (inputPacket->data[index + 1])
 			{
 
 			// Read 8 bytes of memory
 			case 0x01:
 			{
 				for (int i = 0; i < 8; i++)
-					outputPacket.data[outputPacket.length++] = 0xFF;
+					outputPacket->data[outputPacket->length++] = 0xFF;
 			}
 			break;
 
@@ -631,8 +730,8 @@ JVSStatus processPacket(JVSIO *jvsIO)
 			{
 				// 1998 October 26th at 12:00:00 (Unsure what last 00 is)
 				unsigned char programDate[] = {0x19, 0x98, 0x10, 0x26, 0x12, 0x00, 0x00, 0x00};
-				memcpy(&outputPacket.data[outputPacket.length], programDate, 8);
-				outputPacket.length += 8;
+				memcpy(&outputPacket->data[outputPacket->length], programDate, 8);
+				outputPacket->length += 8;
 			}
 			break;
 
@@ -640,15 +739,15 @@ JVSStatus processPacket(JVSIO *jvsIO)
 			case 0x03:
 			{
 				unsigned char dips = 0xFF;
-				outputPacket.data[outputPacket.length++] = dips;
+				outputPacket->data[outputPacket->length++] = dips;
 			}
 			break;
 
 			// Unsure
 			case 0x04:
 			{
-				outputPacket.data[outputPacket.length++] = 0xFF;
-				outputPacket.data[outputPacket.length++] = 0xFF;
+				outputPacket->data[outputPacket->length++] = 0xFF;
+				outputPacket->data[outputPacket->length++] = 0xFF;
 			}
 			break;
 
@@ -656,13 +755,13 @@ JVSStatus processPacket(JVSIO *jvsIO)
 			case 0x18:
 			{
 				size += 4;
-				outputPacket.data[outputPacket.length++] = 0xFF;
+				outputPacket->data[outputPacket->length++] = 0xFF;
 			}
 			break;
 
 			default:
 			{
-				debug(0, "CMD_NAMCO_UNSUPPORTED - Unsupported Namco command: 0x%02hhX\n", inputPacket.data[index + 1]);
+				debug(0, "CMD_NAMCO_UNSUPPORTED - Unsupported Namco command: 0x%02hhX\n", inputPacket->data[index + 1]);
 			}
 			}
 		}
@@ -670,13 +769,13 @@ JVSStatus processPacket(JVSIO *jvsIO)
 
 		default:
 		{
-			debug(0, "CMD_UNSUPPORTED - Unsupported command: 0x%02hhX\n", inputPacket.data[index]);
+			debug(0, "CMD_UNSUPPORTED - Unsupported command: 0x%02hhX\n", inputPacket->data[index]);
 		}
 		}
 		index += size;
 	}
 
-	return writePacket(&outputPacket);
+	return writePacket(bus, outputPacket);
 }
 
 /**
@@ -686,16 +785,18 @@ JVSStatus processPacket(JVSIO *jvsIO)
  * after it has been received, unescaped and checked
  * for any checksum errors.
  *
+ * @param bus The bus to read from
  * @param packet The packet to read into
  */
-JVSStatus readPacket(JVSPacket *packet)
+JVSStatus readPacket(JVSBus *bus, JVSPacket *packet)
 {
+	unsigned char *inputBuffer = bus->inputBuffer;
 	int bytesAvailable = 0, escape = 0, phase = 0, index = 0, dataIndex = 0, finished = 0;
 	unsigned char checksum = 0x00;
 
 	while (!finished)
 	{
-		int bytesRead = readBytes(inputBuffer + bytesAvailable, JVS_MAX_PACKET_SIZE - bytesAvailable);
+		int bytesRead = readBytes(&bus->device, inputBuffer + bytesAvailable, JVS_MAX_PACKET_SIZE - bytesAvailable);
 
 		if (bytesRead < 0)
 			return JVS_STATUS_ERROR_TIMEOUT;
@@ -759,10 +860,12 @@ JVSStatus readPacket(JVSPacket *packet)
 		}
 	}
 
+	bus->packetCounter++;
+
 	/* Only compute debug output if debug level is high enough */
 	if (getDebugLevel() >= 2)
 	{
-		debug(2, "\n=== INPUT PACKET #%lu ===\n", ++packetCounter);
+		debug(2, "\n=== INPUT PACKET #%lu ===\n", bus->packetCounter);
 		debug(2, "  Destination: 0x%02X  Length: %d bytes\n", packet->destination, packet->length);
 		
 		/* Show potential commands in packet data 
@@ -798,10 +901,13 @@ JVSStatus readPacket(JVSPacket *packet)
  * system after it has been escaped and had
  * a checksum calculated.
  *
+ * @param bus The bus to write to
  * @param packet The packet to send
  */
-JVSStatus writePacket(JVSPacket *packet)
+JVSStatus writePacket(JVSBus *bus, JVSPacket *packet)
 {
+	unsigned char *outputBuffer = bus->outputBuffer;
+
 	/* Don't return anything if there isn't anything to write! */
 	if (packet->length < 2)
 		return JVS_STATUS_SUCCESS;
@@ -845,7 +951,7 @@ JVSStatus writePacket(JVSPacket *packet)
 	/* Only compute debug output if debug level is high enough */
 	if (getDebugLevel() >= 2)
 	{
-		debug(2, "\n=== OUTPUT PACKET #%lu ===\n", packetCounter);
+		debug(2, "\n=== OUTPUT PACKET #%lu ===\n", bus->packetCounter);
 		debug(2, "  Destination: 0x%02X  Length: %d bytes\n", packet->destination, packet->length);
 		debug(2, "  Raw data: ");
 		debugBuffer(2, outputBuffer, outputIndex);
@@ -854,14 +960,20 @@ JVSStatus writePacket(JVSPacket *packet)
 	int written = 0, timeout = 0;
 	while (written < outputIndex)
 	{
-		if (written != 0)
-			timeout = 0;
-
 		if (timeout > JVS_RETRY_COUNT)
 			return JVS_STATUS_ERROR_WRITE_FAIL;
 
-		written += writeBytes(outputBuffer + written, outputIndex - written);
-		timeout++;
+		/* Only count attempts that made no progress, a socket peer may have gone away */
+		int bytesWritten = writeBytes(&bus->device, outputBuffer + written, outputIndex - written);
+		if (bytesWritten > 0)
+		{
+			written += bytesWritten;
+			timeout = 0;
+		}
+		else
+		{
+			timeout++;
+		}
 	}
 
 	return JVS_STATUS_SUCCESS;
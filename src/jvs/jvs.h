@@ -14,6 +14,10 @@
 
 #include "jvs/io.h"
 #include "console/config.h"
+#include "hardware/device.h"
+#include "output/output.h"
+#include "output/display.h"
+#include "ffb/ffb.h"
 
 #define JVS_RETRY_COUNT 3
 #define JVS_MAX_PACKET_SIZE 255
@@ -63,7 +67,7 @@
 #define CMD_WRITE_DISPLAY 0x34    // write to an alphanumeric display
 #define CMD_WRITE_COINS 0x35      // add to coins
 #define CMD_REMAINING_PAYOUT 0x2E // read remaining payout
-#define CMD_SET_PAYOUT 0x31       // write remaining payout
+#define CMD_SET_PAYOUT 0x31       // add to remaining payout
 #define CMD_SUBTRACT_PAYOUT 0x36  // subtract from remaining payout
 #define CMD_WRITE_GPO_BYTE 0x37   // write single gpo byte
 #define CMD_WRITE_GPO_BIT 0x38    // write single gpo bit
@@ -109,13 +113,28 @@ typedef enum
     JVS_STATUS_ERROR_UNSUPPORTED_COMMAND,
 } JVSStatus;
 
-int initJVS(JVSIO *jvsIO);
-
-int disconnectJVS(void);
-
-JVSStatus processPacket(JVSIO *jvsIO);
-
-JVSStatus readPacket(JVSPacket *packet);
-JVSStatus writePacket(JVSPacket *packet);
+/* Everything needed to serve a single JVS bus, one per RS485 connection */
+typedef struct
+{
+    JVSDevice device;
+    JVSIO *io;
+    OutputQueue *outputQueue;
+    FFBState *ffb;
+    DisplayState *display[OUTPUT_MAX_BOARDS];
+    JVSPacket inputPacket;
+    JVSPacket outputPacket;
+    unsigned char inputBuffer[JVS_MAX_PACKET_SIZE];
+    unsigned char outputBuffer[JVS_MAX_PACKET_SIZE * 2 + 2];
+    unsigned long packetCounter;
+} JVSBus;
+
+int initJVS(JVSBus *bus, JVSIO *jvsIO);
+
+int disconnectJVS(JVSBus *bus);
+
+JVSStatus processPacket(JVSBus *bus);
+
+JVSStatus readPacket(JVSBus *bus, JVSPacket *packet);
+JVSStatus writePacket(JVSBus *bus, JVSPacket *packet);
 
 #endif // JVS_H_
@@ -0,0 +1,437 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <poll.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+
+#include "jvs/persist.h"
+#include "console/config.h"
+#include "console/debug.h"
+#include "controller/threading.h"
+
+#define PERSIST_MAGIC 0x4E494F43 // "COIN" in memory
+#define PERSIST_VERSION 2
+
+/* The header and each record get a page of their own, so a record can be synced without the other */
+#define PERSIST_PAGE_SIZE 4096
+#define PERSIST_RECORDS 2
+#define PERSIST_FILE_SIZE (PERSIST_PAGE_SIZE * (1 + PERSIST_RECORDS))
+
+typedef struct
+{
+	unsigned int magic;
+	unsigned int version;
+} PersistHeader;
+
+/*
+ * The board state is journaled across two records. The next state is
+ * written to the older record and only counts once its checksum is
+ * in place, so losing power part way through a write leaves the
+ * other record to load from. Along with the coins it holds what each
+ * hopper still owes, and how many tokens it has paid out in total for
+ * the operator's audit.
+ */
+typedef struct
+{
+	unsigned int generation;
+	unsigned int checksum;
+	unsigned int coins[PERSIST_MAX_BUSES][PERSIST_MAX_BOARDS][PERSIST_MAX_COINS];
+	unsigned int payout[PERSIST_MAX_BUSES][PERSIST_MAX_BOARDS][JVS_MAX_HOPPERS];
+	unsigned int paid[PERSIST_MAX_BUSES][PERSIST_MAX_BOARDS][JVS_MAX_HOPPERS];
+} PersistRecord;
+
+static struct
+{
+	unsigned char *file;
+	int latest;
+	JVSIO *attached[PERSIST_MAX_BUSES][PERSIST_MAX_BOARDS];
+	unsigned int paid[PERSIST_MAX_BUSES][PERSIST_MAX_BOARDS][JVS_MAX_HOPPERS];
+	int dirty;
+	int wakeIO;
+	int hopperIO;
+	int hopperArmed;
+	int hopperRate;
+} persistData = {.wakeIO = -1, .hopperIO = -1};
+
+static PersistRecord *getRecord(int index)
+{
+	return (PersistRecord *)(persistData.file + PERSIST_PAGE_SIZE * (1 + index));
+}
+
+/* FNV-1a over everything but the checksum */
+static unsigned int checksumRecord(const PersistRecord *record)
+{
+	const unsigned char *bytes = (const unsigned char *)record;
+	unsigned int hash = 2166136261u;
+
+	for (size_t i = 0; i < sizeof(PersistRecord); i++)
+	{
+		if (i >= offsetof(PersistRecord, checksum) && i < offsetof(PersistRecord, coins))
+			continue;
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+
+	return hash;
+}
+
+static int validRecord(const PersistRecord *record)
+{
+	return record->generation != 0 && record->checksum == checksumRecord(record);
+}
+
+/* Sync a record's page, rounded out to the system's pages which may be larger */
+static void syncRecord(PersistRecord *record)
+{
+	uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+	uintptr_t start = (uintptr_t)record & ~(pageSize - 1);
+	uintptr_t end = ((uintptr_t)record + sizeof(PersistRecord) + pageSize - 1) & ~(pageSize - 1);
+
+	if (msync((void *)start, end - start, MS_SYNC) < 0)
+		debug(1, "Warning: Failed to sync the board state\n");
+}
+
+/* Map the file and pick the latest good record, or start it again if there is none */
+static PersistStatus openStore(const char *path)
+{
+	char directory[MAX_PATH_LENGTH];
+	strncpy(directory, path, MAX_PATH_LENGTH - 1);
+	directory[MAX_PATH_LENGTH - 1] = '\0';
+	if (mkdir(dirname(directory), 0755) < 0 && errno != EEXIST)
+		debug(1, "Warning: Could not create the directory for %s\n", path);
+
+	int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd < 0)
+	{
+		debug(0, "Warning: Could not open %s, coins will not be kept\n", path);
+		return PERSIST_STATUS_ERROR;
+	}
+
+	if (ftruncate(fd, PERSIST_FILE_SIZE) < 0 ||
+		(persistData.file = mmap(NULL, PERSIST_FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+	{
+		debug(0, "Warning: Could not map %s, coins will not be kept\n", path);
+		persistData.file = NULL;
+		close(fd);
+		return PERSIST_STATUS_ERROR;
+	}
+	close(fd);
+
+	PersistHeader *header = (PersistHeader *)persistData.file;
+	int valid[PERSIST_RECORDS] = {validRecord(getRecord(0)), validRecord(getRecord(1))};
+
+	if (header->magic != PERSIST_MAGIC || header->version != PERSIST_VERSION || (!valid[0] && !valid[1]))
+	{
+		if (header->magic == PERSIST_MAGIC)
+			debug(0, "Warning: The board state in %s could not be read, starting again\n", path);
+
+		memset(persistData.file, 0, PERSIST_FILE_SIZE);
+		header->magic = PERSIST_MAGIC;
+		header->version = PERSIST_VERSION;
+
+		PersistRecord *record = getRecord(0);
+		record->generation = 1;
+		record->checksum = checksumRecord(record);
+
+		if (msync(persistData.file, PERSIST_FILE_SIZE, MS_SYNC) < 0)
+			debug(1, "Warning: Failed to sync the board state\n");
+
+		persistData.latest = 0;
+		return PERSIST_STATUS_SUCCESS;
+	}
+
+	/* The generation wraps, so the newer of two good records is the one a little ahead */
+	if (valid[0] && valid[1])
+		persistData.latest = (int)(getRecord(1)->generation - getRecord(0)->generation) > 0;
+	else
+		persistData.latest = valid[1];
+
+	memcpy(persistData.paid, getRecord(persistData.latest)->paid, sizeof(persistData.paid));
+
+	debug(1, "Debug: Keeping coins in %s\n", path);
+	return PERSIST_STATUS_SUCCESS;
+}
+
+/**
+ * Open the file the board state is kept in
+ *
+ * The file is mapped and the latest good record of the state is
+ * picked, to be handed back to each board as it is attached. A new
+ * file is made if there isn't one or it can't be read. Hoppers are
+ * still paid out without the file, they just aren't kept.
+ *
+ * @param path The path of the file to keep the board state in
+ * @param hopperRate How many tokens a hopper pays out a second
+ * @returns PERSIST_STATUS_SUCCESS if the board state will be kept
+ */
+PersistStatus initPersist(const char *path, int hopperRate)
+{
+	persistData.hopperRate = hopperRate > 0 ? hopperRate : 1;
+
+	if ((persistData.wakeIO = eventfd(0, EFD_CLOEXEC)) < 0 ||
+		(persistData.hopperIO = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0)
+	{
+		closePersist();
+		return PERSIST_STATUS_ERROR;
+	}
+
+	return openStore(path);
+}
+
+/**
+ * Keep the state of a board
+ *
+ * The kept coins and payouts are put back into the board, which must
+ * have just been initialised, and it is followed from then on. Boards
+ * may only be attached while the threads are stopped.
+ *
+ * @param bus The bus index
+ * @param board The board on the bus, 0 for the first IO
+ * @param io The board, or NULL if there isn't one any more
+ */
+void attachBoard(int bus, int board, JVSIO *io)
+{
+	if (bus < 0 || bus >= PERSIST_MAX_BUSES || board < 0 || board >= PERSIST_MAX_BOARDS)
+		return;
+
+	persistData.attached[bus][board] = io;
+	if (!io || !persistData.file)
+		return;
+
+	PersistRecord *record = getRecord(persistData.latest);
+	for (int slot = 0; slot < io->capabilities.coins && slot < PERSIST_MAX_COINS; slot++)
+		io->state.coinCount[slot] = record->coins[bus][board][slot];
+	for (int hopper = 0; hopper < JVS_MAX_HOPPERS; hopper++)
+		setPayout(io, hopper, record->payout[bus][board][hopper]);
+}
+
+/* Called whenever a coin count changes, only the first change of a batch wakes the writer */
+void markCoinsChanged(void)
+{
+	if (persistData.wakeIO < 0 || __atomic_exchange_n(&persistData.dirty, 1, __ATOMIC_ACQ_REL))
+		return;
+
+	uint64_t counter = 1;
+	if (write(persistData.wakeIO, &counter, sizeof(counter)) != sizeof(counter))
+		debug(1, "Warning: Failed to wake the coin writer\n");
+}
+
+/* Called when the game sets a payout, so the hoppers start paying it out */
+void markPayoutChanged(void)
+{
+	__atomic_store_n(&persistData.dirty, 1, __ATOMIC_RELEASE);
+	wakePersist();
+}
+
+/**
+ * Write the board state out if it has changed
+ *
+ * Only one thread may flush at a time, which is the coin writer while
+ * the threads are running.
+ */
+void flushPersist(void)
+{
+	if (!persistData.file)
+		return;
+
+	__atomic_store_n(&persistData.dirty, 0, __ATOMIC_RELEASE);
+
+	PersistRecord *latest = getRecord(persistData.latest);
+	PersistRecord *next = getRecord(!persistData.latest);
+	PersistRecord state;
+
+	/* Boards that aren't attached keep what they had */
+	memcpy(&state, latest, sizeof(state));
+	memcpy(state.paid, persistData.paid, sizeof(state.paid));
+	for (int bus = 0; bus < PERSIST_MAX_BUSES; bus++)
+	{
+		for (int board = 0; board < PERSIST_MAX_BOARDS; board++)
+		{
+			JVSIO *io = persistData.attached[bus][board];
+			if (!io)
+				continue;
+
+			for (int slot = 0; slot < io->capabilities.coins && slot < PERSIST_MAX_COINS; slot++)
+				state.coins[bus][board][slot] = __atomic_load_n(&io->state.coinCount[slot], __ATOMIC_RELAXED);
+			for (int hopper = 0; hopper < JVS_MAX_HOPPERS; hopper++)
+				state.payout[bus][board][hopper] = getPayout(io, hopper);
+		}
+	}
+
+	size_t offset = offsetof(PersistRecord, coins);
+	if (memcmp((unsigned char *)&state + offset, (unsigned char *)latest + offset, sizeof(state) - offset) == 0)
+		return;
+
+	memcpy((unsigned char *)next + offset, (unsigned char *)&state + offset, sizeof(state) - offset);
+	next->generation = latest->generation + 1 ? latest->generation + 1 : 1;
+	next->checksum = checksumRecord(next);
+	syncRecord(next);
+
+	persistData.latest = !persistData.latest;
+}
+
+/* Start or stop paying out, the timer fires once for every token */
+static void armHopperTimer(int arm)
+{
+	struct itimerspec interval = {0};
+	if (arm)
+	{
+		long period = 1000000000L / persistData.hopperRate;
+		interval.it_value.tv_sec = period / 1000000000L;
+		interval.it_value.tv_nsec = period % 1000000000L;
+		interval.it_interval = interval.it_value;
+	}
+
+	timerfd_settime(persistData.hopperIO, 0, &interval, NULL);
+	persistData.hopperArmed = arm;
+}
+
+static int hoppersOwed(void)
+{
+	for (int bus = 0; bus < PERSIST_MAX_BUSES; bus++)
+	{
+		for (int board = 0; board < PERSIST_MAX_BOARDS; board++)
+		{
+			JVSIO *io = persistData.attached[bus][board];
+			for (int hopper = 0; io && hopper < JVS_MAX_HOPPERS; hopper++)
+			{
+				if (getPayout(io, hopper))
+					return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* Pay a token out of every hopper that is owed one for each time the timer fired */
+static void dispenseHoppers(uint64_t ticks)
+{
+	for (int bus = 0; bus < PERSIST_MAX_BUSES; bus++)
+	{
+		for (int board = 0; board < PERSIST_MAX_BOARDS; board++)
+		{
+			JVSIO *io = persistData.attached[bus][board];
+			for (int hopper = 0; io && hopper < JVS_MAX_HOPPERS; hopper++)
+			{
+				for (uint64_t tick = 0; tick < ticks && dispensePayout(io, hopper); tick++)
+				{
+					persistData.paid[bus][board][hopper]++;
+					debug(1, "Debug: Hopper %d of board %d on bus %d paid out a token, %u paid in total and %u left\n",
+						  hopper + 1, board, bus, persistData.paid[bus][board][hopper], getPayout(io, hopper));
+				}
+			}
+		}
+	}
+
+	if (!hoppersOwed())
+		armHopperTimer(0);
+}
+
+static void *persistThread(void *_args)
+{
+	(void)_args;
+	uint64_t counter;
+	struct pollfd events[] = {
+		{.fd = persistData.wakeIO, .events = POLLIN},
+		{.fd = persistData.hopperIO, .events = POLLIN},
+	};
+
+	/* Payouts left owing before a reinit or restart carry on */
+	if (hoppersOwed())
+		armHopperTimer(1);
+
+	while (getThreadsRunning())
+	{
+		if (poll(events, 2, -1) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		if ((events[1].revents & POLLIN) && read(persistData.hopperIO, &counter, sizeof(counter)) == sizeof(counter))
+			dispenseHoppers(counter);
+
+		if (events[0].revents & POLLIN)
+		{
+			if (read(persistData.wakeIO, &counter, sizeof(counter)) != sizeof(counter) && errno != EINTR)
+				break;
+
+			if (!persistData.hopperArmed && hoppersOwed())
+				armHopperTimer(1);
+
+			/* Give the rest of a burst of coins a moment to arrive, stopping wakes this early */
+			if (getThreadsRunning() && poll(events, 1, PERSIST_FLUSH_DELAY) < 0 && errno != EINTR)
+				break;
+		}
+
+		flushPersist();
+	}
+
+	armHopperTimer(0);
+	return 0;
+}
+
+/* Hoppers pay out even when there is no file to keep them in */
+static int hoppersAttached(void)
+{
+	for (int bus = 0; bus < PERSIST_MAX_BUSES; bus++)
+	{
+		for (int board = 0; board < PERSIST_MAX_BOARDS; board++)
+		{
+			if (persistData.attached[bus][board] && persistData.attached[bus][board]->capabilities.hopper)
+				return 1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Start the coin writer, which also pays out the hoppers
+ *
+ * The writer is managed by the thread manager, so it is started again
+ * every time the inputs are reinitialised. Whatever changed while it
+ * was stopping is written by flushPersist once the threads have stopped.
+ *
+ * @returns PERSIST_STATUS_SUCCESS if the writer is running or isn't needed
+ */
+PersistStatus startPersist(void)
+{
+	if (persistData.wakeIO < 0 || (!persistData.file && !hoppersAttached()))
+		return PERSIST_STATUS_SUCCESS;
+
+	if (createThread(persistThread, NULL) != THREAD_STATUS_SUCCESS)
+		return PERSIST_STATUS_ERROR;
+
+	return PERSIST_STATUS_SUCCESS;
+}
+
+void wakePersist(void)
+{
+	uint64_t counter = 1;
+	if (persistData.wakeIO >= 0 && write(persistData.wakeIO, &counter, sizeof(counter)) != sizeof(counter))
+		debug(1, "Warning: Failed to wake the coin writer\n");
+}
+
+void closePersist(void)
+{
+	if (persistData.file)
+		munmap(persistData.file, PERSIST_FILE_SIZE);
+	persistData.file = NULL;
+
+	int *fds[] = {&persistData.hopperIO, &persistData.wakeIO};
+	for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++)
+	{
+		if (*fds[i] >= 0)
+			close(*fds[i]);
+		*fds[i] = -1;
+	}
+}
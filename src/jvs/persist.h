@@ -0,0 +1,28 @@
+#ifndef PERSIST_H_
+#define PERSIST_H_
+
+#include "jvs/io.h"
+
+#define PERSIST_MAX_BUSES 4
+#define PERSIST_MAX_BOARDS 4
+#define PERSIST_MAX_COINS 16
+
+/* How long to let a burst of coins settle before they are written out together */
+#define PERSIST_FLUSH_DELAY 100
+
+typedef enum
+{
+    PERSIST_STATUS_SUCCESS,
+    PERSIST_STATUS_ERROR
+} PersistStatus;
+
+PersistStatus initPersist(const char *path, int hopperRate);
+void attachBoard(int bus, int board, JVSIO *io);
+void markCoinsChanged(void);
+void markPayoutChanged(void);
+PersistStatus startPersist(void);
+void wakePersist(void);
+void flushPersist(void);
+void closePersist(void);
+
+#endif // PERSIST_H_
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <fcntl.h>
 #include <signal.h>
 #include <string.h>
 #include <unistd.h>
@@ -13,7 +14,9 @@
 #include "hardware/rotary.h"
 #include "jvs/io.h"
 #include "jvs/jvs.h"
+#include "jvs/persist.h"
 #include "ffb/ffb.h"
+#include "output/output.h"
 #include "version.h"
 
 /* Time between reinit in ms */
@@ -21,9 +24,296 @@
 
 void cleanup(void);
 void handleSignal(int signal);
+static int closeBuses(int status);
 
 volatile int running = 1;
 
+/* One bus per RS485 connection, the first is served from the main thread */
+static JVSBus buses[MAX_JVS_BUSES];
+static int busCount = 0;
+
+/* Force feedback for the buses with an FFB_DEVICE, found through buses[i].ffb while the device is bound */
+static FFBState ffb[MAX_JVS_BUSES];
+static int ffbOpen[MAX_JVS_BUSES];
+
+/* Character displays of the boards that advertise one, found through buses[i].display */
+static DisplayState displays[MAX_JVS_BUSES][OUTPUT_MAX_BOARDS];
+
+/* Wake every responder blocked waiting on its bus so it can check running */
+static void wakeBuses(void)
+{
+    for (int i = 0; i < busCount; i++)
+        wakeDevice(&buses[i].device);
+}
+
+static void wakeFFBs(void)
+{
+    for (int i = 0; i < busCount; i++)
+    {
+        if (buses[i].ffb)
+            wakeFFB(buses[i].ffb);
+    }
+}
+
+/**
+ * Setup force feedback for a single bus
+ *
+ * Opens the drive board, or takes the effects for the analogue outputs
+ * of the bus's first IO without one. The FFB_DEVICE is bound separately
+ * each time the inputs are initialised, as it may come and go.
+ *
+ * @param busConfig The config for the bus
+ * @param state The force feedback state to use for the bus
+ * @returns 1 if the bus has force feedback, 0 otherwise
+ */
+static int initBusFFB(JVSBusConfig *busConfig, FFBState *state)
+{
+    int driveBoard = busConfig->ffbDriveBoard != FFB_EMULATION_TYPE_ANALOGUE && busConfig->ffbDriveBoardPath[0] != 0x00;
+
+    if (busConfig->ffbDevicePath[0] == 0x00)
+    {
+        if (driveBoard)
+            debug(0, "Warning: The drive board at %s needs an FFB_DEVICE to play on\n", busConfig->ffbDriveBoardPath);
+        return 0;
+    }
+
+    if (driveBoard)
+    {
+        if (initFFB(state, busConfig->ffbDriveBoard, busConfig->ffbDriveBoardPath) != FFB_STATUS_SUCCESS)
+            return 0;
+    }
+    else
+    {
+        if (initFFB(state, FFB_EMULATION_TYPE_ANALOGUE, NULL) != FFB_STATUS_SUCCESS)
+            return 0;
+        memcpy(state->wantedEffects, busConfig->ffbChannels, sizeof(state->wantedEffects));
+    }
+
+    return 1;
+}
+
+/**
+ * Open the FFB_DEVICE of a bus and upload its effects
+ *
+ * @param busConfig The config for the bus
+ * @param state The force feedback state of the bus
+ * @returns 1 if the device is bound, 0 otherwise
+ */
+static int bindBusFFB(JVSBusConfig *busConfig, FFBState *state)
+{
+    int controller = open(busConfig->ffbDevicePath, O_RDWR | O_CLOEXEC);
+    if (controller < 0)
+    {
+        debug(0, "Error: Could not open the force feedback device %s\n", busConfig->ffbDevicePath);
+        return 0;
+    }
+
+    if (bindController(state, controller) != FFB_STATUS_SUCCESS)
+    {
+        close(controller);
+        return 0;
+    }
+
+    debug(1, "Debug: Sending force feedback to %s\n", busConfig->ffbDevicePath);
+    return 1;
+}
+
+/* Publish the character display of each board on the bus that has one */
+static void initBusDisplays(int busIndex, JVSBus *bus)
+{
+    memset(bus->display, 0, sizeof(bus->display));
+
+    int board = 0;
+    for (JVSIO *io = bus->io; io != NULL && board < OUTPUT_MAX_BOARDS; io = io->chainedIO, board++)
+    {
+        JVSCapabilities *capabilities = &io->capabilities;
+        DisplayState *display = &displays[busIndex][board];
+
+        if (!capabilities->displayOutRows || !capabilities->displayOutColumns)
+        {
+            closeDisplay(display);
+            continue;
+        }
+
+        if (initDisplay(display, busIndex, board, capabilities->displayOutRows, capabilities->displayOutColumns, capabilities->displayOutEncodings) == DISPLAY_STATUS_SUCCESS)
+            bus->display[board] = display;
+    }
+}
+
+/* Put back the coins and payouts kept for each board on the bus, initIO has just cleared them */
+static void attachBusBoards(int busIndex, JVSBus *bus)
+{
+    JVSIO *io = bus->io;
+    for (int board = 0; board < PERSIST_MAX_BOARDS; board++)
+    {
+        attachBoard(busIndex, board, io);
+        if (io)
+            io = io->chainedIO;
+    }
+}
+
+static void reportProcessingStatus(JVSStatus processingStatus)
+{
+    switch (processingStatus)
+    {
+    case JVS_STATUS_ERROR_CHECKSUM:
+        debug(0, "Error: A checksum error occurred\n");
+        break;
+    case JVS_STATUS_ERROR_WRITE_FAIL:
+        debug(0, "Error: A write failure occurred\n");
+        break;
+    case JVS_STATUS_ERROR:
+        debug(0, "Error: A generic error occurred\n");
+        break;
+    default:
+        break;
+    }
+}
+
+/* Responder thread for every bus other than the first */
+static void *busThread(void *_args)
+{
+    JVSBus *bus = (JVSBus *)_args;
+
+    while (running == 1 && getThreadsRunning())
+        reportProcessingStatus(processPacket(bus));
+
+    return 0;
+}
+
+/**
+ * Initialise the inputs for a single bus
+ *
+ * Devices listed with BUS_INPUT are only given to their own bus,
+ * and the first bus takes every device that no other bus has claimed.
+ *
+ * @param config The full config
+ * @param busIndex The bus to start the inputs for
+ * @param io The IO the inputs will be sent to
+ * @returns The status of the operation
+ */
+static JVSInputStatus initBusInputs(JVSConfig *config, int busIndex, JVSIO *io)
+{
+    JVSBusConfig *busConfig = &config->buses[busIndex];
+    DeviceFilter filter = {0};
+
+    for (int i = 0; i < busConfig->inputDeviceCount && filter.includeLength < MAX_DEVICE_FILTER; i++)
+        filter.include[filter.includeLength++] = busConfig->inputDevices[i];
+
+    for (int other = 0; other < config->busCount; other++)
+    {
+        if (other == busIndex)
+            continue;
+        for (int i = 0; i < config->buses[other].inputDeviceCount && filter.excludeLength < MAX_DEVICE_FILTER; i++)
+            filter.exclude[filter.excludeLength++] = config->buses[other].inputDevices[i];
+    }
+
+    /* Buses other than the first must say which devices they want, main warns about it once */
+    if (busIndex > 0 && filter.includeLength == 0)
+        return JVS_INPUT_STATUS_SUCCESS;
+
+    return initInputs(busConfig->defaultGamePath, busConfig->capabilitiesPath, busConfig->secondCapabilitiesPath, io, config->autoControllerDetection, config->analogDeadzonePlayer1, config->analogDeadzonePlayer2, config->analogDeadzonePlayer3, config->analogDeadzonePlayer4, &filter, &config->gunFilter, busIndex);
+}
+
+/**
+ * Setup the emulated IO boards for a single bus
+ *
+ * Parses the IO definitions, chaining the second IO if one is set,
+ * and attaches them to the bus.
+ *
+ * @param busConfig The config for the bus
+ * @param bus The bus to attach the IO to
+ * @param io The first IO on the bus
+ * @param secondIO Storage for the chained IO if one is used
+ * @returns 1 on success, 0 on a critical failure
+ */
+static int initBusIO(JVSBusConfig *busConfig, JVSBus *bus, JVSIO *io, JVSIO *secondIO)
+{
+    debug(1, "Parse IO\n");
+    JVSConfigStatus ioStatus = parseIO(busConfig->capabilitiesPath, &io->capabilities);
+    if (ioStatus != JVS_CONFIG_STATUS_SUCCESS)
+    {
+        switch (ioStatus)
+        {
+        case JVS_CONFIG_STATUS_FILE_NOT_FOUND:
+            debug(0, "Critical: Could not find IO definition named %s\n", busConfig->capabilitiesPath);
+            break;
+        default:
+            debug(0, "Critical: Failed to parse an IO file.\n");
+        }
+        return 0;
+    }
+
+    debug(1, "ABOUT TO PARSE Second IO\n");
+
+    if (busConfig->secondCapabilitiesPath[0] != 0x00)
+    {
+        debug(1, "Parse Second IO\n");
+        secondIO->deviceID = -1;
+        ioStatus = parseIO(busConfig->secondCapabilitiesPath, &secondIO->capabilities);
+        if (ioStatus != JVS_CONFIG_STATUS_SUCCESS)
+        {
+            switch (ioStatus)
+            {
+            case JVS_CONFIG_STATUS_FILE_NOT_FOUND:
+                debug(0, "Critical: Could not find IO definition named %s\n", busConfig->secondCapabilitiesPath);
+                break;
+            default:
+                debug(0, "Critical: Failed to parse an IO file.\n");
+            }
+            return 0;
+        }
+        io->chainedIO = secondIO;
+    }
+
+    /* Init the Virtual IO */
+    debug(1, "Init IO\n");
+    if (!initIO(io))
+    {
+        debug(0, "Critical: Failed to init IO\n");
+        return 0;
+    }
+
+    if (io->chainedIO != NULL)
+    {
+        debug(1, "Init Second IO\n");
+        if (!initIO(io->chainedIO))
+        {
+            debug(0, "Critical: Failed to init second IO\n");
+            return 0;
+        }
+    }
+
+    for (JVSIO *chained = io; chained != NULL; chained = chained->chainedIO)
+        initSwitchDebounce(&chained->debounce, busConfig->switchDebounce);
+
+    for (int i = 0; i < busConfig->turboCount; i++)
+    {
+        TurboConfig *turbo = &busConfig->turbo[i];
+        JVSIO *turboIO = turbo->secondaryIO && io->chainedIO != NULL ? io->chainedIO : io;
+        if (!setTurbo(turboIO, turbo->player, turbo->input, turbo->rate))
+            debug(0, "Warning: Turbo switch %d is not a switch on the IO\n", i + 1);
+    }
+
+    /* Setup the JVS Emulator with the RS485 path and capabilities */
+    debug(1, "Init JVS\n");
+    if (!initJVS(bus, io))
+    {
+        debug(0, "Critical: Could not initialise JVS\n");
+        return 0;
+    }
+
+    /* Print out what is being emulated */
+    debug(0, "\nYou are currently emulating a \033[0;31m%s\033[0m ", io->capabilities.displayName);
+    if (io->chainedIO != NULL)
+    {
+        debug(0, "chained to a \033[0;31m%s\033[0m ", io->chainedIO->capabilities.displayName);
+    }
+    printf("on %s.\n\n", busConfig->devicePath);
+
+    return 1;
+}
+
 int main(int argc, char **argv)
 {
     signal(SIGINT, handleSignal);
@@ -40,7 +330,7 @@ int main(int argc, char **argv)
     initDebug(config.debugLevel);
 
     /* Get the correct game output mapping */
-    JVSCLIStatus argumentsStatus = parseArguments(argc, argv, config.defaultGamePath);
+    JVSCLIStatus argumentsStatus = parseArguments(argc, argv, config.buses[0].defaultGamePath);
     switch (argumentsStatus)
     {
     case JVS_CLI_STATUS_ERROR:
@@ -65,17 +355,36 @@ int main(int argc, char **argv)
         return EXIT_FAILURE;
     }
 
-    /* Init the connection to the Naomi */
-    if (!initDevice(config.devicePath, config.senseLineType, config.senseLinePin))
+    /* Init the connection to the Naomi, one per bus */
+    for (int i = 0; i < config.busCount; i++)
     {
-        debug(0, "Critical: Failed to init the RS485 device at %s, you must be root.\n", config.devicePath);
-        return EXIT_FAILURE;
+        JVSBusConfig *busConfig = &config.buses[i];
+        if (!initDevice(&buses[i].device, busConfig->devicePath, busConfig->senseLineType, busConfig->senseLinePin,
+                        busConfig->lowLatency, busConfig->latencyProbe))
+        {
+            debug(0, "Critical: Failed to init the RS485 device at %s, you must be root.\n", busConfig->devicePath);
+            return closeBuses(EXIT_FAILURE);
+        }
+        busCount = i + 1;
+
+        if (i > 0 && busConfig->inputDeviceCount == 0)
+            debug(0, "Warning: Bus %d has no BUS_INPUT devices set, it will have no inputs\n", i + 1);
     }
 
+    /* Coins and payouts survive reinits and restarts, a failure here only means they won't */
+    initPersist(config.coinStorePath, config.hopperRate);
+
+    /* Open the output sinks, buses without any don't queue their outputs */
+    if (initOutput(&config) != OUTPUT_STATUS_SUCCESS)
+        debug(0, "Error: Could not initialise the outputs\n");
+
+    for (int i = 0; i < busCount; i++)
+        ffbOpen[i] = initBusFFB(&config.buses[i], &ffb[i]);
+
     /* Init the rotary status*/
     JVSRotaryStatus rotaryStatus = JVS_ROTARY_STATUS_UNUSED;
     int rotaryValue = -1;
-    if (strcmp(config.defaultGamePath, "rotary") == 0 || strcmp(config.defaultGamePath, "ROTARY") == 0)
+    if (strcmp(config.buses[0].defaultGamePath, "rotary") == 0 || strcmp(config.buses[0].defaultGamePath, "ROTARY") == 0)
     {
         rotaryStatus = initRotary();
     }
@@ -88,21 +397,31 @@ int main(int argc, char **argv)
         debug(1, "Init watchdog\n");
         running = 1;
         setThreadsRunning(1);
-        initWatchdog(&running, rotaryStatus);
+        initWatchdog(&running, rotaryStatus, wakeBuses);
 
         if (rotaryStatus == JVS_ROTARY_STATUS_SUCCESS)
         {
             rotaryValue = getRotaryValue();
-            parseRotary(DEFAULT_ROTARY_PATH, rotaryValue, config.defaultGamePath);
+            parseRotary(DEFAULT_ROTARY_PATH, rotaryValue, config.buses[0].defaultGamePath);
         }
 
-        // Create the JVSIO
-        JVSIO io = {0};
-        io.deviceID = -1;
-        io.chainedIO = NULL;
+        // Create the JVSIO for every bus
+        JVSIO io[MAX_JVS_BUSES] = {0};
+        JVSIO secondIO[MAX_JVS_BUSES] = {0};
+        for (int i = 0; i < config.busCount; i++)
+        {
+            io[i].deviceID = -1;
+            io[i].chainedIO = NULL;
+        }
 
         debug(1, "Init inputs\n");
-        JVSInputStatus inputStatus = initInputs(config.defaultGamePath, config.capabilitiesPath, config.secondCapabilitiesPath, &io, config.autoControllerDetection, config.analogDeadzonePlayer1, config.analogDeadzonePlayer2, config.analogDeadzonePlayer3, config.analogDeadzonePlayer4);
+        JVSInputStatus inputStatus = JVS_INPUT_STATUS_SUCCESS;
+        for (int i = 0; i < config.busCount && inputStatus == JVS_INPUT_STATUS_SUCCESS; i++)
+        {
+            if (config.busCount > 1)
+                debug(0, "  Bus %d:\t\t%s\n", i + 1, config.buses[i].devicePath);
+            inputStatus = initBusInputs(&config, i, &io[i]);
+        }
 
         // Only report these errors if the status has changed
         // from the last run. Since we restart this thread every 200ms
@@ -145,102 +464,53 @@ int main(int argc, char **argv)
             debug(0, "  Rotary Position:\t%d\n", rotaryValue);
         }
 
-        debug(0, "  Output:\t\t%s\n", config.defaultGamePath);
-
-        debug(1, "Parse IO\n");
-        JVSConfigStatus ioStatus = parseIO(config.capabilitiesPath, &io.capabilities);
-        if (ioStatus != JVS_CONFIG_STATUS_SUCCESS)
+        for (int i = 0; i < config.busCount; i++)
         {
-            switch (ioStatus)
+            debug(0, "  Output:\t\t%s\n", config.buses[i].defaultGamePath);
+
+            if (!initBusIO(&config.buses[i], &buses[i], &io[i], &secondIO[i]))
             {
-            case JVS_CONFIG_STATUS_FILE_NOT_FOUND:
-                debug(0, "Critical: Could not find IO definition named %s\n", config.capabilitiesPath);
-                break;
-            default:
-                debug(0, "Critical: Failed to parse an IO file.\n");
+                running = -1;
+                cleanup();
+                return closeBuses(EXIT_FAILURE);
             }
-            return EXIT_FAILURE;
+
+            initBusDisplays(i, &buses[i]);
+            attachBusBoards(i, &buses[i]);
+            startGPIOInputs(&io[i], config.buses[i].gpioInputs, config.buses[i].gpioInputCount);
         }
 
-        debug(1, "ABOUT TO PARSE Second IO\n");
+        /* The controllers found for the game may have added rumble outputs to a bus */
+        for (int i = 0; i < busCount; i++)
+            buses[i].outputQueue = getOutputQueue(i);
 
-        if (config.secondCapabilitiesPath[0] != 0x00)
-        {
-            debug(1, "Parse Second IO\n");
-            JVSIO secondIO = {0};
-            secondIO.deviceID = -1;
-            ioStatus = parseIO(config.secondCapabilitiesPath, &secondIO.capabilities);
-            if (ioStatus != JVS_CONFIG_STATUS_SUCCESS)
-            {
-                switch (ioStatus)
-                {
-                case JVS_CONFIG_STATUS_FILE_NOT_FOUND:
-                    debug(0, "Critical: Could not find IO definition named %s\n", config.secondCapabilitiesPath);
-                    break;
-                default:
-                    debug(0, "Critical: Failed to parse an IO file.\n");
-                }
-                return EXIT_FAILURE;
-            }
-            else
-            {
-                io.chainedIO = &secondIO;
-            }
-        }
+        /* The force feedback device may have been plugged back in since the last round */
+        for (int i = 0; i < busCount; i++)
+            buses[i].ffb = ffbOpen[i] && bindBusFFB(&config.buses[i], &ffb[i]) ? &ffb[i] : NULL;
 
-        /* Init the Virtual IO */
-        debug(1, "Init IO\n");
-        if (!initIO(&io))
+        /* Every bus other than the first gets its own responder thread */
+        for (int i = 1; i < config.busCount; i++)
         {
-            debug(0, "Critical: Failed to init IO\n");
-            return EXIT_FAILURE;
+            if (createThread(busThread, &buses[i]) != THREAD_STATUS_SUCCESS)
+                debug(0, "Error: Could not start the responder for bus %d\n", i + 1);
         }
 
-        if (io.chainedIO != NULL)
-        {
-            debug(1, "Init Second IO\n");
-            if (!initIO(io.chainedIO))
-            {
-                debug(0, "Critical: Failed to init second IO\n");
-                return EXIT_FAILURE;
-            }
-        }
+        if (startOutput() != OUTPUT_STATUS_SUCCESS)
+            debug(0, "Error: Could not start the output worker\n");
 
-        /* Setup the JVS Emulator with the RS485 path and capabilities */
-        debug(1, "Init JVS\n");
-        if (!initJVS(&io))
-        {
-            debug(0, "Critical: Could not initialise JVS\n");
-            return EXIT_FAILURE;
-        }
+        if (startPersist() != PERSIST_STATUS_SUCCESS)
+            debug(0, "Error: Could not start the coin writer\n");
 
-        /* Print out what is being emulated */
-        debug(0, "\nYou are currently emulating a \033[0;31m%s\033[0m ", io.capabilities.displayName);
-        if (io.chainedIO != NULL)
+        for (int i = 0; i < busCount; i++)
         {
-            debug(0, "chained to a \033[0;31m%s\033[0m ", io.chainedIO->capabilities.displayName);
+            if (buses[i].ffb && startFFB(buses[i].ffb) != FFB_STATUS_SUCCESS)
+                debug(0, "Error: Could not start the force feedback for bus %d\n", i + 1);
         }
-        printf("on %s.\n\n", config.devicePath);
 
         /* Process packets forever */
-        JVSStatus processingStatus;
         while (running == 1)
         {
-            processingStatus = processPacket(&io);
-            switch (processingStatus)
-            {
-            case JVS_STATUS_ERROR_CHECKSUM:
-                debug(0, "Error: A checksum error occurred\n");
-                break;
-            case JVS_STATUS_ERROR_WRITE_FAIL:
-                debug(0, "Error: A write failure occurred\n");
-                break;
-            case JVS_STATUS_ERROR:
-                debug(0, "Error: A generic error occurred\n");
-                break;
-            default:
-                break;
-            }
+            reportProcessingStatus(processPacket(&buses[0]));
         }
 
         lastInputState = inputStatus;
@@ -248,23 +518,71 @@ int main(int argc, char **argv)
         cleanup();
     }
 
-    /* Close the file pointer */
-    if (!disconnectJVS())
+    return closeBuses(EXIT_SUCCESS);
+}
+
+/**
+ * Close everything opened for the buses so far
+ *
+ * Every way out of main once a bus is open comes through here, so the
+ * latency timers and sense lines of all the open buses are put back.
+ *
+ * @param status The exit status to return if everything closes
+ * @returns The exit status for main
+ */
+static int closeBuses(int status)
+{
+    closeOutput();
+    closePersist();
+
+    for (int i = 0; i < busCount; i++)
     {
-        debug(0, "Critical: Could not disconnect from serial\n");
-        return EXIT_FAILURE;
+        if (ffbOpen[i])
+            closeFFB(&ffb[i]);
+        ffbOpen[i] = 0;
+
+        for (int board = 0; board < OUTPUT_MAX_BOARDS; board++)
+            closeDisplay(&displays[i][board]);
+    }
+
+    /* Close the file pointer, one bus failing to close doesn't stop the rest */
+    for (int i = 0; i < busCount; i++)
+    {
+        if (!disconnectJVS(&buses[i]))
+        {
+            debug(0, "Critical: Could not disconnect from serial\n");
+            status = EXIT_FAILURE;
+        }
     }
 
-    return EXIT_SUCCESS;
+    return status;
 }
 
 void cleanup(void)
 {
-    /* Stop threads managed by ThreadManager */
+    /* Stop threads managed by ThreadManager, the responders are woken so they notice */
+    setThreadsRunning(0);
+    wakeBuses();
+    wakeOutput();
+    wakeFFBs();
+    wakePersist();
     stopAllThreads();
 
-    /* Take a short break on reinit to reduce load */
-    usleep(TIME_REINIT);
+    /* The rumble outputs and force feedback device belong to this round's controllers */
+    clearRumbleOutputs();
+    for (int i = 0; i < busCount; i++)
+    {
+        if (buses[i].ffb)
+            unbindController(buses[i].ffb);
+        buses[i].ffb = NULL;
+    }
+
+    /* Write out any coins that came in while the threads were stopping */
+    flushPersist();
+
+    /* Take a short break on reinit to reduce load, there is no need when stopping */
+    if (running != -1)
+        usleep(TIME_REINIT);
 }
 
 void handleSignal(int signal)
@@ -273,5 +591,6 @@ void handleSignal(int signal)
     {
         debug(0, "\nModernJVS is stopping...\n");
         running = -1;
+        wakeBuses();
     }
 }
@@ -0,0 +1,177 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "output/display.h"
+#include "console/debug.h"
+
+/* Encodings from the JVS display capability */
+#define DISPLAY_ENCODING_KATAKANA 3
+#define DISPLAY_ENCODING_SHIFT_JIS 4
+
+/* Control characters the game can position the cursor with */
+#define DISPLAY_LINE_FEED 0x0A
+#define DISPLAY_CLEAR 0x0C
+#define DISPLAY_CARRIAGE_RETURN 0x0D
+
+/* Shown in place of a character the display's encoding can't show */
+#define DISPLAY_UNKNOWN '?'
+
+static int isShiftJIS(unsigned short character)
+{
+    unsigned char lead = character >> 8, trail = character & 0xFF;
+    return ((lead >= 0x81 && lead <= 0x9F) || (lead >= 0xE0 && lead <= 0xEF)) &&
+           trail >= 0x40 && trail <= 0xFC && trail != 0x7F;
+}
+
+/* Reduce a character to one the display can show in its encoding */
+static unsigned short displayCharacter(int encoding, unsigned short character)
+{
+    if (character >= 0x20 && character <= 0x7E)
+        return character;
+
+    if (encoding >= DISPLAY_ENCODING_KATAKANA && character >= 0xA1 && character <= 0xDF)
+        return character;
+
+    if (encoding >= DISPLAY_ENCODING_SHIFT_JIS && isShiftJIS(character))
+        return character;
+
+    return DISPLAY_UNKNOWN;
+}
+
+static void clearDisplay(DisplayBuffer *buffer)
+{
+    for (int i = 0; i < buffer->rows * buffer->columns; i++)
+        buffer->cells[i] = ' ';
+    buffer->cursorRow = 0;
+    buffer->cursorColumn = 0;
+}
+
+/**
+ * Initialise the character display of a board
+ *
+ * The display is published as a POSIX shared memory segment named after
+ * the bus and board. It is kept, along with what is on it, if the board
+ * comes back with the same display after a reinit.
+ *
+ * @param display The display to initialise
+ * @param bus The bus index
+ * @param board The board on the bus, 0 for the first IO
+ * @param rows The rows the board advertises
+ * @param columns The columns the board advertises
+ * @param encoding The character encoding the board advertises
+ * @returns DISPLAY_STATUS_SUCCESS if the display is ready to write to
+ */
+DisplayStatus initDisplay(DisplayState *display, int bus, int board, int rows, int columns, int encoding)
+{
+    DisplayBuffer *buffer = display->buffer;
+    if (buffer && buffer->rows == rows && buffer->columns == columns && buffer->encoding == encoding)
+        return DISPLAY_STATUS_SUCCESS;
+
+    closeDisplay(display);
+
+    if (rows <= 0 || columns <= 0)
+        return DISPLAY_STATUS_ERROR;
+
+    snprintf(display->name, sizeof(display->name), DISPLAY_NAME_FORMAT, bus, board);
+    display->size = sizeof(DisplayBuffer) + (size_t)rows * columns * sizeof(unsigned short);
+
+    int fd = shm_open(display->name, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        debug(0, "Error: Failed to create the display %s\n", display->name);
+        return DISPLAY_STATUS_ERROR;
+    }
+
+    if (ftruncate(fd, display->size) < 0 ||
+        (buffer = mmap(NULL, display->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+    {
+        debug(0, "Error: Failed to map the display %s\n", display->name);
+        close(fd);
+        shm_unlink(display->name);
+        return DISPLAY_STATUS_ERROR;
+    }
+    close(fd);
+
+    /* A reader of a segment left behind should see it change, so the sequence carries on from it */
+    unsigned int sequence = buffer->magic == DISPLAY_MAGIC ? (buffer->sequence | 1) + 1 : 0;
+
+    buffer->magic = DISPLAY_MAGIC;
+    buffer->version = DISPLAY_VERSION;
+    buffer->rows = rows;
+    buffer->columns = columns;
+    buffer->encoding = encoding;
+    clearDisplay(buffer);
+    __atomic_store_n(&buffer->sequence, sequence, __ATOMIC_RELEASE);
+
+    display->buffer = buffer;
+    debug(1, "Debug: Publishing the %dx%d display in %s\n", columns, rows, display->name);
+    return DISPLAY_STATUS_SUCCESS;
+}
+
+/**
+ * Write characters to a display
+ *
+ * Characters are two bytes each, high byte first, and are written at
+ * the cursor which wraps to the next row and back to the top. A clear,
+ * carriage return or line feed moves the cursor instead.
+ *
+ * @param display The display to write to
+ * @param characters The characters from the write display command
+ * @param count How many characters there are
+ */
+void writeDisplay(DisplayState *display, const unsigned char *characters, int count)
+{
+    DisplayBuffer *buffer = display->buffer;
+    if (!buffer || count <= 0)
+        return;
+
+    unsigned int sequence = buffer->sequence;
+    __atomic_store_n(&buffer->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    for (int i = 0; i < count; i++)
+    {
+        unsigned short character = (characters[i * 2] << 8) | characters[i * 2 + 1];
+
+        switch (character)
+        {
+        case DISPLAY_CLEAR:
+            clearDisplay(buffer);
+            continue;
+        case DISPLAY_CARRIAGE_RETURN:
+            buffer->cursorColumn = 0;
+            continue;
+        case DISPLAY_LINE_FEED:
+            buffer->cursorRow = (buffer->cursorRow + 1) % buffer->rows;
+            continue;
+        }
+
+        buffer->cells[buffer->cursorRow * buffer->columns + buffer->cursorColumn] = displayCharacter(buffer->encoding, character);
+
+        if (++buffer->cursorColumn >= buffer->columns)
+        {
+            buffer->cursorColumn = 0;
+            buffer->cursorRow = (buffer->cursorRow + 1) % buffer->rows;
+        }
+    }
+
+    __atomic_store_n(&buffer->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+/**
+ * Close a display and remove its shared memory segment
+ *
+ * @param display The display to close
+ */
+void closeDisplay(DisplayState *display)
+{
+    if (!display->buffer)
+        return;
+
+    munmap(display->buffer, display->size);
+    shm_unlink(display->name);
+    display->buffer = NULL;
+}
@@ -0,0 +1,52 @@
+#ifndef DISPLAY_H_
+#define DISPLAY_H_
+
+#include <stddef.h>
+
+/* Shared memory segments are named after the bus and board, such as /modernjvs-display-0-0 */
+#define DISPLAY_NAME_FORMAT "/modernjvs-display-%d-%d"
+#define DISPLAY_NAME_SIZE 64
+
+#define DISPLAY_MAGIC 0x5344564A // "JVDS" in memory
+#define DISPLAY_VERSION 1
+
+typedef enum
+{
+    DISPLAY_STATUS_SUCCESS,
+    DISPLAY_STATUS_ERROR
+} DisplayStatus;
+
+/*
+ * The layout of the shared memory segment readers map.
+ *
+ * The sequence is odd while the display is being written, so a reader
+ * copies what it needs and uses it only if the sequence was even and
+ * unchanged on both sides of the copy. Each cell holds one character:
+ * an ASCII or half width katakana byte, or a double byte SHIFT-JIS code.
+ */
+typedef struct
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned int sequence;
+    unsigned char rows;
+    unsigned char columns;
+    unsigned char encoding;
+    unsigned char cursorRow;
+    unsigned char cursorColumn;
+    unsigned char reserved[3];
+    unsigned short cells[];
+} DisplayBuffer;
+
+typedef struct
+{
+    DisplayBuffer *buffer;
+    size_t size;
+    char name[DISPLAY_NAME_SIZE];
+} DisplayState;
+
+DisplayStatus initDisplay(DisplayState *display, int bus, int board, int rows, int columns, int encoding);
+void writeDisplay(DisplayState *display, const unsigned char *characters, int count);
+void closeDisplay(DisplayState *display);
+
+#endif // DISPLAY_H_
@@ -0,0 +1,721 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <linux/input.h>
+
+#include "output/output.h"
+#include "console/debug.h"
+#include "controller/threading.h"
+#include "hardware/device.h"
+
+/* Longest message the socket sink sends, one line per changed output */
+#define SOCKET_SINK_MESSAGE_SIZE 4096
+
+/* Sinks from the config come first, the rumble outputs of the game's controllers follow them */
+#define OUTPUT_MAX_SINKS (MAX_JVS_BUSES * (MAX_OUTPUT_SINKS + MAX_RUMBLE_MAPPINGS))
+
+#define BITS_PER_LONG (sizeof(long) * 8)
+#define testBit(bit, array) ((array[(bit) / BITS_PER_LONG] >> ((bit) % BITS_PER_LONG)) & 1)
+
+static struct
+{
+    OutputQueue queues[MAX_JVS_BUSES];
+    int queueUsed[MAX_JVS_BUSES];
+    OutputSink sinks[OUTPUT_MAX_SINKS];
+    int sinkCount;
+    int configSinkCount;
+    unsigned char state[MAX_JVS_BUSES][OUTPUT_MAX_BOARDS][JVS_MAX_GPO_BYTES];
+    unsigned char changed[MAX_JVS_BUSES][OUTPUT_MAX_BOARDS][JVS_MAX_GPO_BYTES];
+    struct timespec eventTime[MAX_JVS_BUSES][OUTPUT_MAX_BOARDS];
+    unsigned long dropped[MAX_JVS_BUSES];
+    int wakeIO;
+} outputData = {.wakeIO = -1};
+
+/**
+ * Get a single output from a board's outputs
+ *
+ * @param bits The GPO bytes of the board
+ * @param bit The output to get, counting from 0
+ * @returns 1 if the output is on, 0 otherwise
+ */
+int getOutputBit(const unsigned char *bits, int bit)
+{
+    return (bits[bit / 8] >> (7 - bit % 8)) & 1;
+}
+
+/*
+ * The socket sink sends a datagram to a UNIX socket whenever its outputs
+ * change, with a "<bus> <board> <output> <state>" line for every change.
+ * Nothing is sent back, so it is fine for nobody to be listening.
+ */
+static int openSocketSink(OutputSink *sink)
+{
+    struct sockaddr_un *address = calloc(1, sizeof(struct sockaddr_un));
+    if (!address)
+        return 0;
+
+    if (strlen(sink->config.target) >= sizeof(address->sun_path))
+    {
+        free(address);
+        return 0;
+    }
+
+    address->sun_family = AF_UNIX;
+    strcpy(address->sun_path, sink->config.target);
+
+    if ((sink->fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0)
+    {
+        free(address);
+        return 0;
+    }
+
+    sink->data = address;
+    return 1;
+}
+
+static void updateSocketSink(OutputSink *sink, const unsigned char *state, const unsigned char *changed)
+{
+    char message[SOCKET_SINK_MESSAGE_SIZE];
+    int length = 0;
+
+    for (int bit = sink->config.firstBit; bit <= sink->config.lastBit; bit++)
+    {
+        if (!getOutputBit(changed, bit))
+            continue;
+
+        int written = snprintf(message + length, sizeof(message) - length, "%d %d %d %d\n",
+                               sink->bus, sink->config.board, bit, getOutputBit(state, bit));
+        if (written < 0 || written >= (int)sizeof(message) - length)
+            break;
+        length += written;
+    }
+
+    if (length > 0)
+        sendto(sink->fd, message, length, 0, (struct sockaddr *)sink->data, sizeof(struct sockaddr_un));
+}
+
+static void closeSocketSink(OutputSink *sink)
+{
+    close(sink->fd);
+    free(sink->data);
+    sink->data = NULL;
+}
+
+/*
+ * The LED sink drives the LEDs of an input device, such as the lock
+ * lights on a keyboard or an LED controller that shows up as one. The
+ * first output in the range goes to LED 0 (num lock), and so on.
+ */
+static int openLEDSink(OutputSink *sink)
+{
+    return (sink->fd = open(sink->config.target, O_WRONLY | O_NONBLOCK | O_CLOEXEC)) >= 0;
+}
+
+static void updateLEDSink(OutputSink *sink, const unsigned char *state, const unsigned char *changed)
+{
+    struct input_event events[LED_CNT + 1];
+    int count = 0;
+
+    memset(events, 0, sizeof(events));
+    for (int bit = sink->config.firstBit; bit <= sink->config.lastBit && bit - sink->config.firstBit < LED_CNT; bit++)
+    {
+        if (!getOutputBit(changed, bit))
+            continue;
+
+        events[count].type = EV_LED;
+        events[count].code = bit - sink->config.firstBit;
+        events[count].value = getOutputBit(state, bit);
+        count++;
+    }
+
+    if (count == 0)
+        return;
+
+    events[count].type = EV_SYN;
+    events[count].code = SYN_REPORT;
+    count++;
+
+    if (write(sink->fd, events, sizeof(struct input_event) * count) < 0)
+        debug(1, "Warning: Failed to set the LEDs on %s\n", sink->config.target);
+}
+
+static void closeLEDSink(OutputSink *sink)
+{
+    close(sink->fd);
+}
+
+/*
+ * The GPIO sink drives lamps and relays wired to GPIO pins. The target
+ * lists a pin for each output in the range, optionally after the chip
+ * they are on, such as /dev/gpiochip0:17,27,22. All of the pins are
+ * requested together and set with one call whenever any of them change.
+ */
+typedef struct
+{
+    GPIOBank *bank;
+    int count;
+} GPIOSinkData;
+
+static int openGPIOSink(OutputSink *sink)
+{
+    char target[MAX_PATH_LENGTH];
+    strcpy(target, sink->config.target);
+
+    const char *chipPath = NULL;
+    char *pinList = strrchr(target, ':');
+    if (pinList)
+    {
+        *pinList++ = '\0';
+        chipPath = target;
+    }
+    else
+    {
+        pinList = target;
+    }
+
+    int pins[GPIO_BANK_MAX_LINES];
+    int count = 0;
+    char *saveptr = NULL;
+    for (char *pin = strtok_r(pinList, ",", &saveptr); pin; pin = strtok_r(NULL, ",", &saveptr))
+    {
+        if (count >= GPIO_BANK_MAX_LINES || count > sink->config.lastBit - sink->config.firstBit)
+        {
+            debug(0, "Warning: More pins than outputs for the GPIO sink %s\n", sink->config.target);
+            break;
+        }
+        pins[count++] = atoi(pin);
+    }
+
+    if (count == 0)
+        return 0;
+
+    GPIOSinkData *data = calloc(1, sizeof(GPIOSinkData));
+    if (!data)
+        return 0;
+
+    if ((data->bank = requestGPIOBank(chipPath, pins, count)) == NULL)
+    {
+        free(data);
+        return 0;
+    }
+
+    /* Outputs past the last pin go nowhere, so don't wake the sink for them */
+    data->count = count;
+    sink->config.lastBit = sink->config.firstBit + count - 1;
+    sink->data = data;
+    return 1;
+}
+
+static void updateGPIOSink(OutputSink *sink, const unsigned char *state, const unsigned char *changed)
+{
+    (void)changed;
+    GPIOSinkData *data = sink->data;
+    int values[GPIO_BANK_MAX_LINES];
+
+    for (int i = 0; i < data->count; i++)
+        values[i] = getOutputBit(state, sink->config.firstBit + i);
+
+    if (!setGPIOBank(data->bank, values))
+        debug(1, "Warning: Failed to set the GPIO pins %s\n", sink->config.target);
+}
+
+static void closeGPIOSink(OutputSink *sink)
+{
+    GPIOSinkData *data = sink->data;
+    releaseGPIOBank(data->bank);
+    free(data);
+    sink->data = NULL;
+}
+
+/*
+ * The rumble sink kicks a controller when any of its outputs turn on,
+ * which is how gun games fire the recoil solenoid. The effect is
+ * uploaded when the sink opens, so firing it is a single write. How
+ * long each kick took from the game's write is kept and logged when
+ * the sink closes.
+ */
+typedef struct
+{
+    int effectID;
+    int duration;
+    int strength;
+    unsigned long played;
+    long totalLatency;
+    long worstLatency;
+} RumbleSinkData;
+
+static int openRumbleSink(OutputSink *sink)
+{
+    RumbleSinkData *data = sink->data;
+    if (!data)
+    {
+        if ((data = calloc(1, sizeof(RumbleSinkData))) == NULL)
+            return 0;
+        data->duration = DEFAULT_RUMBLE_DURATION;
+        data->strength = DEFAULT_RUMBLE_STRENGTH;
+    }
+    sink->data = data;
+
+    unsigned long features[(FF_MAX + BITS_PER_LONG) / BITS_PER_LONG] = {0};
+    if ((sink->fd = open(sink->config.target, O_RDWR | O_NONBLOCK | O_CLOEXEC)) < 0 ||
+        ioctl(sink->fd, EVIOCGBIT(EV_FF, sizeof(features)), features) < 0 || !testBit(FF_RUMBLE, features))
+    {
+        if (sink->fd >= 0)
+            close(sink->fd);
+        free(data);
+        sink->data = NULL;
+        return 0;
+    }
+
+    int strength = data->strength < 0 ? 0 : data->strength > 100 ? 100 : data->strength;
+
+    struct ff_effect effect;
+    memset(&effect, 0, sizeof(effect));
+    effect.type = FF_RUMBLE;
+    effect.id = -1;
+    effect.replay.length = data->duration;
+    effect.u.rumble.strong_magnitude = 0xFFFF * strength / 100;
+    effect.u.rumble.weak_magnitude = 0xFFFF * strength / 100;
+
+    if (ioctl(sink->fd, EVIOCSFF, &effect) < 0)
+    {
+        close(sink->fd);
+        free(data);
+        sink->data = NULL;
+        return 0;
+    }
+
+    data->effectID = effect.id;
+    return 1;
+}
+
+static void updateRumbleSink(OutputSink *sink, const unsigned char *state, const unsigned char *changed)
+{
+    RumbleSinkData *data = sink->data;
+    int fired = 0, held = 0;
+
+    for (int bit = sink->config.firstBit; bit <= sink->config.lastBit; bit++)
+    {
+        if (getOutputBit(state, bit))
+        {
+            held = 1;
+            fired |= getOutputBit(changed, bit);
+        }
+    }
+
+    /* Turning every output off cuts a long rumble short, turning one of several off does nothing */
+    if (!fired && held)
+        return;
+
+    struct input_event play = {.type = EV_FF, .code = data->effectID, .value = fired};
+    if (write(sink->fd, &play, sizeof(play)) != sizeof(play))
+    {
+        debug(1, "Warning: Failed to rumble %s\n", sink->config.target);
+        return;
+    }
+
+    if (!fired)
+        return;
+
+    struct timespec now, *written = &outputData.eventTime[sink->bus][sink->config.board];
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long latency = (now.tv_sec - written->tv_sec) * 1000000 + (now.tv_nsec - written->tv_nsec) / 1000;
+
+    data->played++;
+    data->totalLatency += latency;
+    if (latency > data->worstLatency)
+        data->worstLatency = latency;
+}
+
+static void closeRumbleSink(OutputSink *sink)
+{
+    RumbleSinkData *data = sink->data;
+
+    if (data->played > 0)
+        debug(1, "Rumbled %s %lu times, %.2f ms on average and %.2f ms at worst after the game's write\n",
+              sink->config.target, data->played, data->totalLatency / 1000.0 / data->played, data->worstLatency / 1000.0);
+
+    ioctl(sink->fd, EVIOCRMFF, data->effectID);
+    close(sink->fd);
+    free(data);
+    sink->data = NULL;
+}
+
+static const OutputSinkType socketSink = {
+    .name = "socket",
+    .open = openSocketSink,
+    .update = updateSocketSink,
+    .close = closeSocketSink,
+};
+
+static const OutputSinkType ledSink = {
+    .name = "led",
+    .open = openLEDSink,
+    .update = updateLEDSink,
+    .close = closeLEDSink,
+};
+
+static const OutputSinkType gpioSink = {
+    .name = "gpio",
+    .open = openGPIOSink,
+    .update = updateGPIOSink,
+    .close = closeGPIOSink,
+};
+
+static const OutputSinkType rumbleSink = {
+    .name = "rumble",
+    .open = openRumbleSink,
+    .update = updateRumbleSink,
+    .close = closeRumbleSink,
+};
+
+static const OutputSinkType *outputSinkTypes[] = {
+    &socketSink,
+    &ledSink,
+    &gpioSink,
+    &rumbleSink,
+};
+
+static const OutputSinkType *getSinkType(const char *name)
+{
+    for (size_t i = 0; i < sizeof(outputSinkTypes) / sizeof(outputSinkTypes[0]); i++)
+    {
+        if (strcmp(outputSinkTypes[i]->name, name) == 0)
+            return outputSinkTypes[i];
+    }
+    return NULL;
+}
+
+static void resetSink(OutputSink *sink, int bus, const OutputSinkConfig *config)
+{
+    sink->config = *config;
+    sink->bus = bus;
+    sink->fd = -1;
+    sink->data = NULL;
+    memset(sink->pending, 0, sizeof(sink->pending));
+    sink->lastUpdate.tv_sec = 0;
+    sink->lastUpdate.tv_nsec = 0;
+}
+
+/**
+ * Initialise the output sinks
+ *
+ * Opens every GPO_SINK from the config. Buses without any
+ * sinks get no queue, so their responder doesn't pay for outputs.
+ *
+ * @param config The full config
+ * @returns OUTPUT_STATUS_SUCCESS, even if some sinks could not be opened
+ */
+OutputStatus initOutput(JVSConfig *config)
+{
+    if ((outputData.wakeIO = eventfd(0, EFD_CLOEXEC)) < 0)
+        return OUTPUT_STATUS_ERROR;
+
+    for (int bus = 0; bus < config->busCount; bus++)
+    {
+        outputData.queues[bus].bus = bus;
+
+        for (int i = 0; i < config->buses[bus].outputSinkCount; i++)
+        {
+            OutputSinkConfig *sinkConfig = &config->buses[bus].outputSinks[i];
+            OutputSink *sink = &outputData.sinks[outputData.sinkCount];
+
+            if ((sink->type = getSinkType(sinkConfig->type)) == NULL)
+            {
+                debug(0, "Warning: Unknown GPO sink type %s\n", sinkConfig->type);
+                continue;
+            }
+
+            if (sinkConfig->board < 0 || sinkConfig->board >= OUTPUT_MAX_BOARDS ||
+                sinkConfig->firstBit < 0 || sinkConfig->lastBit >= OUTPUT_MAX_BITS ||
+                sinkConfig->firstBit > sinkConfig->lastBit)
+            {
+                debug(0, "Warning: Invalid output range for the GPO sink %s\n", sinkConfig->target);
+                continue;
+            }
+
+            resetSink(sink, bus, sinkConfig);
+
+            if (!sink->type->open(sink))
+            {
+                debug(0, "Warning: Could not open the %s GPO sink %s\n", sink->type->name, sinkConfig->target);
+                continue;
+            }
+
+            debug(1, "Debug: Sending outputs %d to %d of board %d to the %s sink %s\n",
+                  sinkConfig->firstBit, sinkConfig->lastBit, sinkConfig->board, sink->type->name, sinkConfig->target);
+
+            outputData.queueUsed[bus] = 1;
+            outputData.sinkCount++;
+        }
+    }
+
+    outputData.configSinkCount = outputData.sinkCount;
+    return OUTPUT_STATUS_SUCCESS;
+}
+
+/**
+ * Rumble a controller when the game fires an output
+ *
+ * Rumble outputs belong to the controllers found for the game, so
+ * they are added with the inputs and cleared again with them. They
+ * may only be changed while the output worker is stopped.
+ *
+ * @param bus The bus index
+ * @param board The board on the bus, 0 for the first IO
+ * @param output The output to watch, counting from 0
+ * @param devicePath The controller's event device
+ * @param duration How long each rumble lasts in milliseconds
+ * @param strength How strong the rumble is from 0 to 100
+ * @returns OUTPUT_STATUS_SUCCESS if the controller can rumble and is ready to
+ */
+OutputStatus addRumbleOutput(int bus, int board, int output, const char *devicePath, int duration, int strength)
+{
+    if (bus < 0 || bus >= MAX_JVS_BUSES || board < 0 || board >= OUTPUT_MAX_BOARDS ||
+        output < 0 || output >= OUTPUT_MAX_BITS || outputData.sinkCount >= OUTPUT_MAX_SINKS)
+        return OUTPUT_STATUS_ERROR;
+
+    OutputSinkConfig config = {.board = board, .firstBit = output, .lastBit = output};
+    strcpy(config.type, rumbleSink.name);
+    strncpy(config.target, devicePath, MAX_PATH_LENGTH - 1);
+
+    RumbleSinkData *data = calloc(1, sizeof(RumbleSinkData));
+    if (!data)
+        return OUTPUT_STATUS_ERROR;
+    data->duration = duration;
+    data->strength = strength;
+
+    OutputSink *sink = &outputData.sinks[outputData.sinkCount];
+    resetSink(sink, bus, &config);
+    sink->type = &rumbleSink;
+    sink->data = data;
+
+    if (!sink->type->open(sink))
+        return OUTPUT_STATUS_ERROR;
+
+    outputData.queueUsed[bus] = 1;
+    outputData.sinkCount++;
+    return OUTPUT_STATUS_SUCCESS;
+}
+
+/* Close the rumble outputs of the last set of inputs, only while the output worker is stopped */
+void clearRumbleOutputs(void)
+{
+    for (int i = outputData.configSinkCount; i < outputData.sinkCount; i++)
+        outputData.sinks[i].type->close(&outputData.sinks[i]);
+    outputData.sinkCount = outputData.configSinkCount;
+
+    memset(outputData.queueUsed, 0, sizeof(outputData.queueUsed));
+    for (int i = 0; i < outputData.sinkCount; i++)
+        outputData.queueUsed[outputData.sinks[i].bus] = 1;
+}
+
+/**
+ * Get the queue a bus sends its output changes on
+ *
+ * @param bus The bus index
+ * @returns The queue, or NULL if nothing is listening to the bus
+ */
+OutputQueue *getOutputQueue(int bus)
+{
+    if (bus < 0 || bus >= MAX_JVS_BUSES || !outputData.queueUsed[bus])
+        return NULL;
+
+    return &outputData.queues[bus];
+}
+
+/**
+ * Queue an output change for the output worker
+ *
+ * Only the bus responder may call this for its queue. It never blocks,
+ * if the worker has fallen so far behind that the queue is full the
+ * change is dropped and the next change to that byte carries it.
+ *
+ * @param queue The bus's queue
+ * @param event The change to queue
+ * @returns 1 if the change was queued, 0 if it was dropped
+ */
+int pushOutput(OutputQueue *queue, const OutputEvent *event)
+{
+    unsigned int tail = queue->tail;
+    unsigned int head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+
+    if (tail - head >= OUTPUT_QUEUE_SIZE)
+    {
+        __atomic_add_fetch(&queue->dropped, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    queue->events[tail & (OUTPUT_QUEUE_SIZE - 1)] = *event;
+    __atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
+
+    wakeOutput();
+    return 1;
+}
+
+void wakeOutput(void)
+{
+    uint64_t counter = 1;
+    if (outputData.wakeIO >= 0 && write(outputData.wakeIO, &counter, sizeof(counter)) != sizeof(counter))
+        debug(1, "Warning: Failed to wake the output worker\n");
+}
+
+/* Move everything queued into the worker's copy of the outputs */
+static void drainQueues(void)
+{
+    for (int bus = 0; bus < MAX_JVS_BUSES; bus++)
+    {
+        OutputQueue *queue = &outputData.queues[bus];
+        if (!outputData.queueUsed[bus])
+            continue;
+
+        unsigned int head = queue->head;
+        unsigned int tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+
+        for (; head != tail; head++)
+        {
+            OutputEvent *event = &queue->events[head & (OUTPUT_QUEUE_SIZE - 1)];
+            if (event->board >= OUTPUT_MAX_BOARDS || event->byte >= JVS_MAX_GPO_BYTES)
+                continue;
+
+            unsigned char *value = &outputData.state[bus][event->board][event->byte];
+            outputData.changed[bus][event->board][event->byte] |= *value ^ event->value;
+            outputData.eventTime[bus][event->board] = event->time;
+            *value = event->value;
+        }
+
+        __atomic_store_n(&queue->head, head, __ATOMIC_RELEASE);
+
+        unsigned long dropped = __atomic_load_n(&queue->dropped, __ATOMIC_RELAXED);
+        if (dropped != outputData.dropped[bus])
+        {
+            debug(0, "Warning: Dropped %lu output changes on bus %d\n", dropped - outputData.dropped[bus], bus + 1);
+            outputData.dropped[bus] = dropped;
+        }
+    }
+}
+
+static int rangeChanged(const unsigned char *changed, int firstBit, int lastBit)
+{
+    for (int bit = firstBit; bit <= lastBit; bit++)
+    {
+        if (getOutputBit(changed, bit))
+            return 1;
+    }
+    return 0;
+}
+
+/*
+ * Hand each sink the changes in its range. A sink with a minimum interval
+ * that was updated too recently keeps its changes pending, so a game that
+ * flickers a lamp faster than the relay behind it can follow only gets
+ * the latest state once the interval is up.
+ *
+ * Returns how many milliseconds until a pending sink is due, or -1 if none are.
+ */
+static int dispatchOutputs(void)
+{
+    struct timespec now;
+    int timeout = -1;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    for (int i = 0; i < outputData.sinkCount; i++)
+    {
+        OutputSink *sink = &outputData.sinks[i];
+        unsigned char *changed = outputData.changed[sink->bus][sink->config.board];
+
+        for (int byte = sink->config.firstBit / 8; byte <= sink->config.lastBit / 8; byte++)
+            sink->pending[byte] |= changed[byte];
+
+        if (!rangeChanged(sink->pending, sink->config.firstBit, sink->config.lastBit))
+            continue;
+
+        if (sink->config.minInterval > 0)
+        {
+            long elapsed = (now.tv_sec - sink->lastUpdate.tv_sec) * 1000 +
+                           (now.tv_nsec - sink->lastUpdate.tv_nsec) / 1000000;
+            if (elapsed < sink->config.minInterval)
+            {
+                int wait = sink->config.minInterval - elapsed;
+                if (timeout < 0 || wait < timeout)
+                    timeout = wait;
+                continue;
+            }
+        }
+
+        sink->type->update(sink, outputData.state[sink->bus][sink->config.board], sink->pending);
+        sink->lastUpdate = now;
+        memset(sink->pending, 0, sizeof(sink->pending));
+    }
+
+    memset(outputData.changed, 0, sizeof(outputData.changed));
+    return timeout;
+}
+
+static void *outputThread(void *_args)
+{
+    (void)_args;
+    uint64_t counter;
+    int timeout = -1;
+
+    while (getThreadsRunning())
+    {
+        /* Only poll when a rate limited sink is waiting, otherwise just block on the wake */
+        if (timeout >= 0)
+        {
+            struct pollfd wake = {.fd = outputData.wakeIO, .events = POLLIN};
+            int ready = poll(&wake, 1, timeout);
+            if (ready < 0 && errno != EINTR)
+                break;
+            if (ready > 0 && read(outputData.wakeIO, &counter, sizeof(counter)) != sizeof(counter) && errno != EINTR)
+                break;
+        }
+        else if (read(outputData.wakeIO, &counter, sizeof(counter)) != sizeof(counter) && errno != EINTR)
+        {
+            break;
+        }
+
+        drainQueues();
+        timeout = dispatchOutputs();
+    }
+
+    return 0;
+}
+
+/**
+ * Start the output worker
+ *
+ * The worker is managed by the thread manager, so it is started
+ * again every time the inputs are reinitialised.
+ *
+ * @returns OUTPUT_STATUS_SUCCESS if the worker is running or isn't needed
+ */
+OutputStatus startOutput(void)
+{
+    if (outputData.sinkCount == 0)
+        return OUTPUT_STATUS_SUCCESS;
+
+    if (createThread(outputThread, NULL) != THREAD_STATUS_SUCCESS)
+        return OUTPUT_STATUS_ERROR;
+
+    return OUTPUT_STATUS_SUCCESS;
+}
+
+void closeOutput(void)
+{
+    for (int i = 0; i < outputData.sinkCount; i++)
+        outputData.sinks[i].type->close(&outputData.sinks[i]);
+    outputData.sinkCount = 0;
+
+    if (outputData.wakeIO >= 0)
+        close(outputData.wakeIO);
+    outputData.wakeIO = -1;
+}
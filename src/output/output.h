@@ -0,0 +1,70 @@
+#ifndef OUTPUT_H_
+#define OUTPUT_H_
+
+#include <time.h>
+
+#include "console/config.h"
+
+/* Must be a power of two */
+#define OUTPUT_QUEUE_SIZE 256
+#define OUTPUT_MAX_BOARDS 4
+#define OUTPUT_MAX_BITS (JVS_MAX_GPO_BYTES * 8)
+
+typedef enum
+{
+    OUTPUT_STATUS_SUCCESS,
+    OUTPUT_STATUS_ERROR
+} OutputStatus;
+
+/* A new value for one byte of a board's general purpose outputs, and when the game wrote it */
+typedef struct
+{
+    unsigned char board;
+    unsigned char byte;
+    unsigned char value;
+    struct timespec time;
+} OutputEvent;
+
+/* Single producer, single consumer queue from a bus responder to the output worker */
+typedef struct
+{
+    OutputEvent events[OUTPUT_QUEUE_SIZE];
+    unsigned int head;
+    unsigned int tail;
+    unsigned long dropped;
+    int bus;
+} OutputQueue;
+
+struct OutputSink;
+
+/* Sinks are handed the outputs of their board whenever a bit in their range changes */
+typedef struct
+{
+    const char *name;
+    int (*open)(struct OutputSink *sink);
+    void (*update)(struct OutputSink *sink, const unsigned char *state, const unsigned char *changed);
+    void (*close)(struct OutputSink *sink);
+} OutputSinkType;
+
+typedef struct OutputSink
+{
+    const OutputSinkType *type;
+    OutputSinkConfig config;
+    int bus;
+    int fd;
+    void *data;
+    unsigned char pending[JVS_MAX_GPO_BYTES];
+    struct timespec lastUpdate;
+} OutputSink;
+
+OutputStatus initOutput(JVSConfig *config);
+OutputQueue *getOutputQueue(int bus);
+int pushOutput(OutputQueue *queue, const OutputEvent *event);
+OutputStatus startOutput(void);
+void wakeOutput(void);
+void closeOutput(void);
+OutputStatus addRumbleOutput(int bus, int board, int output, const char *devicePath, int duration, int strength);
+void clearRumbleOutputs(void);
+int getOutputBit(const unsigned char *bits, int bit);
+
+#endif // OUTPUT_H_
@@ -0,0 +1,97 @@
+/*
+ * Axis response table benchmark
+ *
+ * Builds the table for a linear, an s-curve and a points CURVE behind a
+ * 10% deadzone, for 8 to 16 bit axes, and checks every value the axis can
+ * report against working the response out directly in doubles. Then times
+ * a lookup against the direct maths for each event.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "controller/curve.h"
+
+#define BENCH_EVENTS 20000000
+#define BENCH_DEADZONE 0.1
+
+typedef struct
+{
+    ResponseCurve curve;
+    int min;
+    int max;
+} BenchAxis;
+
+static double now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+/* Scale to 0 to 1, take the deadzone out of the middle and apply the curve, as every event used to */
+static double axisResponse(void *context, double value)
+{
+    BenchAxis *axis = (BenchAxis *)context;
+
+    double scaled = (value - axis->min) / (double)(axis->max - axis->min);
+    scaled = scaled > 1 ? 1 : scaled < 0 ? 0 : scaled;
+
+    double offset = fabs(scaled - 0.5);
+    if (offset < BENCH_DEADZONE)
+        scaled = 0.5;
+    else
+        scaled = 0.5 + (scaled > 0.5 ? 0.5 : -0.5) * (offset - BENCH_DEADZONE) / (0.5 - BENCH_DEADZONE);
+
+    return applyCurve(&axis->curve, scaled);
+}
+
+int main(void)
+{
+    const int ranges[][2] = {{0, 255}, {0, 1023}, {-32768, 32767}, {0, 65535}};
+    const char *names[] = {"linear", "s-curve 2.5", "points"};
+    const ResponseCurve curves[] = {
+        {.type = CURVE_LINEAR},
+        {.type = CURVE_S_CURVE, .power = 2.5f},
+        {.type = CURVE_POINTS, .length = 2, .points = {{16384, 4096}, {49151, 61439}}},
+    };
+
+    for (size_t range = 0; range < sizeof(ranges) / sizeof(ranges[0]); range++)
+    {
+        for (size_t curve = 0; curve < sizeof(curves) / sizeof(curves[0]); curve++)
+        {
+            BenchAxis axis = {.curve = curves[curve], .min = ranges[range][0], .max = ranges[range][1]};
+            AxisTable table;
+            if (!buildAxisTable(&table, axis.min, axis.max, axisResponse, &axis))
+                return 1;
+
+            double worst = 0;
+            for (int value = axis.min; value <= axis.max; value++)
+                worst = fmax(worst, fabs(lookupAxisTable(&table, value) - axisResponse(&axis, value) * CURVE_ONE));
+
+            printf("%6d to %-6d %-12s worst difference %.1f/%d\n", axis.min, axis.max, names[curve], worst, CURVE_ONE);
+            freeAxisTable(&table);
+        }
+    }
+
+    BenchAxis axis = {.curve = curves[1], .min = -32768, .max = 32767};
+    AxisTable table;
+    if (!buildAxisTable(&table, axis.min, axis.max, axisResponse, &axis))
+        return 1;
+
+    volatile double directSink = 0;
+    volatile unsigned int tableSink = 0;
+    double start = now();
+    for (int i = 0; i < BENCH_EVENTS; i++)
+        directSink += axisResponse(&axis, (int)((i * 7919u) % 65536u) - 32768);
+    double direct = now() - start;
+
+    start = now();
+    for (int i = 0; i < BENCH_EVENTS; i++)
+        tableSink += lookupAxisTable(&table, (int)((i * 7919u) % 65536u) - 32768);
+    double lookup = now() - start;
+
+    printf("s-curve event %.1f ns worked out directly, %.1f ns from the table\n", direct / BENCH_EVENTS * 1e9, lookup / BENCH_EVENTS * 1e9);
+    freeAxisTable(&table);
+    return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * Analogue axis filter benchmark
+ *
+ * Feeds each axis FILTER a simulated 1kHz pedal on a 10 bit IO: held at
+ * 600 with two counts of noise either way, then pressed the rest of the
+ * way over 100ms. Reports the noise left while held, how many readings
+ * change the value the IO stores, the lag at the end of the press and
+ * the readings each filter gets through a second.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "controller/filter.h"
+
+#define BENCH_READINGS 20000000
+#define BENCH_PEDAL_READINGS 2000
+#define BENCH_PEDAL_MAX 1023
+#define BENCH_READING_TIME 1000 // microseconds between readings
+
+static double now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+/* Held at 600 for a second, then pressed 4 counts a reading until it is at 1000 */
+static int pedalPosition(int reading)
+{
+    if (reading < 1000)
+        return 600;
+    if (reading < 1100)
+        return 600 + (reading - 1000) * 4;
+    return 1000;
+}
+
+static void benchFilter(const char *name, const AxisFilterConfig *config)
+{
+    AxisFilter filter;
+    int64_t time = 0;
+
+    srand(1);
+    initAxisFilter(&filter, config, 0, BENCH_PEDAL_MAX);
+    int last = -1, changes = 0;
+    double noise = 0;
+    for (int i = 0; i < BENCH_PEDAL_READINGS; i++)
+    {
+        time += BENCH_READING_TIME;
+        int value = filterAxis(&filter, pedalPosition(i) + (rand() % 5) - 2, time);
+
+        /* The first 100ms let the filter settle */
+        if (i >= 100 && i < 1000)
+            noise += abs(value - 600);
+        changes += value != last;
+        last = value;
+    }
+
+    /* Lag is how far behind the press is at its end, at 4 counts a millisecond */
+    initAxisFilter(&filter, config, 0, BENCH_PEDAL_MAX);
+    int value = 0;
+    time = 0;
+    for (int i = 0; i < 100; i++)
+    {
+        time += BENCH_READING_TIME;
+        value = filterAxis(&filter, 600 + i * 4, time);
+    }
+    double lag = (600 + 99 * 4 - value) / 4.0;
+
+    volatile int sink = 0;
+    double start = now();
+    for (int i = 0; i < BENCH_READINGS; i++)
+    {
+        time += BENCH_READING_TIME;
+        sink += filterAxis(&filter, 500 + (i & 3), time);
+    }
+    double elapsed = now() - start;
+
+    printf("%-13s %.2f counts noise, %d/%d readings written, %.1f ms lag on a full press, %.0fM readings/s\n",
+           name, noise / 900, changes, BENCH_PEDAL_READINGS, lag, BENCH_READINGS / elapsed / 1e6);
+}
+
+int main(void)
+{
+    AxisFilterConfig none = {.type = AXIS_FILTER_NONE};
+    AxisFilterConfig ema = {.type = AXIS_FILTER_EMA, .strength = 2};
+    AxisFilterConfig median = {.type = AXIS_FILTER_MEDIAN, .strength = 3};
+    AxisFilterConfig oneEuro = {.type = AXIS_FILTER_ONE_EURO, .minCutoff = 1000, .beta = 5000};
+
+    benchFilter("none", &none);
+    benchFilter("ema 2", &ema);
+    benchFilter("median 3", &median);
+    benchFilter("one-euro 1 5", &oneEuro);
+    return 0;
+}
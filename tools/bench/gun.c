@@ -0,0 +1,178 @@
+/*
+ * Wii remote pointing and gun filter benchmark
+ *
+ * Compares pointWiimote against the trigonometry the Wii remote thread
+ * used to do for every IR event, then measures each GUN_FILTER on 100Hz
+ * reports: how much a remote held still jitters and how far it lags
+ * behind a swing across the screen. Last it fits both GUN_CALIBRATION
+ * types to a camera seeing the screen at an angle, and times applying
+ * them to each position.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "controller/gun.h"
+
+#define BENCH_EVENTS 20000000
+#define BENCH_POINT_PAIRS 1000000
+#define BENCH_REPORT_TIME 0.01 // seconds between reports
+
+static double now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+/* The pointing maths from before controller/gun.c, rotating the midpoint by the roll with atan2, sin and cos */
+static void pointWiimoteTrigonometry(int x0, int y0, int x1, int y1, double *x, double *y)
+{
+    int oneX = x0 > x1 ? x0 : x1, oneY = x0 > x1 ? y0 : y1;
+    int twoX = x0 > x1 ? x1 : x0, twoY = x0 > x1 ? y1 : y0;
+
+    double valueX = 512 + cos(atan2(twoY - oneY, twoX - oneX) * -1) * (((oneX - twoX) / 2 + twoX) - 512) - sin(atan2(twoY - oneY, twoX - oneX) * -1) * (((oneY - twoY) / 2 + twoY) - 384);
+    double valueY = 384 + sin(atan2(twoY - oneY, twoX - oneX) * -1) * (((oneX - twoX) / 2 + twoX) - 512) + cos(atan2(twoY - oneY, twoX - oneX) * -1) * (((oneY - twoY) / 2 + twoY) - 384);
+
+    *x = valueX / 1023;
+    *y = 1.0 - valueY / 1023;
+}
+
+static void benchPointing(void)
+{
+    int *points = malloc(sizeof(int) * 4 * 1024);
+    if (points == NULL)
+        return;
+
+    srand(1);
+    for (int i = 0; i < 4 * 1024; i++)
+        points[i] = 300 + rand() % 400;
+
+    double worst = 0;
+    for (int i = 0; i < BENCH_POINT_PAIRS; i++)
+    {
+        int x0 = rand() % 1023, y0 = rand() % 767, x1 = rand() % 1023, y1 = rand() % 767;
+        double oldX, oldY, newX, newY;
+        pointWiimoteTrigonometry(x0, y0, x1, y1, &oldX, &oldY);
+        pointWiimote(x0, y0, x1, y1, &newX, &newY);
+        worst = fmax(worst, fmax(fabs(oldX - newX), fabs(oldY - newY)));
+    }
+
+    volatile double sink = 0;
+    double start = now();
+    for (int i = 0; i < BENCH_EVENTS; i++)
+    {
+        int *point = points + (i & 1023) * 4;
+        double x, y;
+        pointWiimoteTrigonometry(point[0], point[1], point[2], point[3], &x, &y);
+        sink += x + y;
+    }
+    double trigonometry = now() - start;
+
+    start = now();
+    for (int i = 0; i < BENCH_EVENTS; i++)
+    {
+        int *point = points + (i & 1023) * 4;
+        double x, y;
+        pointWiimote(point[0], point[1], point[2], point[3], &x, &y);
+        sink += x + y;
+    }
+    double rotation = now() - start;
+
+    printf("pointing     %.1fM events/s with atan2, %.1fM/s now, worst difference %.1e over %d point pairs\n",
+           BENCH_EVENTS / trigonometry / 1e6, BENCH_EVENTS / rotation / 1e6, worst, BENCH_POINT_PAIRS);
+    free(points);
+}
+
+static void benchFilter(const char *name, const GunFilterConfig *config)
+{
+    GunFilter filter;
+    volatile double sink = 0;
+
+    initGunFilter(&filter, config);
+    double start = now();
+    for (int i = 0; i < BENCH_EVENTS; i++)
+    {
+        double x = 0.5 + (i & 7) * 1e-3, y = 0.5;
+        filterGunPosition(&filter, i * BENCH_REPORT_TIME, &x, &y);
+        sink += x;
+    }
+    double elapsed = now() - start;
+
+    /* Held still with a pixel of IR jitter either way, the first second lets the filter settle */
+    srand(1);
+    initGunFilter(&filter, config);
+    double jitter = 0;
+    for (int i = 0; i < 500; i++)
+    {
+        double x = 0.5 + ((rand() % 3) - 1) / 1023.0, y = 0.5;
+        filterGunPosition(&filter, i * BENCH_REPORT_TIME, &x, &y);
+        if (i > 100)
+            jitter += fabs(x - 0.5);
+    }
+
+    /* Then swung across the screen at 3 screens a second */
+    double lag = 0;
+    for (int i = 0; i < 20; i++)
+    {
+        double target = 0.2 + 3 * i * BENCH_REPORT_TIME, x = target, y = 0.5;
+        filterGunPosition(&filter, 5 + i * BENCH_REPORT_TIME, &x, &y);
+        lag = (target - x) / 3;
+    }
+
+    printf("%-12s %.0fM/s, %.2f px jitter held still, %.1f ms lag on a 3 screen/s swing\n",
+           name, BENCH_EVENTS / elapsed / 1e6, jitter / 399 * 1023, lag * 1000);
+}
+
+/* A camera below and to the left of the screen, so the corners make a trapezium */
+static void benchCalibration(const char *name, GunCalibrationType type)
+{
+    int corners[GUN_CALIBRATION_CORNERS][2] = {{120, 90}, {880, 150}, {860, 620}, {140, 700}};
+    const int targets[GUN_CALIBRATION_CORNERS][2] = {{0, 0}, {GUN_POSITION_MAX, 0}, {GUN_POSITION_MAX, GUN_POSITION_MAX}, {0, GUN_POSITION_MAX}};
+    GunCalibration calibration;
+
+    if (!solveGunCalibration(&calibration, corners, type))
+    {
+        printf("%-12s could not be solved\n", name);
+        return;
+    }
+
+    int worst = 0;
+    for (int i = 0; i < GUN_CALIBRATION_CORNERS; i++)
+    {
+        int x, y;
+        applyGunCalibration(&calibration, corners[i][0], corners[i][1], &x, &y);
+        worst = abs(x - targets[i][0]) > worst ? abs(x - targets[i][0]) : worst;
+        worst = abs(y - targets[i][1]) > worst ? abs(y - targets[i][1]) : worst;
+    }
+
+    volatile int sink = 0;
+    double start = now();
+    for (int i = 0; i < BENCH_EVENTS; i++)
+    {
+        int x, y;
+        applyGunCalibration(&calibration, 100 + (i & 511), 100 + ((i >> 9) & 511), &x, &y);
+        sink += x + y;
+    }
+    double elapsed = now() - start;
+
+    printf("%-12s %.0fM points/s, corners off by up to %d/%d\n", name, BENCH_EVENTS / elapsed / 1e6, worst, GUN_POSITION_MAX);
+}
+
+int main(void)
+{
+    benchPointing();
+
+    GunFilterConfig none = {.type = GUN_FILTER_NONE};
+    GunFilterConfig ema = {.type = GUN_FILTER_EMA, .timeConstant = 8};
+    GunFilterConfig oneEuro = {.type = GUN_FILTER_ONE_EURO, .minCutoff = 1, .beta = 5};
+
+    benchFilter("none", &none);
+    benchFilter("ema 8ms", &ema);
+    benchFilter("one-euro 1/5", &oneEuro);
+
+    benchCalibration("affine", GUN_CALIBRATION_AFFINE);
+    benchCalibration("projective", GUN_CALIBRATION_PROJECTIVE);
+    return 0;
+}